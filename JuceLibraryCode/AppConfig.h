@@ -33,6 +33,7 @@
 #define JUCE_MODULE_AVAILABLE_juce_core                   1
 #define JUCE_MODULE_AVAILABLE_juce_cryptography           1
 #define JUCE_MODULE_AVAILABLE_juce_data_structures        1
+#define JUCE_MODULE_AVAILABLE_juce_dsp                    1
 #define JUCE_MODULE_AVAILABLE_juce_events                 1
 #define JUCE_MODULE_AVAILABLE_juce_graphics               1
 #define JUCE_MODULE_AVAILABLE_juce_gui_basics             1
@@ -202,6 +203,29 @@
  //#define JUCE_ENABLE_ALLOCATION_HOOKS 0
 #endif
 
+//==============================================================================
+// juce_dsp flags:
+
+#ifndef    JUCE_ASSERTION_FIRFILTER
+ //#define JUCE_ASSERTION_FIRFILTER 1
+#endif
+
+#ifndef    JUCE_DSP_USE_INTEL_MKL
+ //#define JUCE_DSP_USE_INTEL_MKL 0
+#endif
+
+#ifndef    JUCE_DSP_USE_SHARED_FFTW
+ //#define JUCE_DSP_USE_SHARED_FFTW 0
+#endif
+
+#ifndef    JUCE_DSP_USE_STATIC_FFTW
+ //#define JUCE_DSP_USE_STATIC_FFTW 0
+#endif
+
+#ifndef    JUCE_DSP_ENABLE_SNAP_TO_ZERO
+ //#define JUCE_DSP_ENABLE_SNAP_TO_ZERO 1
+#endif
+
 //==============================================================================
 // juce_events flags:
 
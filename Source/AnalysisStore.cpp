@@ -0,0 +1,339 @@
+#include "AnalysisStore.h"
+#include "Tracer.h"
+
+using namespace samplore;
+
+namespace
+{
+	uint64 getPathHash(const File& file)
+	{
+		return (uint64)file.getFullPathName().hashCode64();
+	}
+}
+
+AnalysisStore::AnalysisStore(const File& file) : mFile(file)
+{
+	load();
+}
+
+AnalysisStore::~AnalysisStore()
+{
+	flush();
+}
+
+File AnalysisStore::getDefaultFile()
+{
+	//next to the per sample properties
+	PropertiesFile::Options options;
+	options.applicationName = "Analysis";
+	options.folderName = "Samplore";
+	options.osxLibrarySubFolder = "Application Support/Samplore";
+	return options.getDefaultFile().getSiblingFile("Analysis.log");
+}
+
+uint64 AnalysisStore::findContentHash(const File& file) const
+{
+	return findContentHash(file, file.getSize(), file.getLastModificationTime().toMilliseconds());
+}
+
+uint64 AnalysisStore::findContentHash(const File& file, int64 size, int64 modified) const
+{
+	const ScopedLock sl(mLock);
+	auto it = mLocations.find(getPathHash(file));
+	if (it == mLocations.end())
+	{
+		return 0;
+	}
+	const Location& location = it->second;
+	if (location.mSize != size || location.mModified != modified)
+	{
+		return 0; //edited since
+	}
+	return location.mContentHash;
+}
+
+void AnalysisStore::setContentHash(const File& file, uint64 contentHash)
+{
+	Location location;
+	location.mSize = file.getSize();
+	location.mModified = file.getLastModificationTime().toMilliseconds();
+	location.mContentHash = contentHash;
+	const uint64 pathHash = getPathHash(file);
+	const ScopedLock sl(mLock);
+	mLocations[pathHash] = location;
+	writeLocation(mPending, pathHash, location);
+}
+
+void AnalysisStore::moveContentHash(const File& from, const File& to)
+{
+	const ScopedLock sl(mLock);
+	auto it = mLocations.find(getPathHash(from));
+	if (it != mLocations.end() && it->second.mSize == to.getSize())
+	{
+		Location location = it->second;
+		location.mModified = to.getLastModificationTime().toMilliseconds(); //some moves touch the date
+		const uint64 pathHash = getPathHash(to);
+		mLocations[pathHash] = location;
+		writeLocation(mPending, pathHash, location);
+	}
+}
+
+bool AnalysisStore::hasFailed(const File& file) const
+{
+	const ScopedLock sl(mLock);
+	auto it = mFailures.find(getPathHash(file));
+	return it != mFailures.end() && it->second.mSize == file.getSize()
+		&& it->second.mModified == file.getLastModificationTime().toMilliseconds();
+}
+
+void AnalysisStore::setFailed(const File& file)
+{
+	Location location;
+	location.mSize = file.getSize();
+	location.mModified = file.getLastModificationTime().toMilliseconds();
+	const uint64 pathHash = getPathHash(file);
+	const ScopedLock sl(mLock);
+	mFailures[pathHash] = location;
+	writeFailure(mPending, pathHash, location);
+}
+
+bool AnalysisStore::getAnalysis(uint64 contentHash, SampleAnalysis& analysis) const
+{
+	const ScopedLock sl(mLock);
+	auto it = mAnalyses.find(contentHash);
+	if (it == mAnalyses.end())
+	{
+		return false;
+	}
+	analysis = it->second;
+	return true;
+}
+
+void AnalysisStore::setTempo(uint64 contentHash, float bpm, float confidence)
+{
+	const ScopedLock sl(mLock);
+	SampleAnalysis& analysis = mAnalyses[contentHash];
+	analysis.mTempo = bpm;
+	analysis.mTempoConfidence = confidence;
+	writeTempo(mPending, contentHash, analysis);
+}
+
+void AnalysisStore::setKey(uint64 contentHash, int key, float confidence)
+{
+	const ScopedLock sl(mLock);
+	SampleAnalysis& analysis = mAnalyses[contentHash];
+	analysis.mKey = key;
+	analysis.mKeyConfidence = confidence;
+	writeKey(mPending, contentHash, analysis);
+}
+
+void AnalysisStore::setDescriptor(uint64 contentHash, const SampleDescriptor& descriptor)
+{
+	const ScopedLock sl(mLock);
+	SampleAnalysis& analysis = mAnalyses[contentHash];
+	analysis.mDescriptor = descriptor;
+	analysis.mHasDescriptor = true;
+	writeDescriptor(mPending, contentHash, analysis);
+}
+
+void AnalysisStore::setAudioFingerprint(uint64 contentHash, const AudioFingerprint& audioFingerprint)
+{
+	const ScopedLock sl(mLock);
+	SampleAnalysis& analysis = mAnalyses[contentHash];
+	analysis.mAudioFingerprint = audioFingerprint;
+	analysis.mHasAudioFingerprint = true;
+	writeAudioFingerprint(mPending, contentHash, analysis);
+}
+
+void AnalysisStore::flush()
+{
+	SAMPLORE_TRACE_ZONE("AnalysisStore::flush");
+	const ScopedLock sl(mLock);
+	if (mPending.getDataSize() == 0)
+	{
+		return;
+	}
+	//another process may be appending or compacting, records must not interleave
+	const InterProcessLock::ScopedLockType processLock(getProcessLock());
+	mFile.getParentDirectory().createDirectory();
+	const bool isNew = !mFile.existsAsFile() || mFile.getSize() == 0;
+	FileOutputStream out(mFile); //appends
+	if (out.failedToOpen())
+	{
+		return; //kept pending, next flush tries again
+	}
+	if (isNew)
+	{
+		out.writeInt(MAGIC);
+		out.writeInt(VERSION);
+	}
+	out.write(mPending.getData(), mPending.getDataSize());
+	out.flush();
+	mPending.reset();
+}
+
+void AnalysisStore::load()
+{
+	SAMPLORE_TRACE_ZONE("AnalysisStore::load");
+	//compacting writes back only what was read, no other process may append in between
+	const InterProcessLock::ScopedLockType processLock(getProcessLock());
+	int records = 0;
+	bool torn = false;
+	{
+		FileInputStream in(mFile);
+		if (in.failedToOpen())
+		{
+			return;
+		}
+		if (in.readInt() != MAGIC || in.readInt() != VERSION)
+		{
+			torn = true; //from another version, start over rather than append to it
+		}
+		while (!torn && !in.isExhausted())
+		{
+			const int type = in.readByte();
+			const int64 size = type == LocationRecord ? 32 : type == FailureRecord ? 24 : (type == TempoRecord || type == KeyRecord) ? 16
+				: type == DescriptorRecord ? 8 + SampleDescriptor::SIZE
+				: type == AudioFingerprintRecord ? 16 + 4 * AudioFingerprint::MAX_WORDS : 0;
+			if (size == 0 || in.getTotalLength() - in.getPosition() < size)
+			{
+				torn = true; //the app died halfway through an append
+				break;
+			}
+			const uint64 key = (uint64)in.readInt64();
+			if (type == LocationRecord)
+			{
+				Location location;
+				location.mSize = in.readInt64();
+				location.mModified = in.readInt64();
+				location.mContentHash = (uint64)in.readInt64();
+				mLocations[key] = location;
+			}
+			else if (type == FailureRecord)
+			{
+				Location location;
+				location.mSize = in.readInt64();
+				location.mModified = in.readInt64();
+				mFailures[key] = location;
+			}
+			else if (type == TempoRecord)
+			{
+				SampleAnalysis& analysis = mAnalyses[key];
+				analysis.mTempo = in.readFloat();
+				analysis.mTempoConfidence = in.readFloat();
+			}
+			else if (type == KeyRecord)
+			{
+				SampleAnalysis& analysis = mAnalyses[key];
+				analysis.mKey = in.readInt();
+				analysis.mKeyConfidence = in.readFloat();
+			}
+			else if (type == DescriptorRecord)
+			{
+				SampleAnalysis& analysis = mAnalyses[key];
+				in.read(analysis.mDescriptor.mValues.data(), SampleDescriptor::SIZE);
+				analysis.mHasDescriptor = true;
+			}
+			else
+			{
+				SampleAnalysis& analysis = mAnalyses[key];
+				analysis.mAudioFingerprint.mSeconds = in.readFloat();
+				analysis.mAudioFingerprint.mCount = jlimit(0, AudioFingerprint::MAX_WORDS, in.readInt());
+				for (uint32& word : analysis.mAudioFingerprint.mWords)
+					word = (uint32)in.readInt();
+				analysis.mHasAudioFingerprint = true;
+			}
+			records++;
+		}
+	}
+	//every rescan of an edited file leaves a dead record behind, and appending after a torn record would hide what follows
+	if (torn || records > 2 * (int)(mLocations.size() + mFailures.size() + mAnalyses.size()) + 1024)
+	{
+		compact();
+	}
+}
+
+void AnalysisStore::compact()
+{
+	SAMPLORE_TRACE_ZONE("AnalysisStore::compact");
+	TemporaryFile temp(mFile);
+	{
+		FileOutputStream out(temp.getFile());
+		if (out.failedToOpen())
+		{
+			return;
+		}
+		out.writeInt(MAGIC);
+		out.writeInt(VERSION);
+		for (const auto& location : mLocations)
+		{
+			writeLocation(out, location.first, location.second);
+		}
+		for (const auto& failure : mFailures)
+		{
+			writeFailure(out, failure.first, failure.second);
+		}
+		for (const auto& analysis : mAnalyses)
+		{
+			if (analysis.second.hasTempo())
+				writeTempo(out, analysis.first, analysis.second);
+			if (analysis.second.hasKey())
+				writeKey(out, analysis.first, analysis.second);
+			if (analysis.second.mHasDescriptor)
+				writeDescriptor(out, analysis.first, analysis.second);
+			if (analysis.second.mHasAudioFingerprint)
+				writeAudioFingerprint(out, analysis.first, analysis.second);
+		}
+	}
+	temp.overwriteTargetFileWithTemporary();
+}
+
+void AnalysisStore::writeLocation(OutputStream& out, uint64 pathHash, const Location& location)
+{
+	out.writeByte(LocationRecord);
+	out.writeInt64((int64)pathHash);
+	out.writeInt64(location.mSize);
+	out.writeInt64(location.mModified);
+	out.writeInt64((int64)location.mContentHash);
+}
+
+void AnalysisStore::writeFailure(OutputStream& out, uint64 pathHash, const Location& location)
+{
+	out.writeByte(FailureRecord);
+	out.writeInt64((int64)pathHash);
+	out.writeInt64(location.mSize);
+	out.writeInt64(location.mModified);
+}
+
+void AnalysisStore::writeTempo(OutputStream& out, uint64 contentHash, const SampleAnalysis& analysis)
+{
+	out.writeByte(TempoRecord);
+	out.writeInt64((int64)contentHash);
+	out.writeFloat(analysis.mTempo);
+	out.writeFloat(analysis.mTempoConfidence);
+}
+
+void AnalysisStore::writeKey(OutputStream& out, uint64 contentHash, const SampleAnalysis& analysis)
+{
+	out.writeByte(KeyRecord);
+	out.writeInt64((int64)contentHash);
+	out.writeInt(analysis.mKey);
+	out.writeFloat(analysis.mKeyConfidence);
+}
+
+void AnalysisStore::writeDescriptor(OutputStream& out, uint64 contentHash, const SampleAnalysis& analysis)
+{
+	out.writeByte(DescriptorRecord);
+	out.writeInt64((int64)contentHash);
+	out.write(analysis.mDescriptor.mValues.data(), SampleDescriptor::SIZE);
+}
+
+void AnalysisStore::writeAudioFingerprint(OutputStream& out, uint64 contentHash, const SampleAnalysis& analysis)
+{
+	out.writeByte(AudioFingerprintRecord);
+	out.writeInt64((int64)contentHash);
+	out.writeFloat(analysis.mAudioFingerprint.mSeconds);
+	out.writeInt(analysis.mAudioFingerprint.mCount);
+	for (uint32 word : analysis.mAudioFingerprint.mWords)
+		out.writeInt((int)word);
+}
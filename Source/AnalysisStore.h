@@ -0,0 +1,117 @@
+/*
+  ==============================================================================
+
+    AnalysisStore.h
+    Author:  Jake Rose
+
+	Results of audio analysis, kept per ContentHash so renamed, moved and
+	duplicated files share them. An append-only log in the app data folder,
+	replayed on startup. Paths remember their content hash along with size
+	and date, an unchanged file is looked up without reading it.
+
+  ==============================================================================
+*/
+
+#ifndef ANALYSISSTORE_H
+#define ANALYSISSTORE_H
+
+#include "JuceHeader.h"
+
+#include "MusicalKey.h"
+#include "SampleDescriptor.h"
+#include "AudioFingerprint.h"
+
+#include <unordered_map>
+
+namespace samplore
+{
+	struct SampleAnalysis
+	{
+		float mTempo = -1.0f; //negative until analysed, zero if there is no beat
+		float mTempoConfidence = 0.0f;
+		int mKey = MusicalKey::UNKNOWN;
+		float mKeyConfidence = 0.0f;
+		SampleDescriptor mDescriptor;
+		bool mHasDescriptor = false;
+		AudioFingerprint mAudioFingerprint; //what it sounds like, unlike the content hash it is stored under
+		bool mHasAudioFingerprint = false;
+
+		bool hasTempo() const { return mTempo >= 0.0f; }
+		bool hasKey() const { return mKey != MusicalKey::UNKNOWN; }
+		bool isComplete() const { return hasTempo() && hasKey() && mHasDescriptor && mHasAudioFingerprint; }
+	};
+
+	/// Thread safe
+	class AnalysisStore
+	{
+	public:
+		AnalysisStore(const File& file = getDefaultFile());
+		~AnalysisStore();
+
+		static File getDefaultFile();
+		/// Held while writing anything in the app data folder, the app and a command line run may share it
+		static InterProcessLock& getProcessLock()
+		{
+			static InterProcessLock lock("SamploreData");
+			return lock;
+		}
+		/// Content hash from the last time this path was seen at the same size and date, 0 otherwise
+		uint64 findContentHash(const File& file) const;
+		/// Same with the size and date already known, from a directory listing
+		uint64 findContentHash(const File& file, int64 size, int64 modified) const;
+		void setContentHash(const File& file, uint64 contentHash);
+		/// Call after moving or renaming a file, the new path keeps the old one's hash without reading the file
+		void moveContentHash(const File& from, const File& to);
+		/// True if this path could not be analysed the last time it was seen at the same size and date
+		bool hasFailed(const File& file) const;
+		void setFailed(const File& file);
+
+		bool getAnalysis(uint64 contentHash, SampleAnalysis& analysis) const;
+		void setTempo(uint64 contentHash, float bpm, float confidence);
+		void setKey(uint64 contentHash, int key, float confidence);
+		void setDescriptor(uint64 contentHash, const SampleDescriptor& descriptor);
+		void setAudioFingerprint(uint64 contentHash, const AudioFingerprint& audioFingerprint);
+
+		/// Appends everything set since the last flush to the log
+		void flush();
+	private:
+		enum RecordType
+		{
+			LocationRecord = 1,
+			TempoRecord,
+			KeyRecord,
+			DescriptorRecord,
+			AudioFingerprintRecord,
+			FailureRecord
+		};
+		struct Location
+		{
+			int64 mSize = 0;
+			int64 mModified = 0;
+			uint64 mContentHash = 0;
+		};
+
+		void load();
+		/// Writes only the live records, drops superseded ones
+		void compact();
+		static void writeLocation(OutputStream& out, uint64 pathHash, const Location& location);
+		static void writeFailure(OutputStream& out, uint64 pathHash, const Location& location);
+		static void writeTempo(OutputStream& out, uint64 contentHash, const SampleAnalysis& analysis);
+		static void writeKey(OutputStream& out, uint64 contentHash, const SampleAnalysis& analysis);
+		static void writeDescriptor(OutputStream& out, uint64 contentHash, const SampleAnalysis& analysis);
+		static void writeAudioFingerprint(OutputStream& out, uint64 contentHash, const SampleAnalysis& analysis);
+
+		static const int MAGIC = 0x414e4153; //"SANA"
+		static const int VERSION = 4; //1 keyed analyses by an FNV hash of the whole file head, 2 analysed at 11025Hz, 3 sampled large payloads
+
+		File mFile;
+		CriticalSection mLock;
+		std::unordered_map<uint64, Location> mLocations; //by path hash
+		std::unordered_map<uint64, Location> mFailures; //by path hash, no content hash
+		std::unordered_map<uint64, SampleAnalysis> mAnalyses; //by content hash
+		MemoryOutputStream mPending;
+
+		JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AnalysisStore)
+	};
+}
+#endif
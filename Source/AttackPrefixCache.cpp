@@ -0,0 +1,242 @@
+#include "AttackPrefixCache.h"
+#include "SamplifyLookAndFeel.h"
+#include "AudioPlayer.h"
+
+using namespace samplore;
+
+namespace
+{
+	const int PREFIX_FILE_MAGIC = 0x58465053; //"SPFX"
+	const int PREFIX_FILE_VERSION = 1;
+	const int STORES_BETWEEN_TRIMS = 200;
+}
+
+PrefixedAudioSource::PrefixedAudioSource(std::shared_ptr<const AttackPrefix> prefix, std::unique_ptr<AudioFormatReaderSource> readerSource,
+	std::unique_ptr<PositionableAudioSource> streamSource)
+	: mPrefix(prefix), mReaderSource(std::move(readerSource)), mStream(std::move(streamSource))
+{
+	setNextReadPosition(0);
+}
+
+void PrefixedAudioSource::getNextAudioBlock(const AudioSourceChannelInfo& info)
+{
+	const AudioBuffer<float>& prefix = mPrefix->mAudio.mBuffer;
+	int fromPrefix = (int)jlimit((int64)0, (int64)info.numSamples, (int64)prefix.getNumSamples() - mPosition);
+	if (fromPrefix > 0 && prefix.getNumChannels() > 0)
+	{
+		for (int ch = 0; ch < info.buffer->getNumChannels(); ch++)
+		{
+			info.buffer->copyFrom(ch, info.startSample, prefix, ch % prefix.getNumChannels(), (int)mPosition, fromPrefix);
+		}
+	}
+	if (fromPrefix < info.numSamples)
+	{
+		//the stream sat at the end of the prefix buffering, carry on from there
+		AudioSourceChannelInfo rest(info.buffer, info.startSample + fromPrefix, info.numSamples - fromPrefix);
+		mStream->getNextAudioBlock(rest);
+	}
+	mPosition += info.numSamples;
+}
+
+void PrefixedAudioSource::setNextReadPosition(int64 newPosition)
+{
+	mPosition = newPosition;
+	mStream->setNextReadPosition(jmax(newPosition, (int64)mPrefix->mAudio.mBuffer.getNumSamples()));
+}
+
+//==============================================================================
+AttackPrefixCache::AttackPrefixCache(AudioFormatManager& formatManager, const File& directory)
+	: Thread("Attack Prefix Cache"), mFormatManager(formatManager), mDirectory(directory)
+{
+}
+
+AttackPrefixCache::~AttackPrefixCache()
+{
+	signalThreadShouldExit();
+	notify();
+	stopThread(2000);
+}
+
+File AttackPrefixCache::getDefaultDirectory()
+{
+	//next to the per sample properties
+	PropertiesFile::Options options;
+	options.applicationName = "AttackPrefixes";
+	options.folderName = "Samplore";
+	options.osxLibrarySubFolder = "Application Support/Samplore";
+	return options.getDefaultFile().getSiblingFile("AttackPrefixes");
+}
+
+File AttackPrefixCache::getPrefixFile(const File& file) const
+{
+	//size and modification time in the name, an edited sample misses and the stale prefix ages out
+	int64 stamp = file.getSize() ^ file.getLastModificationTime().toMilliseconds();
+	return mDirectory.getChildFile(String::toHexString(file.getFullPathName().hashCode64()) + "_" + String::toHexString(stamp) + ".prefix");
+}
+
+std::shared_ptr<const AttackPrefix> AttackPrefixCache::load(const File& file) const
+{
+	File prefixFile = getPrefixFile(file);
+	FileInputStream in(prefixFile);
+	if (!in.openedOk() || in.readInt() != PREFIX_FILE_MAGIC || in.readInt() != PREFIX_FILE_VERSION)
+	{
+		return nullptr;
+	}
+	auto prefix = std::make_shared<AttackPrefix>();
+	int channels = in.readInt();
+	prefix->mAudio.mSampleRate = in.readDouble();
+	prefix->mTotalLength = in.readInt64();
+	int samples = in.readInt();
+	if (channels <= 0 || channels > 64 || samples <= 0 || prefix->mAudio.mSampleRate <= 0.0)
+	{
+		return nullptr;
+	}
+	HeapBlock<int16> pcm((size_t)samples);
+	prefix->mAudio.mBuffer.setSize(channels, samples);
+	for (int ch = 0; ch < channels; ch++)
+	{
+		if (in.read(pcm.getData(), samples * (int)sizeof(int16)) != samples * (int)sizeof(int16))
+		{
+			return nullptr;
+		}
+		float* dest = prefix->mAudio.mBuffer.getWritePointer(ch);
+		for (int i = 0; i < samples; i++)
+		{
+			dest[i] = (int16)ByteOrder::swapIfBigEndian((uint16)pcm[i]) / 32768.0f;
+		}
+	}
+	prefixFile.setLastModificationTime(Time::getCurrentTime()); //recently used, trimmed last
+	return prefix;
+}
+
+void AttackPrefixCache::requestPrefixes(const Array<File>& files)
+{
+	{
+		const ScopedLock sl(mQueueLock);
+		mQueue.clear();
+		for (int i = 0; i < files.size(); i++)
+		{
+			mQueue.push_back(files[i]);
+		}
+	}
+	if (!isThreadRunning())
+	{
+		startThread(Thread::Priority::low);
+	}
+	notify();
+}
+
+void AttackPrefixCache::requestPrefix(const File& file)
+{
+	{
+		const ScopedLock sl(mQueueLock);
+		mQueue.push_front(file); //just played, more important than what's on screen
+	}
+	if (!isThreadRunning())
+	{
+		startThread(Thread::Priority::low);
+	}
+	notify();
+}
+
+void AttackPrefixCache::run()
+{
+	mDirectory.createDirectory();
+	trimToBudget();
+	while (!threadShouldExit())
+	{
+		File next;
+		{
+			const ScopedLock sl(mQueueLock);
+			if (!mQueue.empty())
+			{
+				next = mQueue.front();
+				mQueue.pop_front();
+			}
+		}
+		if (next == File())
+		{
+			wait(-1);
+			continue;
+		}
+		if (mNotNeeded.count(next.getFullPathName()) == 0 && !contains(next))
+		{
+			store(next);
+		}
+	}
+}
+
+void AttackPrefixCache::store(const File& file)
+{
+	std::unique_ptr<AudioFormatReader> reader(AudioPlayer::createReaderFor(mFormatManager, file));
+	if (reader == nullptr || reader->sampleRate <= 0.0)
+	{
+		return;
+	}
+	int64 prefixLength = (int64)(reader->sampleRate * AppValues::getInstance().PREVIEW_ATTACK_PREFIX_MS / 1000.0);
+	double seconds = reader->lengthInSamples / reader->sampleRate;
+	if (reader->lengthInSamples <= prefixLength || prefixLength <= 0 || seconds <= AppValues::getInstance().PREVIEW_DECODED_CACHE_MAX_SECONDS)
+	{
+		mNotNeeded.insert(file.getFullPathName()); //short samples are decoded whole when played
+		return;
+	}
+	int channels = (int)reader->numChannels;
+	int samples = (int)prefixLength;
+	AudioBuffer<float> buffer(channels, samples);
+	if (!reader->read(&buffer, 0, samples, 0, true, true))
+	{
+		return;
+	}
+
+	MemoryOutputStream out;
+	out.writeInt(PREFIX_FILE_MAGIC);
+	out.writeInt(PREFIX_FILE_VERSION);
+	out.writeInt(channels);
+	out.writeDouble(reader->sampleRate);
+	out.writeInt64(reader->lengthInSamples);
+	out.writeInt(samples);
+	for (int ch = 0; ch < channels; ch++)
+	{
+		const float* src = buffer.getReadPointer(ch);
+		for (int i = 0; i < samples; i++)
+		{
+			out.writeShort((short)jlimit(-32768, 32767, roundToInt(src[i] * 32768.0f)));
+		}
+	}
+	//write then rename, a reader never sees half a prefix
+	File prefixFile = getPrefixFile(file);
+	File temp = prefixFile.withFileExtension(".tmp");
+	if (temp.replaceWithData(out.getData(), out.getDataSize()))
+	{
+		temp.moveFileTo(prefixFile);
+	}
+	if (++mStoresSinceTrim >= STORES_BETWEEN_TRIMS)
+	{
+		trimToBudget();
+	}
+}
+
+void AttackPrefixCache::trimToBudget()
+{
+	mStoresSinceTrim = 0;
+	int64 budget = (int64)AppValues::getInstance().PREVIEW_ATTACK_PREFIX_DISK_MB << 20;
+	Array<File> files = mDirectory.findChildFiles(File::findFiles, false, "*.prefix");
+	int64 total = 0;
+	for (const File& f : files)
+	{
+		total += f.getSize();
+	}
+	if (total <= budget)
+	{
+		return;
+	}
+	std::sort(files.begin(), files.end(), [](const File& a, const File& b)
+	{
+		return a.getLastModificationTime() < b.getLastModificationTime();
+	});
+	for (int i = 0; i < files.size() && total > budget; i++)
+	{
+		total -= files[i].getSize();
+		files[i].deleteFile();
+	}
+}
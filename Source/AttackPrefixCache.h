@@ -0,0 +1,85 @@
+/*
+  ==============================================================================
+
+    AttackPrefixCache.h
+    Author:  Jake Rose
+
+	First few hundred milliseconds of long samples, decoded ahead of time and
+	kept on disk as plain 16 bit PCM. Playback starts from the prefix while the
+	read-ahead thread catches up on the real file.
+
+  ==============================================================================
+*/
+
+#ifndef ATTACKPREFIXCACHE_H
+#define ATTACKPREFIXCACHE_H
+
+#include "JuceHeader.h"
+
+#include "DecodedSampleCache.h"
+
+#include <deque>
+#include <unordered_set>
+
+namespace samplore
+{
+	struct AttackPrefix
+	{
+		DecodedAudio mAudio; //the prefix itself
+		int64 mTotalLength = 0; //length of the whole file in samples
+	};
+
+	/// Plays the prefix from memory then hands over to the streaming source,
+	/// which was positioned at the end of the prefix so it buffered meanwhile
+	class PrefixedAudioSource : public PositionableAudioSource
+	{
+	public:
+		PrefixedAudioSource(std::shared_ptr<const AttackPrefix> prefix, std::unique_ptr<AudioFormatReaderSource> readerSource,
+			std::unique_ptr<PositionableAudioSource> streamSource);
+
+		void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override { mStream->prepareToPlay(samplesPerBlockExpected, sampleRate); }
+		void releaseResources() override { mStream->releaseResources(); }
+		void getNextAudioBlock(const AudioSourceChannelInfo& info) override;
+
+		void setNextReadPosition(int64 newPosition) override;
+		int64 getNextReadPosition() const override { return mPosition; }
+		int64 getTotalLength() const override { return mStream->getTotalLength(); }
+		bool isLooping() const override { return false; }
+	private:
+		std::shared_ptr<const AttackPrefix> mPrefix;
+		std::unique_ptr<AudioFormatReaderSource> mReaderSource;
+		std::unique_ptr<PositionableAudioSource> mStream; //reads mReaderSource
+		int64 mPosition = 0;
+	};
+
+	class AttackPrefixCache : private Thread
+	{
+	public:
+		AttackPrefixCache(AudioFormatManager& formatManager, const File& directory = getDefaultDirectory());
+		~AttackPrefixCache();
+
+		/// nullptr if nothing is stored, or the file changed since
+		std::shared_ptr<const AttackPrefix> load(const File& file) const;
+		bool contains(const File& file) const { return getPrefixFile(file).existsAsFile(); }
+		/// Replaces anything still queued, the newest request is what's on screen
+		void requestPrefixes(const Array<File>& files);
+		void requestPrefix(const File& file);
+
+		static File getDefaultDirectory();
+	private:
+		void run() override;
+		void store(const File& file);
+		void trimToBudget();
+		File getPrefixFile(const File& file) const;
+
+		AudioFormatManager& mFormatManager;
+		File mDirectory;
+		CriticalSection mQueueLock;
+		std::deque<File> mQueue;
+		int mStoresSinceTrim = 0;
+		std::unordered_set<String> mNotNeeded; //worker thread only
+
+		JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AttackPrefixCache)
+	};
+}
+#endif
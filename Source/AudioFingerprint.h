@@ -0,0 +1,203 @@
+/*
+  ==============================================================================
+
+    AudioFingerprint.h
+    Author:  Jake Rose
+
+	Acoustic fingerprint of the start of a sample, after Haitsma & Kalker.
+	Each 23ms frame gives a 32 bit word, one bit per pair of neighbouring
+	bands saying whether their log energy difference grew since the last
+	frame. Gain, re-encoding and a trimmed lead-in leave most bits alone, so
+	copies of one sound saved under other names and formats come out nearly
+	equal.
+	Pure, any thread.
+
+  ==============================================================================
+*/
+
+#ifndef AUDIOFINGERPRINT_H
+#define AUDIOFINGERPRINT_H
+
+#include "JuceHeader.h"
+
+#include <array>
+#include <cmath>
+#include <vector>
+
+struct AudioFingerprint
+{
+	static const int MAX_WORDS = 32; //about three quarters of a second from the first onset
+
+	std::array<uint32, MAX_WORDS> mWords {};
+	int mCount = 0; //zero for silence
+	float mSeconds = 0.0f; //length of the whole sample
+
+	bool operator==(const AudioFingerprint& other) const
+	{
+		return mCount == other.mCount && mSeconds == other.mSeconds && mWords == other.mWords;
+	}
+};
+
+class AudioFingerprinter
+{
+public:
+	static const int NUM_BANDS = 33;
+	static constexpr double MIN_FREQUENCY = 200.0;
+	static constexpr double MAX_FREQUENCY = 5000.0;
+	static constexpr double HOP_SECONDS = 0.0232;
+	/// Fingerprints start where the level first comes this close to the loudest
+	static constexpr double ONSET_LEVEL = 0.01;
+	/// Band energies are floored this far under the loudest band, and words stop at
+	/// the first frame this far under the loudest frame, so noise and dither a copy
+	/// picked up in its quiet parts do not decide any bits
+	static constexpr float FLOOR_LEVEL = 1.0e-3f;
+	static constexpr float TAIL_LEVEL = 1.0e-3f;
+	/// Log energy change a bit needs to be set, floored bands stay clear instead of flickering
+	static constexpr float MIN_CHANGE = 0.05f;
+	/// Level changes, filtering, bit depth and trimming stay under 0.2, unrelated drum hits above 0.4
+	static constexpr float MAX_DISTANCE = 0.3f;
+	/// Words either side a match may be shifted by, covers lead-ins trimmed differently
+	static const int MAX_SHIFT = 2;
+
+	/// seconds is the length of the whole sample, mono may hold only the start of it
+	static AudioFingerprint compute(const float* mono, int numSamples, double sampleRate, double seconds)
+	{
+		AudioFingerprint fingerprint;
+		fingerprint.mSeconds = (float)seconds;
+		const int hop = jmax(1, roundToInt(sampleRate * HOP_SECONDS));
+		if (mono == nullptr || sampleRate <= 0.0 || numSamples < hop)
+			return fingerprint;
+
+		const int start = findOnset(mono, numSamples);
+		if (start < 0)
+			return fingerprint;
+
+		const int order = sampleRate > 16000.0 ? 11 : 10;
+		const int size = 1 << order;
+		const int half = size / 2;
+		std::array<int, NUM_BANDS + 2> edges;
+		const double top = jmin(MAX_FREQUENCY, 0.45 * sampleRate);
+		for (int band = 0; band <= NUM_BANDS + 1; band++)
+		{
+			const double frequency = MIN_FREQUENCY * std::pow(top / MIN_FREQUENCY, band / (double)(NUM_BANDS + 1));
+			edges[band] = jlimit(1, half, roundToInt(frequency * size / sampleRate));
+		}
+
+		dsp::FFT fft(order);
+		dsp::WindowingFunction<float> window((size_t)size, dsp::WindowingFunction<float>::hann, false);
+		std::vector<float> frame((size_t)size * 2);
+		std::vector<std::array<float, NUM_BANDS + 1>> bands;
+		float loudest = 0.0f, loudestFrame = 0.0f;
+		for (int f = 0; f <= AudioFingerprint::MAX_WORDS; f++)
+		{
+			const int position = start + f * hop;
+			if (position >= numSamples)
+				break;
+			//short samples run off the end, the tail is silence
+			std::fill(frame.begin(), frame.end(), 0.0f);
+			std::copy(mono + position, mono + jmin(numSamples, position + size), frame.begin());
+			window.multiplyWithWindowingTable(frame.data(), (size_t)size);
+			fft.performFrequencyOnlyForwardTransform(frame.data(), true);
+			std::array<float, NUM_BANDS + 1> energies;
+			float total = 0.0f;
+			for (int band = 0; band <= NUM_BANDS; band++)
+			{
+				float energy = 0.0f;
+				for (int bin = edges[band]; bin < jmax(edges[band] + 1, edges[band + 1]); bin++)
+					energy += frame[bin] * frame[bin];
+				energies[band] = energy;
+				total += energy;
+				loudest = jmax(loudest, energy);
+			}
+			loudestFrame = jmax(loudestFrame, total);
+			if (total < loudestFrame * TAIL_LEVEL)
+				break; //decayed into whatever noise the copy picked up
+			bands.push_back(energies);
+		}
+		const float floor = jmax(1.0e-20f, loudest * FLOOR_LEVEL);
+		for (auto& energies : bands)
+		{
+			for (float& energy : energies)
+				energy = std::log(energy + floor);
+		}
+		for (int f = 1; f < (int)bands.size(); f++)
+		{
+			uint32 word = 0;
+			for (int band = 0; band < NUM_BANDS; band++)
+			{
+				const float difference = (bands[f][band] - bands[f][band + 1]) - (bands[f - 1][band] - bands[f - 1][band + 1]);
+				word = (word << 1) | (difference > MIN_CHANGE ? 1u : 0u);
+			}
+			fingerprint.mWords[fingerprint.mCount++] = word;
+		}
+		return fingerprint;
+	}
+
+	/// Differing bits over set bits at the best alignment. 0 for the same words, near 1 for
+	/// unrelated ones and when the two barely overlap. Plain bit error rate would call two
+	/// sparse fingerprints close just for sharing their zeros
+	static float getDistance(const AudioFingerprint& a, const AudioFingerprint& b)
+	{
+		const int minOverlap = jmax(1, jmin(a.mCount, b.mCount) - MAX_SHIFT);
+		float best = 1.0f;
+		for (int shift = -MAX_SHIFT; shift <= MAX_SHIFT; shift++)
+		{
+			int errors = 0, set = 0, overlap = 0;
+			for (int i = jmax(0, -shift); i < a.mCount && i + shift < b.mCount; i++)
+			{
+				errors += countBits(a.mWords[i] ^ b.mWords[i + shift]);
+				set += countBits(a.mWords[i]) + countBits(b.mWords[i + shift]);
+				overlap++;
+			}
+			if (overlap >= minOverlap && set > 0)
+				best = jmin(best, errors / (float)set);
+		}
+		return best;
+	}
+
+	/// Near enough in length and content to be one sound saved twice
+	static bool isSameSound(const AudioFingerprint& a, const AudioFingerprint& b)
+	{
+		if (a.mCount == 0 || b.mCount == 0)
+			return false;
+		const float longer = jmax(a.mSeconds, b.mSeconds);
+		if (std::abs(a.mSeconds - b.mSeconds) > 0.05f + 0.1f * longer)
+			return false; //a one-shot is not a duplicate of the loop that starts with it
+		return getDistance(a, b) <= MAX_DISTANCE;
+	}
+
+	static int countBits(uint32 value)
+	{
+		int count = 0;
+		for (; value != 0; value &= value - 1)
+			count++;
+		return count;
+	}
+private:
+	/// Start of the first short window reaching ONSET_LEVEL of the loudest, -1 for silence.
+	/// Fine grained so lead-ins trimmed at different points line up
+	static int findOnset(const float* mono, int numSamples)
+	{
+		const int window = 32;
+		std::vector<float> energies;
+		float loudest = 0.0f;
+		for (int position = 0; position + window <= numSamples; position += window)
+		{
+			float energy = 0.0f;
+			for (int i = 0; i < window; i++)
+				energy += mono[position + i] * mono[position + i];
+			energies.push_back(energy);
+			loudest = jmax(loudest, energy);
+		}
+		if (loudest <= 1.0e-8f * window)
+			return -1;
+		for (int i = 0; i < (int)energies.size(); i++)
+		{
+			if (energies[i] >= loudest * ONSET_LEVEL)
+				return i * window;
+		}
+		return -1;
+	}
+};
+
+#endif
@@ -1,22 +1,41 @@
 #include "AudioPlayer.h"
+#include "Tracer.h"
+#include "SamplifyLookAndFeel.h"
 
 using namespace samplore;
 
-AudioPlayer::AudioPlayer()
+AudioPlayer::AudioPlayer() : mDecodedCache(0) //the player can exist before AppValues, budget is applied on load
 {
 	formatManager.registerBasicFormats();
-	transportSource.addChangeListener(this);
 	state = TransportState::Stopped;
+	mReadAheadThread.startThread(Thread::Priority::high);
+	mRetirer.startThread(Thread::Priority::low);
 }
 
 AudioPlayer::~AudioPlayer()
 {
-	// Remove ourselves as a listener from the transport source
-	transportSource.removeChangeListener(this);
+	stopTimer();
+	mLoadPool.removeAllJobs(true, 2000);
+	cancelPendingUpdate();
+	//the audio callback is detached by now, so whatever is still queued can be freed here
+	const auto pending = mCommandFifo.read(mCommandFifo.getNumReady());
+	pending.forEach([this](int i) { delete mCommands[i].mChain; });
+	delete mActiveChain;
+	mActiveChain = nullptr;
+	mRetirer.stopThread(1000);
+	deleteRetiredChains();
+	mReadySource.reset();
+	mReadAheadThread.stopThread(1000);
 }
 
 void AudioPlayer::play()
 {
+	if (!mSourceReady)
+	{
+		mPlayPending = !mCurrentSample.isNull();
+		mPendingPlayT = mSampleStartT;
+		return;
+	}
 	setRelativeTime(mSampleStartT);
 	changeState(TransportState::Starting);
 }
@@ -28,8 +47,8 @@ void AudioPlayer::reset()
 
 void AudioPlayer::stop()
 {
-	transportSource.stop();
-	sendChangeMessage();
+	pushCommand(Command::Type::Stop);
+	changeState(TransportState::Stopped);
 }
 
 void samplore::AudioPlayer::toggle()
@@ -60,7 +79,13 @@ void AudioPlayer::playSample()
 
 void samplore::AudioPlayer::playSample(float t)
 {
-	if (!mCurrentSample.isNull())
+	if (!mCurrentSample.isNull() && !mSourceReady)
+	{
+		//still opening on the load pool, play as soon as it lands
+		mPlayPending = true;
+		mPendingPlayT = t;
+	}
+	else if (!mCurrentSample.isNull())
 	{
 		stop();
 		reset();
@@ -69,34 +94,49 @@ void samplore::AudioPlayer::playSample(float t)
 	}
 }
 
-void AudioPlayer::changeListenerCallback(ChangeBroadcaster* source)
+void AudioPlayer::timerCallback()
 {
-	if (source == &transportSource)
+	//only trust the audio thread's flag once it has caught up with everything we sent
+	if (state == TransportState::Playing && mCommandsHandled.load() == mCommandsSent && !mAudioPlaying.load())
 	{
-		if (transportSource.isPlaying())
-			changeState(TransportState::Playing);
-		else
-			changeState(TransportState::Stopped);
+		changeState(TransportState::Stopped); //reached the end of the file
 	}
 }
 
 void AudioPlayer::releaseResources()
 {
-	transportSource.releaseResources();
+	if (mActiveChain != nullptr)
+	{
+		mActiveChain->mRateStage->releaseResources();
+	}
 }
 
 void AudioPlayer::setRelativeTime(double t)
 {
 	t = std::clamp(t, 0.0, 1.0);
 	mSampleStartT = t;
-	//float currentPos = transportSource.getCurrentPosition();
-	//int64 currentReadPos = transportSource.getNextReadPosition();
-	float sampleLength = transportSource.getLengthInSeconds();
-	float newPos = sampleLength * t;
-	transportSource.setPosition(newPos);
+	int64 position = (int64)(mCurrentLength * t);
+	mAudioPosition = position; //the audio thread overwrites this once it has seeked
+	if (mSourceReady && !mCurrentSample.isNull() && position != mQueuedPosition)
+	{
+		//repositioning the read-ahead source locks and wakes its thread, a new chain starts there instead
+		mQueuedPosition = position;
+		pushCommand(Command::Type::Seek, position);
+		int requestId = ++mLatestLoadId;
+		File file = mCurrentSample.getFile();
+		mLoadPool.addJob([this, file, requestId, position]() { prepareSource(file, requestId, true, position); });
+	}
 	sendChangeMessage();
 }
-	
+
+float AudioPlayer::getRelativeTime()
+{
+	if (mCurrentLength <= 0)
+	{
+		return 0.0f;
+	}
+	return jlimit(0.0f, 1.0f, (float)((double)mAudioPosition.load() / (double)mCurrentLength));
+}
 
 void AudioPlayer::changeState(TransportState newState)
 {
@@ -107,15 +147,19 @@ void AudioPlayer::changeState(TransportState newState)
 		switch (state)
 		{
 		case TransportState::Stopped:
+			stopTimer();
 			setRelativeTime(mSampleStartT);
 			break;
 		case TransportState::Stopping:
-			transportSource.stop();
+			pushCommand(Command::Type::Stop);
+			changeState(TransportState::Stopped);
 			break;
 		case TransportState::Playing:
 			break;
 		case TransportState::Starting:
-			transportSource.start();
+			pushCommand(Command::Type::Play);
+			mQueuedPosition = -1;
+			startTimer(30);
 			changeState(TransportState::Playing);
 			break;
 		}
@@ -123,33 +167,476 @@ void AudioPlayer::changeState(TransportState newState)
 	sendChangeMessage();
 }
 
+void AudioPlayer::pushCommand(Command::Type type, int64 position, PlaybackChain* chain)
+{
+	const auto scope = mCommandFifo.write(1);
+	if (scope.blockSize1 + scope.blockSize2 == 0)
+	{
+		//the audio thread has stalled for 64 commands, it never saw this chain so it is still ours
+		jassertfalse;
+		delete chain;
+		return;
+	}
+	scope.forEach([&](int i)
+	{
+		mCommands[i].mType = type;
+		mCommands[i].mPosition = position;
+		mCommands[i].mChain = chain;
+	});
+	mCommandsSent++;
+}
+
+void AudioPlayer::handleCommands()
+{
+	const auto scope = mCommandFifo.read(mCommandFifo.getNumReady());
+	scope.forEach([this](int i)
+	{
+		const Command& command = mCommands[i];
+		switch (command.mType)
+		{
+		case Command::Type::Play:
+			mPlaying = mActiveChain != nullptr;
+			break;
+		case Command::Type::Stop:
+			mPlaying = false;
+			break;
+		case Command::Type::Seek:
+			mSeeking = true;
+			mAudioPosition = command.mPosition;
+			break;
+		case Command::Type::SwapSource:
+			retireChain(mActiveChain);
+			mActiveChain = command.mChain;
+			mPlaying = false;
+			mSeeking = false;
+			mAudioPosition = 0;
+			break;
+		case Command::Type::SeekSource:
+			//same file, a play already sent carries on from here
+			retireChain(mActiveChain);
+			mActiveChain = command.mChain;
+			mSeeking = false;
+			mAudioPosition = command.mPosition;
+			break;
+		}
+		//playing flag first so the timer never pairs a caught up count with a stale flag
+		mAudioPlaying = mPlaying;
+		mCommandsHandled++;
+	});
+}
+
+void AudioPlayer::retireChain(PlaybackChain* chain)
+{
+	if (chain == nullptr)
+	{
+		return;
+	}
+	const auto scope = mRetireFifo.write(1);
+	if (scope.blockSize1 + scope.blockSize2 == 0)
+	{
+		//retirer is far behind, leaking one chain beats freeing on the audio thread
+		jassertfalse;
+		return;
+	}
+	scope.forEach([this, chain](int i) { mRetired[i] = chain; });
+}
+
+void AudioPlayer::deleteRetiredChains()
+{
+	const auto scope = mRetireFifo.read(mRetireFifo.getNumReady());
+	scope.forEach([this](int i)
+	{
+		delete mRetired[i];
+		mRetired[i] = nullptr;
+	});
+}
+
+void AudioPlayer::SourceRetirer::run()
+{
+	while (!threadShouldExit())
+	{
+		mOwner.deleteRetiredChains();
+		wait(100);
+	}
+}
+
+void AudioPlayer::prepareChain(PlaybackChain& chain)
+{
+	double deviceRate = mPreparedSampleRate.load();
+	int blockSize = mPreparedBlockSize.load();
+	if (deviceRate <= 0.0 || blockSize <= 0)
+	{
+		return; //no device yet, prepareToPlay prepares the active chain when one arrives
+	}
+	chain.mRateStage->setRateRatio(chain.mSampleRate > 0.0 ? chain.mSampleRate / deviceRate : 1.0);
+	chain.mRateStage->prepareToPlay(blockSize, deviceRate);
+	chain.mPreparedDeviceRate = deviceRate;
+	chain.mPreparedBlockSize = blockSize;
+}
+
+AudioFormatReader* AudioPlayer::createReaderFor(AudioFormatManager& formatManager, const File& file)
+{
+	if (file.hasFileExtension("wav;aif;aiff"))
+	{
+		if (AudioFormat* format = formatManager.findFormatForFileExtension(file.getFileExtension()))
+		{
+			std::unique_ptr<MemoryMappedAudioFormatReader> mapped(format->createMemoryMappedReader(file));
+			//maps address space only, pages fault in as the read position reaches them
+			if (mapped != nullptr && mapped->mapEntireFile())
+			{
+				return mapped.release();
+			}
+		}
+	}
+	return formatManager.createReaderFor(file);
+}
 
 void AudioPlayer::loadFile(Sample::Reference ref)
 {
-	AudioFormatReader* reader = formatManager.createReaderFor(ref.getFile());
+	SAMPLORE_TRACE_ZONE("AudioPlayer::loadFile");
 	mCurrentSample = ref;
-	juce::Time currentTime = juce::Time::getCurrentTime();
-	if (reader != nullptr && (currentTime - mTimeSinceLoaded).inSeconds() > 0.2f && state != TransportState::Starting)
+	mSourceReady = false;
+	mLoadFailed = false;
+	mPlayPending = false;
+	mDecodedCache.setByteBudget((int64)AppValues::getInstance().PREVIEW_DECODED_CACHE_MB << 20);
+	mAdaptiveQuality = AppValues::getInstance().PREVIEW_ADAPTIVE_QUALITY;
+	if (!ref.isNull())
+	{
+		int requestId = ++mLatestLoadId;
+		File file = ref.getFile();
+		mLoadPool.addJob([this, file, requestId]() { prepareSource(file, requestId, false, 0); });
+	}
+	sendChangeMessage();
+}
+
+void AudioPlayer::preloadSamples(const Array<Sample::Reference>& samples)
+{
+	mDecodedCache.setByteBudget((int64)AppValues::getInstance().PREVIEW_DECODED_CACHE_MB << 20);
+	for (int i = 0; i < samples.size(); i++)
+	{
+		if (!samples[i].isNull())
+		{
+			File file = samples[i].getFile();
+			mLoadPool.addJob([this, file]() { preloadReader(file); });
+		}
+	}
+}
+
+void AudioPlayer::prepareSource(const File& file, int requestId, bool seek, int64 start)
+{
+	SAMPLORE_TRACE_ZONE("AudioPlayer::prepareSource");
+	if (requestId != mLatestLoadId.load())
+	{
+		return; //another click already replaced this one
+	}
+	auto prepared = std::make_unique<PreparedSource>();
+	prepared->mRequestId = requestId;
+	prepared->mSeek = seek;
+	prepared->mStart = start;
+	prepared->mChain = std::make_unique<PlaybackChain>();
+	PlaybackChain& chain = *prepared->mChain;
+	if (std::shared_ptr<const DecodedAudio> cached = mDecodedCache.get(file))
+	{
+		//no disk, no decoder
+		chain.mSampleRate = cached->mSampleRate;
+		chain.mSource.reset(new CachedAudioSource(cached));
+		publishPrepared(std::move(prepared));
+		return;
+	}
+	AudioFormatReader* reader = takePreloadedReader(file);
+	if (reader == nullptr)
+	{
+		reader = createReaderFor(formatManager, file);
+	}
+	if (reader == nullptr)
+	{
+		//unreadable, still tell the message thread so a pending play does not wait forever
+		prepared->mChain = nullptr;
+		publishPrepared(std::move(prepared));
+		return;
+	}
+	bool cacheable = isCacheable(*reader);
+	chain.mSampleRate = reader->sampleRate;
+	int64 lengthInSamples = reader->lengthInSamples;
+	chain.mReaderSource.reset(new AudioFormatReaderSource(reader, true));
+	//decode on the read-ahead thread so the audio thread never waits on the disk
+	chain.mReadAhead = new ReadAheadSource(chain.mReaderSource.get(), mReadAheadThread,
+		jmax(1024, AppValues::getInstance().PREVIEW_READ_AHEAD_SAMPLES), (int)reader->numChannels, mUnderrunCount);
+	chain.mSource.reset(chain.mReadAhead);
+	if (!cacheable && !seek)
+	{
+		std::shared_ptr<const AttackPrefix> prefix = mPrefixCache.load(file);
+		if (prefix != nullptr && prefix->mTotalLength == lengthInSamples)
+		{
+			//first sound comes from the prefix while the read-ahead thread buffers past it
+			chain.mSource.reset(new PrefixedAudioSource(prefix, std::move(chain.mReaderSource), std::move(chain.mSource)));
+		}
+		else
+		{
+			mPrefixCache.requestPrefix(file);
+		}
+	}
+	publishPrepared(std::move(prepared));
+	if (cacheable && !seek)
 	{
-		std::unique_ptr<AudioFormatReaderSource> newSource(new AudioFormatReaderSource(reader, true));
-		transportSource.setSource(newSource.get(), 0, nullptr, reader->sampleRate);
-		readerSource.reset(newSource.release());
+		//stream this time, replay from memory next time
+		mLoadPool.addJob([this, file]() { cacheDecodedSample(file); });
+	}
+}
+
+void AudioPlayer::publishPrepared(std::unique_ptr<PreparedSource> prepared)
+{
+	if (prepared->mChain != nullptr)
+	{
+		PlaybackChain& chain = *prepared->mChain;
+		chain.mLength = chain.mSource->getTotalLength();
+		chain.mSource->setNextReadPosition(prepared->mStart);
+		chain.mRateStage.reset(new TempoPitchSource(chain.mSource.get(), 2));
+		//allocations and the initial read-ahead fill happen here on the load pool, not on the message thread
+		prepareChain(chain);
+		if (prepared->mSeek && chain.mReadAhead != nullptr && chain.mPreparedBlockSize > 0)
+		{
+			//the preview is already silent waiting for this, start it on decoded audio rather than an underrun
+			AudioBuffer<float>* noBuffer = nullptr; //only the range is looked at
+			chain.mReadAhead->waitForNextAudioBlockReady(AudioSourceChannelInfo(noBuffer, 0, chain.mPreparedBlockSize), (uint32)SEEK_PREFILL_TIMEOUT_MS);
+		}
+	}
+	{
+		const ScopedLock sl(mLoadLock);
+		mReadySource = std::move(prepared);
+	}
+	triggerAsyncUpdate();
+}
+
+void AudioPlayer::cacheDecodedSample(const File& file)
+{
+	SAMPLORE_TRACE_ZONE("AudioPlayer::cacheDecodedSample");
+	if (mDecodedCache.contains(file))
+	{
+		return;
+	}
+	std::unique_ptr<AudioFormatReader> reader(createReaderFor(formatManager, file));
+	if (reader != nullptr && isCacheable(*reader))
+	{
+		mDecodedCache.put(file, DecodedSampleCache::decode(*reader));
+	}
+}
+
+int AudioPlayer::assignToDrumRack(Sample::Reference sample)
+{
+	if (sample.isNull())
+	{
+		return -1;
+	}
+	int pad = mSampler.claimNextPad();
+	mSampler.setMode(SamplerEngine::Mode::DrumRack);
+	File file = sample.getFile();
+	mLoadPool.addJob([this, file, pad]() { mSampler.setPadSound(pad, decodeForSampler(file)); });
+	return pad;
+}
+
+void AudioPlayer::setChromaticSample(Sample::Reference sample)
+{
+	if (sample.isNull())
+	{
+		return;
+	}
+	mSampler.setMode(SamplerEngine::Mode::Chromatic);
+	File file = sample.getFile();
+	mLoadPool.addJob([this, file]() { mSampler.setChromaticSound(decodeForSampler(file)); });
+}
+
+std::shared_ptr<const DecodedAudio> AudioPlayer::decodeForSampler(const File& file)
+{
+	mDecodedCache.setByteBudget((int64)AppValues::getInstance().PREVIEW_DECODED_CACHE_MB << 20);
+	if (std::shared_ptr<const DecodedAudio> cached = mDecodedCache.get(file))
+	{
+		return cached;
+	}
+	std::unique_ptr<AudioFormatReader> reader(createReaderFor(formatManager, file));
+	if (reader == nullptr)
+	{
+		return nullptr;
+	}
+	std::shared_ptr<const DecodedAudio> audio = DecodedSampleCache::decode(*reader);
+	if (isCacheable(*reader))
+	{
+		mDecodedCache.put(file, audio);
+	}
+	return audio;
+}
+
+bool AudioPlayer::isCacheable(const AudioFormatReader& reader) const
+{
+	if (reader.sampleRate <= 0.0)
+	{
+		return false;
+	}
+	double seconds = reader.lengthInSamples / reader.sampleRate;
+	int64 bytes = reader.lengthInSamples * (int64)reader.numChannels * (int64)sizeof(float);
+	return seconds <= AppValues::getInstance().PREVIEW_DECODED_CACHE_MAX_SECONDS && bytes <= mDecodedCache.getByteBudget();
+}
+
+void AudioPlayer::preloadReader(const File& file)
+{
+	SAMPLORE_TRACE_ZONE("AudioPlayer::preloadReader");
+	if (mDecodedCache.contains(file))
+	{
+		return;
+	}
+	{
+		const ScopedLock sl(mLoadLock);
+		for (const auto& preloaded : mPreloadedReaders)
+		{
+			if (preloaded.mFile == file)
+				return;
+		}
+	}
+	std::unique_ptr<AudioFormatReader> reader(createReaderFor(formatManager, file));
+	if (reader == nullptr)
+	{
+		return;
+	}
+	if (isCacheable(*reader))
+	{
+		//short enough to keep whole, the click will play it straight from memory
+		mDecodedCache.put(file, DecodedSampleCache::decode(*reader));
+		return;
+	}
+	//touch the start so the header, decoder state and first disk pages are warm
+	AudioBuffer<float> primer((int)reader->numChannels, (int)jmin((int64)4096, reader->lengthInSamples));
+	reader->read(&primer, 0, primer.getNumSamples(), 0, true, true);
+
+	const ScopedLock sl(mLoadLock);
+	mPreloadedReaders.push_back({ file, std::move(reader) });
+	while ((int)mPreloadedReaders.size() > AppValues::getInstance().PREVIEW_PRELOAD_NEIGHBOURS * 2 + 1)
+	{
+		mPreloadedReaders.erase(mPreloadedReaders.begin());
+	}
+}
+
+AudioFormatReader* AudioPlayer::takePreloadedReader(const File& file)
+{
+	const ScopedLock sl(mLoadLock);
+	for (auto it = mPreloadedReaders.begin(); it != mPreloadedReaders.end(); ++it)
+	{
+		if (it->mFile == file)
+		{
+			AudioFormatReader* reader = it->mReader.release();
+			mPreloadedReaders.erase(it);
+			return reader;
+		}
+	}
+	return nullptr;
+}
+
+void AudioPlayer::handleAsyncUpdate()
+{
+	std::unique_ptr<PreparedSource> prepared;
+	{
+		const ScopedLock sl(mLoadLock);
+		prepared = std::move(mReadySource);
+	}
+	if (prepared == nullptr || prepared->mRequestId != mLatestLoadId.load())
+	{
+		return;
+	}
+	if (prepared->mChain == nullptr)
+	{
+		//the previous file stops too, nothing is left that a play could start
+		mCurrentLength = 0;
+		mAudioPosition = 0;
+		mQueuedPosition = -1;
+		pushCommand(Command::Type::SwapSource);
+		stopTimer();
+		state = TransportState::Stopped;
+		mSourceReady = false;
+		mLoadFailed = true;
+		mPlayPending = false;
+		sendChangeMessage();
+		return;
+	}
+	PlaybackChain& chain = *prepared->mChain;
+	if (chain.mPreparedDeviceRate != mPreparedSampleRate.load() || chain.mPreparedBlockSize != mPreparedBlockSize.load())
+	{
+		prepareChain(chain); //the device changed while the pool was preparing it, rare
+	}
+	mCurrentLength = prepared->mChain->mLength;
+	if (prepared->mSeek)
+	{
+		pushCommand(Command::Type::SeekSource, prepared->mStart, prepared->mChain.release());
+		return;
+	}
+	mAudioPosition = 0;
+	mQueuedPosition = 0;
+	pushCommand(Command::Type::SwapSource, 0, prepared->mChain.release());
+	stopTimer();
+	state = TransportState::Stopped; //the new file starts stopped, like setSource on a transport did
+	mSourceReady = true;
+	if (mPlayPending)
+	{
+		mPlayPending = false;
+		playSample(mPendingPlayT);
 	}
 	sendChangeMessage();
 }
 
 void AudioPlayer::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
 {
-	transportSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
+	mPreparedBlockSize = samplesPerBlockExpected;
+	mPreparedSampleRate = sampleRate;
+	mLoadMeter.prepare(sampleRate);
+	mSampler.prepareToPlay(samplesPerBlockExpected, sampleRate);
+	//the callback is not running while the device prepares, so allocating here is fine
+	handleCommands();
+	if (mActiveChain != nullptr)
+	{
+		prepareChain(*mActiveChain);
+	}
 }
 
 
 void AudioPlayer::getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill)
 {
-	if (readerSource.get() == nullptr || state == TransportState::Stopped || transportSource.hasStreamFinished())
+	mTraceThread.bind();
+	SAMPLORE_TRACE_ZONE("AudioPlayer::getNextAudioBlock");
+	const int64 start = Time::getHighResolutionTicks();
+	handleCommands();
+	renderPreview(bufferToFill);
+	mSampler.renderNextBlock(*bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples);
+	mLoadMeter.addCallback(start, Time::getHighResolutionTicks(), bufferToFill.numSamples);
+	Tracer::counter("callback load", mLoadMeter.getLastLoad());
+}
+
+void AudioPlayer::renderPreview(const AudioSourceChannelInfo& bufferToFill)
+{
+	float gain = mGain.load();
+	if (mActiveChain == nullptr || !mPlaying || mSeeking)
 	{
 		bufferToFill.clearActiveBufferRegion();
+		mLastGain = gain;
 		return;
 	}
-	transportSource.getNextAudioBlock(bufferToFill) ;
+	mActiveChain->mRateStage->setSpeed(mSpeed.load(), mKeepPitch.load());
+	mActiveChain->mRateStage->setDraftQuality(mAdaptiveQuality.load() && mLoadMeter.wantsDraftQuality());
+	mActiveChain->mRateStage->getNextAudioBlock(bufferToFill);
+	bufferToFill.buffer->applyGainRamp(bufferToFill.startSample, bufferToFill.numSamples, mLastGain, gain);
+	mLastGain = gain;
+
+	//the rate stage holds audio read but not played yet, the position is what has been heard
+	PositionableAudioSource& source = *mActiveChain->mSource;
+	const int64 length = source.getTotalLength();
+	int64 heard = source.getNextReadPosition() - mActiveChain->mRateStage->getLatency();
+	if (source.isLooping() && length > 0)
+	{
+		heard = (heard % length + length) % length;
+	}
+	heard = jlimit((int64)0, jmax((int64)0, length), heard);
+	mAudioPosition = heard;
+	//past the end the sources read silence, so the tail drains before the preview stops
+	if (!source.isLooping() && heard >= length)
+	{
+		mPlaying = false;
+		mAudioPlaying = false;
+	}
 }
@@ -12,10 +12,21 @@
 #include "JuceHeader.h"
 
 #include "Sample.h"
+#include "DecodedSampleCache.h"
+#include "AttackPrefixCache.h"
+#include "SamplerEngine.h"
+#include "TempoPitchSource.h"
+#include "CallbackLoadMeter.h"
+#include "Tracer.h"
+
+#include <array>
 
 namespace samplore
 {
-	class AudioPlayer : public ChangeListener, public AudioSource, public ChangeBroadcaster
+	/// The message thread never touches what the audio thread is playing. Commands go over a
+	/// lock-free single producer/single consumer queue, state comes back through atomics and
+	/// replaced sources are freed on a background thread
+	class AudioPlayer : public AudioSource, public ChangeBroadcaster, private AsyncUpdater, private Timer
 	{
 	public:
 		enum class TransportState
@@ -50,12 +61,12 @@ namespace samplore
 		void playSample();
 		void playSample(float t);
 
-		void setVolumeMultiply(float gain)
-		{
-			transportSource.setGain(gain);
-		}
+		void setVolumeMultiply(float gain) { mGain = gain; mSampler.setGain(gain); }
+		/// Preview speed, 1 is normal. keepPitch changes only the tempo, otherwise pitch follows like tape
+		void setPlaybackSpeed(double speed, bool keepPitch) { mSpeed = speed; mKeepPitch = keepPitch; }
+		double getPlaybackSpeed() const { return mSpeed; }
+		bool isKeepingPitch() const { return mKeepPitch; }
 
-		void changeListenerCallback(ChangeBroadcaster* source) override;
 		void getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) override;
 		void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
 		void releaseResources() override;
@@ -63,23 +74,172 @@ namespace samplore
 		void setRelativeTime(double t);
 
 		Sample::Reference getSampleReference() { return mCurrentSample; }
-		float getRelativeTime() { return transportSource.getCurrentPosition() / transportSource.getLengthInSeconds(); }
+		float getRelativeTime();
 		float getStartCueRelative() { return mSampleStartT; }
 
 		void changeState(TransportState state);
 
+		/// Opens the file on a worker, playSample calls made before it is ready start once it is
 		void loadFile(Sample::Reference reference);
+		/// Opens and primes readers for samples likely to be auditioned next
+		void preloadSamples(const Array<Sample::Reference>& samples);
+		bool isSourceReady() const { return mSourceReady; }
+		/// The current sample could not be opened, nothing plays until another one is loaded
+		bool hasLoadFailed() const { return mLoadFailed; }
 
 		TransportState getState() { return state; }
 		AudioFormatManager* getFormatManager() { return &formatManager; }
+		/// Memory maps WAV and AIFF so reads convert straight from the page cache, other formats
+		/// fall back to the usual stream reader. Caller owns the result, nullptr if unreadable
+		static AudioFormatReader* createReaderFor(AudioFormatManager& formatManager, const File& file);
+
+		/// Blocks where the read-ahead thread had not decoded far enough, the audio thread got silence
+		int getUnderrunCount() const { return mUnderrunCount.load(); }
+		void resetUnderrunCount() { mUnderrunCount = 0; }
+		/// Callback time against buffer time, xruns, and whether the preview has gone to draft quality
+		const CallbackLoadMeter& getLoadMeter() const { return mLoadMeter; }
+		DecodedSampleCache& getDecodedCache() { return mDecodedCache; }
+		AttackPrefixCache& getPrefixCache() { return mPrefixCache; }
+
+		/// Decodes the sample on the load pool and puts it on the next free drum pad, returns the pad
+		int assignToDrumRack(Sample::Reference sample);
+		/// Decodes the sample on the load pool and switches the sampler to play it chromatically
+		void setChromaticSample(Sample::Reference sample);
+		/// Voices mixed in on top of the preview
+		SamplerEngine& getSampler() { return mSampler; }
 	private:
-		juce::Time mTimeSinceLoaded = juce::Time(0);
+		/// Counts blocks the read-ahead thread had not decoded in time, runs on the audio thread
+		class ReadAheadSource : public BufferingAudioSource
+		{
+		public:
+			ReadAheadSource(PositionableAudioSource* source, TimeSliceThread& thread, int bufferSize, int channels, std::atomic<int>& underruns)
+				: BufferingAudioSource(source, thread, false, bufferSize, channels), mUnderruns(underruns) {}
+			void getNextAudioBlock(const AudioSourceChannelInfo& info) override
+			{
+				if (!waitForNextAudioBlockReady(info, 0))
+					mUnderruns++; //the buffering source fills the gap with silence
+				BufferingAudioSource::getNextAudioBlock(info);
+			}
+		private:
+			std::atomic<int>& mUnderruns;
+		};
+
+		/// Everything the audio thread plays for one file, built and prepared on the load pool
+		struct PlaybackChain
+		{
+			std::unique_ptr<AudioFormatReaderSource> mReaderSource; //null when playing from the decoded cache
+			std::unique_ptr<PositionableAudioSource> mSource;
+			std::unique_ptr<TempoPitchSource> mRateStage; //file rate to device rate, speed and tempo
+			ReadAheadSource* mReadAhead = nullptr; //inside mSource, null when playing from the decoded cache
+			double mSampleRate = 0.0;
+			int64 mLength = 0;
+			double mPreparedDeviceRate = 0.0; //what prepareChain last used, zero until then
+			int mPreparedBlockSize = 0;
+		};
+
+		/// Everything the player needs to switch to a file, built off the message thread
+		struct PreparedSource
+		{
+			int mRequestId = 0;
+			std::unique_ptr<PlaybackChain> mChain; //nullptr if the file could not be opened
+			bool mSeek = false; //the file already playing, from mStart
+			int64 mStart = 0;
+		};
+		struct PreloadedReader
+		{
+			File mFile;
+			std::unique_ptr<AudioFormatReader> mReader;
+		};
+
+		struct Command
+		{
+			//Seek keeps the preview silent until the SeekSource the load pool repositioned arrives
+			enum class Type { Play, Stop, Seek, SwapSource, SeekSource };
+			Type mType = Type::Stop;
+			int64 mPosition = 0;
+			PlaybackChain* mChain = nullptr; //ownership moves to the audio thread with the command
+		};
+
+		/// Frees chains the audio thread is done with
+		class SourceRetirer : public Thread
+		{
+		public:
+			SourceRetirer(AudioPlayer& owner) : Thread("Preview Source Retirer"), mOwner(owner) {}
+			void run() override;
+		private:
+			AudioPlayer& mOwner;
+		};
+
+		void pushCommand(Command::Type type, int64 position = 0, PlaybackChain* chain = nullptr);
+		void handleCommands();
+		void renderPreview(const AudioSourceChannelInfo& bufferToFill);
+		void retireChain(PlaybackChain* chain);
+		void deleteRetiredChains();
+		void prepareChain(PlaybackChain& chain);
+
+		/// seek builds another chain for the file already loaded, starting at start
+		void prepareSource(const File& file, int requestId, bool seek, int64 start);
+		void publishPrepared(std::unique_ptr<PreparedSource> prepared);
+		void preloadReader(const File& file);
+		AudioFormatReader* takePreloadedReader(const File& file);
+		void cacheDecodedSample(const File& file);
+		std::shared_ptr<const DecodedAudio> decodeForSampler(const File& file);
+		bool isCacheable(const AudioFormatReader& reader) const;
+		void handleAsyncUpdate() override;
+		void timerCallback() override;
+
 		double mSampleStartT = 0.0f; //between 0 and 1
 		Sample::Reference mCurrentSample = nullptr;
 		AudioFormatManager formatManager;
-		std::unique_ptr<AudioFormatReaderSource> readerSource;
-		AudioTransportSource transportSource;
-		TransportState state;
+		AttackPrefixCache mPrefixCache { formatManager };
+		TimeSliceThread mReadAheadThread { "Preview Read-Ahead" };
+		std::atomic<int> mUnderrunCount { 0 };
+		TransportState state; //message thread only
+
+		//Message thread -> audio thread
+		static const int COMMAND_QUEUE_SIZE = 64;
+		static const int SEEK_PREFILL_TIMEOUT_MS = 200; //longest a seek waits on the load pool for the first block
+		AbstractFifo mCommandFifo { COMMAND_QUEUE_SIZE };
+		std::array<Command, COMMAND_QUEUE_SIZE> mCommands;
+		int mCommandsSent = 0;
+		std::atomic<float> mGain { 1.0f };
+		std::atomic<double> mSpeed { 1.0 };
+		std::atomic<bool> mKeepPitch { false };
+		int64 mCurrentLength = 0; //message thread copy of the swapped in chain's length
+		int64 mQueuedPosition = -1; //where the audio thread's newest chain starts, -1 once it has played
+
+		//Audio thread -> message thread
+		std::atomic<int> mCommandsHandled { 0 };
+		std::atomic<bool> mAudioPlaying { false };
+		std::atomic<int64> mAudioPosition { 0 };
+		std::atomic<int> mPreparedBlockSize { 0 };
+		std::atomic<double> mPreparedSampleRate { 0.0 };
+		std::atomic<bool> mAdaptiveQuality { true }; //off keeps the preview at full quality however loaded the callback is
+		CallbackLoadMeter mLoadMeter;
+		Tracer::ReservedThread mTraceThread { "Audio" }; //set up here, so tracing the callback never locks or allocates
+
+		//Audio thread only
+		PlaybackChain* mActiveChain = nullptr;
+		bool mPlaying = false;
+		bool mSeeking = false; //silent between a Seek and its SeekSource
+		float mLastGain = 1.0f;
+
+		//Audio thread -> retirer
+		AbstractFifo mRetireFifo { COMMAND_QUEUE_SIZE };
+		std::array<PlaybackChain*, COMMAND_QUEUE_SIZE> mRetired {};
+		SourceRetirer mRetirer { *this };
+
+		bool mSourceReady = false;
+		bool mLoadFailed = false;
+		bool mPlayPending = false;
+		float mPendingPlayT = 0.0f;
+		std::atomic<int> mLatestLoadId { 0 }; //workers drop loads and seeks that a newer one replaced
+		CriticalSection mLoadLock; //guards mReadySource and mPreloadedReaders
+		std::unique_ptr<PreparedSource> mReadySource;
+		std::vector<PreloadedReader> mPreloadedReaders; //oldest first
+		DecodedSampleCache mDecodedCache;
+		SamplerEngine mSampler;
+		ThreadPool mLoadPool { 2 };
 	};
 }
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,84 @@
+/*
+  ==============================================================================
+
+    LibraryGenerator.h
+    Synthetic sample libraries for the benchmarks, any size and folder shape
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+#include "TestHelpers.h"
+
+#include <vector>
+
+namespace LibraryGenerator
+{
+    struct Shape
+    {
+        int mFiles = 10000;
+        int mFilesPerFolder = 100;
+        int mBranching = 8; //child folders per folder, the tree fills breadth first
+        int mVariants = 16; //distinct sine pitches
+        int mSamplesPerFile = 256; //tiny bodies, the benchmarks measure the library and not the disk
+    };
+
+    /// Names cycle through these so text queries have realistic selectivity
+    inline const juce::StringArray& getWords()
+    {
+        static const juce::StringArray words { "kick", "snare", "hat", "clap", "tom", "perc", "bass", "lead",
+                                               "pad", "pluck", "vox", "fx", "chord", "loop", "riser", "sub" };
+        return words;
+    }
+
+    /// 16 bit mono WAV of a short sine, one per variant
+    inline juce::MemoryBlock makeWavBody(float frequency, int numSamples)
+    {
+        juce::AudioBuffer<float> buffer(1, numSamples);
+        TestHelpers::generateSineWave(buffer, frequency, 44100.0f);
+        buffer.applyGain(0.5f);
+
+        juce::MemoryBlock block;
+        juce::WavAudioFormat wav;
+        std::unique_ptr<juce::AudioFormatWriter> writer(wav.createWriterFor(new juce::MemoryOutputStream(block, false), 44100.0, 1, 16, {}, 0));
+        if (writer != nullptr)
+            writer->writeFromAudioSampleBuffer(buffer, 0, numSamples);
+        writer = nullptr; //flushes the header sizes
+        return block;
+    }
+
+    /// Writes shape.mFiles WAVs under root and returns how many were written
+    inline int generate(const juce::File& root, const Shape& shape)
+    {
+        std::vector<juce::MemoryBlock> bodies;
+        for (int v = 0; v < juce::jmax(1, shape.mVariants); v++)
+            bodies.push_back(makeWavBody(110.0f * std::pow(2.0f, v / 12.0f), shape.mSamplesPerFile));
+
+        const int perFolder = juce::jmax(1, shape.mFilesPerFolder);
+        const int folderCount = (shape.mFiles + perFolder - 1) / perFolder;
+        const juce::StringArray& words = getWords();
+        std::vector<juce::File> folders;
+        folders.reserve((size_t)folderCount);
+        int written = 0;
+        for (int f = 0; f < folderCount; f++)
+        {
+            //folder f hangs off folder (f - 1) / branching, the first is the root itself
+            const juce::File parent = f == 0 ? root : folders[(size_t)((f - 1) / juce::jmax(1, shape.mBranching))];
+            const juce::File folder = f == 0 ? root : parent.getChildFile(words[f % words.size()] + " pack " + juce::String(f));
+            folder.createDirectory();
+            folders.push_back(folder);
+            for (int i = f * perFolder; i < juce::jmin(shape.mFiles, (f + 1) * perFolder); i++)
+            {
+                //the last two samples carry the file number, every file has its own content hash
+                juce::MemoryBlock body = bodies[(size_t)i % bodies.size()];
+                if (body.getSize() >= 4)
+                    body.copyFrom(&i, body.getSize() - 4, 4);
+                if (folder.getChildFile(words[i % words.size()] + "_" + juce::String(i) + ".wav").replaceWithData(body.getData(), body.getSize()))
+                    written++;
+            }
+        }
+        return written;
+    }
+}
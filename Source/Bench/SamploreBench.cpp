@@ -0,0 +1,298 @@
+/*
+  ==============================================================================
+
+    SamploreBench.cpp
+    Times the library's hot paths on a synthetic tree and prints the results
+    as JSON, so runs can be compared across commits
+
+    usage: SamploreBench [--files N] [--per-folder N] [--branching N]
+                         [--thumbnails N] [--tagged 0.1] [--repeats N]
+                         [--root dir] [--keep] [--out results.json]
+
+  ==============================================================================
+*/
+
+#include "JuceHeader.h"
+#include "LibraryGenerator.h"
+#include "SampleLibrary.h"
+#include "SampleAudioThumbnail.h"
+#include "AudioPlayer.h"
+#include "SamplerEngine.h"
+
+#include <algorithm>
+#include <iostream>
+
+using namespace samplore;
+
+namespace
+{
+    struct Options
+    {
+        LibraryGenerator::Shape mShape;
+        juce::File mRoot; //generated and deleted unless given
+        juce::File mOutput; //stdout when empty
+        bool mKeep = false;
+        int mThumbnails = 200;
+        float mTaggedFraction = 0.1f;
+        int mRepeats = 5;
+        juce::String mTypedQuery = "snare 12"; //timed one keystroke at a time
+    };
+
+    double now() { return juce::Time::getMillisecondCounterHiRes(); }
+
+    double median(std::vector<double> values)
+    {
+        if (values.empty())
+            return 0.0;
+        std::sort(values.begin(), values.end());
+        return values[values.size() / 2];
+    }
+
+    /// Runs body repeats times, median milliseconds
+    template <typename Body>
+    double timeMedian(int repeats, Body body)
+    {
+        std::vector<double> times;
+        for (int r = 0; r < juce::jmax(1, repeats); r++)
+        {
+            const double start = now();
+            body();
+            times.push_back(now() - start);
+        }
+        return median(times);
+    }
+
+    bool parse(const juce::StringArray& args, Options& options)
+    {
+        for (int i = 0; i < args.size(); i++)
+        {
+            const juce::String arg = args[i];
+            const juce::String value = args[i + 1];
+            if (arg == "--keep")
+                options.mKeep = true;
+            else if (i + 1 >= args.size())
+                return false;
+            else if (arg == "--files")
+                options.mShape.mFiles = juce::jmax(1, value.getIntValue());
+            else if (arg == "--per-folder")
+                options.mShape.mFilesPerFolder = juce::jmax(1, value.getIntValue());
+            else if (arg == "--branching")
+                options.mShape.mBranching = juce::jmax(1, value.getIntValue());
+            else if (arg == "--thumbnails")
+                options.mThumbnails = juce::jmax(0, value.getIntValue());
+            else if (arg == "--tagged")
+                options.mTaggedFraction = juce::jlimit(0.0f, 1.0f, value.getFloatValue());
+            else if (arg == "--repeats")
+                options.mRepeats = juce::jmax(1, value.getIntValue());
+            else if (arg == "--root")
+                options.mRoot = juce::File::getCurrentWorkingDirectory().getChildFile(value);
+            else if (arg == "--out")
+                options.mOutput = juce::File::getCurrentWorkingDirectory().getChildFile(value);
+            else
+                return false;
+            if (arg != "--keep")
+                i++;
+        }
+        return true;
+    }
+
+    juce::var thumbnailThroughput(const Sample::List& samples, int count)
+    {
+        //as Sample::Reference::generateThumbnailAndCache does it, a cache per thumbnail
+        juce::AudioFormatManager formats;
+        formats.registerBasicFormats();
+        count = juce::jmin(count, samples.size());
+        std::vector<std::unique_ptr<juce::AudioThumbnailCache>> caches;
+        std::vector<std::unique_ptr<SampleAudioThumbnail>> thumbnails;
+        const double start = now();
+        for (int i = 0; i < count; i++)
+        {
+            juce::AudioFormatReader* reader = AudioPlayer::createReaderFor(formats, samples[i].getFile());
+            if (reader == nullptr)
+                continue;
+            caches.push_back(std::make_unique<juce::AudioThumbnailCache>(1));
+            thumbnails.push_back(std::make_unique<SampleAudioThumbnail>(512, formats, *caches.back()));
+            thumbnails.back()->setReader(reader, i);
+        }
+        const double deadline = now() + 60000.0;
+        while (now() < deadline && std::any_of(thumbnails.begin(), thumbnails.end(), [](const auto& t) { return !t->isFullyLoaded(); }))
+            juce::Thread::sleep(1);
+        const double ms = now() - start;
+
+        juce::DynamicObject::Ptr result = new juce::DynamicObject();
+        result->setProperty("count", (int)thumbnails.size());
+        result->setProperty("ms", ms);
+        result->setProperty("perSecond", ms > 0.0 ? thumbnails.size() * 1000.0 / ms : 0.0);
+        return result.get();
+    }
+
+    juce::var samplerRender(int repeats)
+    {
+        //every voice resamples, a 44.1kHz sound on a 48kHz device spread over two octaves
+        const double deviceRate = 48000.0;
+        const int blockSize = 256;
+        const int blocks = (int)(deviceRate / blockSize); //a second of audio
+        auto audio = std::make_shared<DecodedAudio>();
+        audio->mSampleRate = 44100.0;
+        audio->mBuffer.setSize(2, 44100 * 4);
+        juce::Random random(1);
+        for (int ch = 0; ch < 2; ch++)
+            for (int i = 0; i < audio->mBuffer.getNumSamples(); i++)
+                audio->mBuffer.setSample(ch, i, random.nextFloat() * 2.0f - 1.0f);
+
+        juce::AudioBuffer<float> output(2, blockSize);
+        int voices = 0;
+        std::vector<double> times;
+        for (int r = 0; r < juce::jmax(1, repeats); r++)
+        {
+            SamplerEngine engine;
+            engine.setMode(SamplerEngine::Mode::Chromatic);
+            engine.setChromaticSound(audio);
+            engine.prepareToPlay(blockSize, deviceRate);
+            for (int v = 0; v < SamplerEngine::MAX_POLYPHONY; v++)
+                engine.noteOn(v % 24 - 12, 0.5f);
+            const double start = now();
+            for (int b = 0; b < blocks; b++)
+            {
+                output.clear();
+                engine.renderNextBlock(output, 0, blockSize);
+            }
+            times.push_back(now() - start);
+            voices = engine.getActiveVoiceCount();
+        }
+        const double ms = median(times);
+
+        juce::DynamicObject::Ptr result = new juce::DynamicObject();
+        result->setProperty("voices", voices);
+        result->setProperty("msPerSecond", ms);
+        result->setProperty("realtimeFactor", ms > 0.0 ? 1000.0 / ms : 0.0);
+        return result.get();
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser; //the library's timers and broadcasters need a message manager
+    juce::StringArray args;
+    for (int i = 1; i < argc; i++)
+        args.add(argv[i]);
+    Options options;
+    if (!parse(args, options))
+    {
+        std::cerr << "usage: SamploreBench [--files N] [--per-folder N] [--branching N] [--thumbnails N] "
+                     "[--tagged 0.1] [--repeats N] [--root dir] [--keep] [--out results.json]" << std::endl;
+        return 2;
+    }
+
+    //metadata and the analysis log go to a scratch folder, the app's own stay untouched
+    const juce::File scratch = TestHelpers::createTempDirectory();
+    const bool generateRoot = options.mRoot == juce::File();
+    const juce::File root = generateRoot ? scratch.getChildFile("library") : options.mRoot;
+    const juce::File storeFile = scratch.getChildFile("analysis.log");
+    Sample::getPropertiesFolder() = scratch.getChildFile("SampleProperties");
+    juce::AudioFormatManager formats;
+    formats.registerBasicFormats();
+    SampleDirectory::getWildcard() = formats.getWildcardForAllFormats();
+
+    juce::DynamicObject::Ptr results = new juce::DynamicObject();
+    juce::DynamicObject::Ptr shape = new juce::DynamicObject();
+    shape->setProperty("files", options.mShape.mFiles);
+    shape->setProperty("filesPerFolder", options.mShape.mFilesPerFolder);
+    shape->setProperty("branching", options.mShape.mBranching);
+    results->setProperty("shape", shape.get());
+    results->setProperty("version", ProjectInfo::versionString);
+
+    if (generateRoot || !root.isDirectory())
+    {
+        root.createDirectory();
+        const double start = now();
+        const int written = LibraryGenerator::generate(root, options.mShape);
+        results->setProperty("generateMs", now() - start);
+        std::cerr << "generated " << written << " files in " << root.getFullPathName() << std::endl;
+    }
+
+    //the directory tree alone, then through the library with its snapshot
+    results->setProperty("treeConstructionMs", timeMedian(options.mRepeats, [&] { SampleDirectory tree(root); }));
+    auto library = std::make_unique<SampleLibrary>(false, storeFile);
+    double start = now();
+    library->addDirectory(root);
+    results->setProperty("libraryLoadMs", now() - start);
+    results->setProperty("samples", library->getSnapshot()->size());
+    results->setProperty("rescanMs", timeMedian(options.mRepeats, [&] { library->getDirectories().front()->rescanFiles(); }));
+
+    //what the search box runs after every keystroke, nothing cached
+    juce::Array<juce::var> keystrokes;
+    std::vector<double> keystrokeTimes;
+    for (int length = 1; length <= options.mTypedQuery.length(); length++)
+    {
+        const juce::String query = options.mTypedQuery.substring(0, length);
+        int matches = 0;
+        const double ms = timeMedian(options.mRepeats, [&] { matches = library->getAllSamplesInDirectories(query, false).size(); });
+        juce::DynamicObject::Ptr keystroke = new juce::DynamicObject();
+        keystroke->setProperty("query", query);
+        keystroke->setProperty("ms", ms);
+        keystroke->setProperty("matches", matches);
+        keystrokes.add(keystroke.get());
+        keystrokeTimes.push_back(ms);
+    }
+    results->setProperty("keystrokes", keystrokes);
+    results->setProperty("keystrokeMedianMs", median(keystrokeTimes));
+
+    juce::DynamicObject::Ptr sorts = new juce::DynamicObject();
+    for (SortingMethod method : { SortingMethod::Newest, SortingMethod::Random, SortingMethod::Tempo, SortingMethod::Key })
+    {
+        std::vector<double> times;
+        for (int r = 0; r < options.mRepeats; r++)
+        {
+            Sample::List all = library->getAllSamplesInDirectories("", true);
+            const double sortStart = now();
+            all.sort(method);
+            times.push_back(now() - sortStart);
+        }
+        sorts->setProperty(juce::Identifier(sortingNames[(size_t)method]), median(times));
+    }
+    results->setProperty("sortMs", sorts.get());
+
+    //every nth sample gets a tag, saved to its metadata file when the library goes
+    Sample::List all = library->getAllSamplesInDirectories("", true);
+    const int tagged = juce::roundToInt(all.size() * options.mTaggedFraction);
+    const int step = tagged > 0 ? juce::jmax(1, all.size() / tagged) : 0;
+    start = now();
+    for (int i = 0; step > 0 && i < all.size(); i += step)
+        all[i].addTag("bench");
+    juce::DynamicObject::Ptr tags = new juce::DynamicObject();
+    tags->setProperty("tagged", tagged);
+    tags->setProperty("taggingMs", now() - start);
+    int tagMatches = 0;
+    tags->setProperty("filterMs", timeMedian(options.mRepeats, [&] { tagMatches = library->getAllSamplesInDirectories("#bench", true).size(); }));
+    tags->setProperty("filterAndTextMs", timeMedian(options.mRepeats, [&] { library->getAllSamplesInDirectories("#bench kick", true).size(); }));
+    tags->setProperty("matches", tagMatches);
+    results->setProperty("tags", tags.get());
+
+    results->setProperty("thumbnails", thumbnailThroughput(all, options.mThumbnails));
+    results->setProperty("sampler", samplerRender(options.mRepeats));
+
+    //dropping the library writes the tagged samples' metadata and the library index, building it again restores from the index
+    juce::DynamicObject::Ptr metadata = new juce::DynamicObject();
+    all = Sample::List();
+    start = now();
+    library = nullptr;
+    metadata->setProperty("saveMs", now() - start);
+    start = now();
+    library = std::make_unique<SampleLibrary>(false, storeFile);
+    library->addDirectory(root);
+    metadata->setProperty("loadMs", now() - start);
+    metadata->setProperty("tagsLoaded", library->getAllSamplesInDirectories("#bench", true).size());
+    results->setProperty("metadata", metadata.get());
+    library = nullptr;
+
+    const juce::String json = juce::JSON::toString(juce::var(results.get()));
+    if (options.mOutput == juce::File())
+        std::cout << json << std::endl;
+    else
+        options.mOutput.replaceWithText(json);
+
+    if (!options.mKeep)
+        scratch.deleteRecursively();
+    return 0;
+}
@@ -0,0 +1,167 @@
+/*
+  ==============================================================================
+
+    CallbackLoadMeter.h
+    Author:  Jake Rose
+
+	Times audio callbacks against the time their buffer lasts. A load of 1
+	means the callback took the whole buffer period and the device ran dry.
+	Written by the audio thread only, read from anywhere without locking.
+	Also decides when the preview should drop to draft quality, early
+	enough that it does so before the audio glitches.
+
+  ==============================================================================
+*/
+
+#ifndef CALLBACKLOADMETER_H
+#define CALLBACKLOADMETER_H
+
+#include "JuceHeader.h"
+
+#include <atomic>
+#include <thread>
+
+namespace samplore
+{
+	class CallbackLoadMeter
+	{
+	public:
+		struct Stats
+		{
+			float mMin = 0.0f;
+			float mMean = 0.0f;
+			float mMax = 0.0f;
+		};
+
+		static const int WINDOW_CALLBACKS = 32; //about a third of a second at 512 samples and 48kHz
+		static constexpr float DRAFT_ENTER_LOAD = 0.7f; //a window peaking here goes to draft
+		static constexpr float DRAFT_LEAVE_LOAD = 0.35f; //every peak under this for RECOVER_WINDOWS goes back
+		static const int RECOVER_WINDOWS = 6;
+		static constexpr double LATE_CALLBACK_PERIODS = 1.5; //a gap this long between callbacks is a missed buffer...
+		static constexpr float LATE_CALLBACK_LOAD = 0.5f; //...if a callback either side took this much, bursty drivers leave gaps on their own
+
+		/// Before the first callback, forgets the previous device's timing
+		void prepare(double sampleRate)
+		{
+			mSampleRate = sampleRate;
+			mLastStart = -1;
+			resetWindow();
+			mCalmWindows = 0;
+		}
+
+		/// Audio thread, once per callback with when it started and finished
+		void addCallback(int64 startTicks, int64 endTicks, int numSamples)
+		{
+			if (mSampleRate <= 0.0 || numSamples <= 0)
+			{
+				return;
+			}
+			const double period = numSamples / mSampleRate;
+			const float load = (float)(Time::highResolutionTicksToSeconds(endTicks - startTicks) / period);
+			bool xrun = load >= 1.0f;
+			if (mLastStart >= 0 && Time::highResolutionTicksToSeconds(startTicks - mLastStart) > mLastPeriod * LATE_CALLBACK_PERIODS
+				&& jmax(load, mLastLoad.load(std::memory_order_relaxed)) >= LATE_CALLBACK_LOAD)
+			{
+				xrun = true; //short of time and late as well, a buffer went out late or not at all
+			}
+			mLastStart = startTicks;
+			mLastPeriod = period;
+			mLastLoad.store(load, std::memory_order_relaxed);
+			if (xrun)
+			{
+				mXruns.fetch_add(1, std::memory_order_relaxed);
+				mWindowXrun = true;
+			}
+
+			mWindowMin = jmin(mWindowMin, load);
+			mWindowMax = jmax(mWindowMax, load);
+			mWindowSum += load;
+			if (++mWindowCount >= WINDOW_CALLBACKS)
+			{
+				publishWindow();
+			}
+		}
+
+		float getLastLoad() const { return mLastLoad.load(std::memory_order_relaxed); }
+		int getXrunCount() const { return mXruns.load(std::memory_order_relaxed); }
+		void resetXrunCount() { mXruns = 0; }
+		bool wantsDraftQuality() const { return mDraft.load(std::memory_order_relaxed); }
+
+		/// Min, mean and max load over the last full window
+		Stats getStats() const
+		{
+			Stats stats;
+			for (;;)
+			{
+				const int sequence = mSequence.load(std::memory_order_acquire);
+				if ((sequence & 1) == 0)
+				{
+					stats.mMin = mMin.load(std::memory_order_relaxed);
+					stats.mMean = mMean.load(std::memory_order_relaxed);
+					stats.mMax = mMax.load(std::memory_order_relaxed);
+					std::atomic_thread_fence(std::memory_order_acquire);
+					if (mSequence.load(std::memory_order_relaxed) == sequence)
+						return stats;
+				}
+				std::this_thread::yield(); //the audio thread is between its two writes
+			}
+		}
+	private:
+		void publishWindow()
+		{
+			//odd while writing, readers retry until they see the same even value either side
+			const int sequence = mSequence.load(std::memory_order_relaxed);
+			mSequence.store(sequence + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			mMin.store(mWindowMin, std::memory_order_relaxed);
+			mMean.store(mWindowSum / mWindowCount, std::memory_order_relaxed);
+			mMax.store(mWindowMax, std::memory_order_relaxed);
+			mSequence.store(sequence + 2, std::memory_order_release);
+
+			if (mWindowXrun || mWindowMax >= DRAFT_ENTER_LOAD)
+			{
+				mDraft.store(true, std::memory_order_relaxed);
+				mCalmWindows = 0;
+			}
+			else if (mWindowMax < DRAFT_LEAVE_LOAD && ++mCalmWindows >= RECOVER_WINDOWS)
+			{
+				mDraft.store(false, std::memory_order_relaxed);
+			}
+			else if (mWindowMax >= DRAFT_LEAVE_LOAD)
+			{
+				mCalmWindows = 0;
+			}
+			resetWindow();
+		}
+
+		void resetWindow()
+		{
+			mWindowMin = 1.0e9f;
+			mWindowMax = 0.0f;
+			mWindowSum = 0.0f;
+			mWindowCount = 0;
+			mWindowXrun = false;
+		}
+
+		//audio thread only
+		double mSampleRate = 0.0;
+		int64 mLastStart = -1;
+		double mLastPeriod = 0.0;
+		float mWindowMin = 1.0e9f;
+		float mWindowMax = 0.0f;
+		float mWindowSum = 0.0f;
+		int mWindowCount = 0;
+		bool mWindowXrun = false;
+		int mCalmWindows = 0;
+
+		//published
+		std::atomic<float> mLastLoad { 0.0f };
+		std::atomic<int> mXruns { 0 };
+		std::atomic<bool> mDraft { false };
+		std::atomic<int> mSequence { 0 };
+		std::atomic<float> mMin { 0.0f };
+		std::atomic<float> mMean { 0.0f };
+		std::atomic<float> mMax { 0.0f };
+	};
+}
+#endif
@@ -0,0 +1,196 @@
+/*
+  ==============================================================================
+
+    ContentHash.h
+    Author:  Jake Rose
+
+	Durable identity of a sample file. Metadata, thumbnails and analysis are
+	kept under it, so renaming or moving a file, or reorganising a whole
+	drive, finds them again. xxHash64 over the audio payload only, so a tag
+	editor rewriting WAV or AIFF metadata chunks does not change it. Every
+	byte of the payload is read, two takes that only differ in the middle
+	must not share tags. The fast path is the AnalysisStore, which answers
+	for files unchanged in size and date without reading them. Any thread.
+
+  ==============================================================================
+*/
+
+#ifndef CONTENTHASH_H
+#define CONTENTHASH_H
+
+#include "JuceHeader.h"
+
+#include <cstring>
+
+/// Streaming xxHash64 (Yann Collet), matches the reference for the same bytes and seed
+class XxHash64
+{
+public:
+	explicit XxHash64(uint64 seed = 0)
+	{
+		mLanes[0] = seed + PRIME1 + PRIME2;
+		mLanes[1] = seed + PRIME2;
+		mLanes[2] = seed;
+		mLanes[3] = seed - PRIME1;
+		mSeed = seed;
+	}
+
+	void update(const void* data, size_t size)
+	{
+		const uint8* bytes = static_cast<const uint8*>(data);
+		mTotal += size;
+		if (mBuffered + size < STRIPE)
+		{
+			std::memcpy(mBuffer + mBuffered, bytes, size);
+			mBuffered += size;
+			return;
+		}
+		if (mBuffered > 0)
+		{
+			const size_t fill = STRIPE - mBuffered;
+			std::memcpy(mBuffer + mBuffered, bytes, fill);
+			consumeStripe(mBuffer);
+			bytes += fill;
+			size -= fill;
+			mBuffered = 0;
+		}
+		for (; size >= STRIPE; bytes += STRIPE, size -= STRIPE)
+		{
+			consumeStripe(bytes);
+		}
+		std::memcpy(mBuffer, bytes, size);
+		mBuffered = size;
+	}
+
+	uint64 digest() const
+	{
+		uint64 hash;
+		if (mTotal >= STRIPE)
+		{
+			hash = rotate(mLanes[0], 1) + rotate(mLanes[1], 7) + rotate(mLanes[2], 12) + rotate(mLanes[3], 18);
+			for (uint64 lane : mLanes)
+				hash = (hash ^ round(0, lane)) * PRIME1 + PRIME4;
+		}
+		else
+		{
+			hash = mSeed + PRIME5;
+		}
+		hash += (uint64)mTotal;
+
+		const uint8* tail = mBuffer;
+		size_t left = mBuffered;
+		for (; left >= 8; tail += 8, left -= 8)
+			hash = rotate(hash ^ round(0, read64(tail)), 27) * PRIME1 + PRIME4;
+		if (left >= 4)
+		{
+			hash = rotate(hash ^ (read32(tail) * PRIME1), 23) * PRIME2 + PRIME3;
+			tail += 4;
+			left -= 4;
+		}
+		for (; left > 0; tail++, left--)
+			hash = rotate(hash ^ (*tail * PRIME5), 11) * PRIME1;
+
+		hash ^= hash >> 33;
+		hash *= PRIME2;
+		hash ^= hash >> 29;
+		hash *= PRIME3;
+		hash ^= hash >> 32;
+		return hash;
+	}
+
+	static uint64 hash(const void* data, size_t size, uint64 seed = 0)
+	{
+		XxHash64 hasher(seed);
+		hasher.update(data, size);
+		return hasher.digest();
+	}
+private:
+	static const size_t STRIPE = 32;
+	static constexpr uint64 PRIME1 = 0x9E3779B185EBCA87ULL;
+	static constexpr uint64 PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+	static constexpr uint64 PRIME3 = 0x165667B19E3779F9ULL;
+	static constexpr uint64 PRIME4 = 0x85EBCA77C2B2AE63ULL;
+	static constexpr uint64 PRIME5 = 0x27D4EB2F165667C5ULL;
+
+	static uint64 rotate(uint64 value, int bits) { return (value << bits) | (value >> (64 - bits)); }
+	static uint64 round(uint64 lane, uint64 input) { return rotate(lane + input * PRIME2, 31) * PRIME1; }
+	static uint64 read64(const uint8* bytes) { return ByteOrder::littleEndianInt64(bytes); }
+	static uint64 read32(const uint8* bytes) { return ByteOrder::littleEndianInt(bytes); }
+
+	void consumeStripe(const uint8* bytes)
+	{
+		for (int i = 0; i < 4; i++)
+			mLanes[i] = round(mLanes[i], read64(bytes + i * 8));
+	}
+
+	uint64 mLanes[4];
+	uint64 mSeed = 0;
+	uint8 mBuffer[STRIPE] = {};
+	size_t mBuffered = 0;
+	size_t mTotal = 0;
+};
+
+class ContentHash
+{
+public:
+	/// Read buffer size
+	static const int BLOCK_SIZE = 64 * 1024;
+
+	/// Zero if the file cannot be read
+	static uint64 compute(const File& file)
+	{
+		FileInputStream in(file);
+		if (in.failedToOpen())
+			return 0;
+		const int64 fileSize = in.getTotalLength();
+		Range<int64> payload = findAudioPayload(in, fileSize);
+
+		XxHash64 hasher;
+		const int64 size = payload.getLength();
+		hasher.update(&size, sizeof(size));
+		HeapBlock<char> block(BLOCK_SIZE);
+		in.setPosition(payload.getStart());
+		for (int64 left = size; left > 0;)
+		{
+			const int read = in.read(block, (int)jmin((int64)BLOCK_SIZE, left));
+			if (read <= 0)
+				break;
+			hasher.update(block, (size_t)read);
+			left -= read;
+		}
+		const uint64 hash = hasher.digest();
+		return hash != 0 ? hash : 1; //zero means unknown
+	}
+
+	/// The sample data chunk of a WAV or AIFF file, the whole file for anything else
+	static Range<int64> findAudioPayload(InputStream& in, int64 fileSize)
+	{
+		const Range<int64> whole(0, fileSize);
+		char header[12];
+		in.setPosition(0);
+		if (in.read(header, 12) != 12)
+			return whole;
+		const bool riff = std::memcmp(header, "RIFF", 4) == 0 && std::memcmp(header + 8, "WAVE", 4) == 0;
+		const bool form = std::memcmp(header, "FORM", 4) == 0
+			&& (std::memcmp(header + 8, "AIFF", 4) == 0 || std::memcmp(header + 8, "AIFC", 4) == 0);
+		if (!riff && !form)
+			return whole;
+
+		int64 position = 12;
+		while (position + 8 <= fileSize)
+		{
+			char id[4];
+			in.setPosition(position);
+			if (in.read(id, 4) != 4)
+				break;
+			const int64 length = riff ? (int64)(uint32)in.readInt() : (int64)(uint32)in.readIntBigEndian();
+			const int64 start = position + 8;
+			if (std::memcmp(id, riff ? "data" : "SSND", 4) == 0)
+				return Range<int64>(start, jmin(fileSize, start + length));
+			position = start + length + (length & 1); //chunks are padded to even sizes
+		}
+		return whole;
+	}
+};
+
+#endif
@@ -0,0 +1,94 @@
+#include "DecodedSampleCache.h"
+
+using namespace samplore;
+
+std::shared_ptr<const DecodedAudio> DecodedSampleCache::get(const File& file)
+{
+	const ScopedLock sl(mLock);
+	String key = file.getFullPathName();
+	for (auto it = mEntries.begin(); it != mEntries.end(); ++it)
+	{
+		if (it->mKey == key)
+		{
+			mEntries.splice(mEntries.begin(), mEntries, it);
+			mHits++;
+			return mEntries.front().mAudio;
+		}
+	}
+	mMisses++;
+	return nullptr;
+}
+
+void DecodedSampleCache::put(const File& file, std::shared_ptr<const DecodedAudio> audio)
+{
+	if (audio == nullptr || audio->getSizeInBytes() > mByteBudget)
+	{
+		return;
+	}
+	const ScopedLock sl(mLock);
+	String key = file.getFullPathName();
+	for (auto it = mEntries.begin(); it != mEntries.end(); ++it)
+	{
+		if (it->mKey == key)
+		{
+			mBytesUsed -= it->mAudio->getSizeInBytes();
+			mEntries.erase(it);
+			break;
+		}
+	}
+	mEntries.push_front({ key, audio });
+	mBytesUsed += audio->getSizeInBytes();
+	evictToBudget();
+}
+
+bool DecodedSampleCache::contains(const File& file)
+{
+	const ScopedLock sl(mLock);
+	String key = file.getFullPathName();
+	for (const auto& entry : mEntries)
+	{
+		if (entry.mKey == key)
+			return true;
+	}
+	return false;
+}
+
+void DecodedSampleCache::clear()
+{
+	const ScopedLock sl(mLock);
+	mEntries.clear();
+	mBytesUsed = 0;
+}
+
+void DecodedSampleCache::setByteBudget(int64 byteBudget)
+{
+	const ScopedLock sl(mLock);
+	mByteBudget = byteBudget;
+	evictToBudget();
+}
+
+void DecodedSampleCache::evictToBudget()
+{
+	while (mBytesUsed > mByteBudget && !mEntries.empty())
+	{
+		//sources still playing an evicted buffer hold their own reference
+		mBytesUsed -= mEntries.back().mAudio->getSizeInBytes();
+		mEntries.pop_back();
+	}
+}
+
+std::shared_ptr<const DecodedAudio> DecodedSampleCache::decode(AudioFormatReader& reader)
+{
+	if (reader.lengthInSamples <= 0 || reader.lengthInSamples > std::numeric_limits<int>::max())
+	{
+		return nullptr;
+	}
+	auto audio = std::make_shared<DecodedAudio>();
+	audio->mSampleRate = reader.sampleRate;
+	audio->mBuffer.setSize((int)reader.numChannels, (int)reader.lengthInSamples);
+	if (!reader.read(&audio->mBuffer, 0, (int)reader.lengthInSamples, 0, true, true))
+	{
+		return nullptr;
+	}
+	return audio;
+}
@@ -0,0 +1,120 @@
+/*
+  ==============================================================================
+
+    DecodedSampleCache.h
+    Author:  Jake Rose
+
+	Fully decoded short samples kept in RAM, least recently used dropped first
+	once the byte budget is exceeded. Replaying a cached drum needs no disk or
+	decoder at all.
+
+  ==============================================================================
+*/
+
+#ifndef DECODEDSAMPLECACHE_H
+#define DECODEDSAMPLECACHE_H
+
+#include "JuceHeader.h"
+
+#include <list>
+
+namespace samplore
+{
+	struct DecodedAudio
+	{
+		AudioBuffer<float> mBuffer;
+		double mSampleRate = 0.0;
+
+		int64 getSizeInBytes() const { return (int64)mBuffer.getNumChannels() * mBuffer.getNumSamples() * sizeof(float); }
+	};
+
+	/// Plays a cached buffer, keeping it alive even if the cache evicts it meanwhile.
+	/// Mono goes to every output channel, and the position runs past the end like
+	/// a reader source's does so the player can tell playback has finished.
+	class CachedAudioSource : public PositionableAudioSource
+	{
+	public:
+		CachedAudioSource(std::shared_ptr<const DecodedAudio> audio) : mAudio(std::move(audio)) {}
+
+		void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override {}
+		void releaseResources() override {}
+		void getNextAudioBlock(const AudioSourceChannelInfo& info) override
+		{
+			const AudioBuffer<float>& source = mAudio->mBuffer;
+			const int64 length = source.getNumSamples();
+			const int sourceChannels = source.getNumChannels();
+			for (int done = 0; done < info.numSamples;)
+			{
+				if (mLooping && length > 0)
+				{
+					mPosition %= length;
+				}
+				const int count = sourceChannels > 0 ? (int)jlimit((int64)0, (int64)(info.numSamples - done), length - mPosition) : 0;
+				if (count == 0)
+				{
+					for (int ch = 0; ch < info.buffer->getNumChannels(); ch++)
+						info.buffer->clear(ch, info.startSample + done, info.numSamples - done);
+					mPosition += info.numSamples - done;
+					break;
+				}
+				for (int ch = 0; ch < info.buffer->getNumChannels(); ch++)
+					info.buffer->copyFrom(ch, info.startSample + done, source, ch % sourceChannels, (int)mPosition, count);
+				mPosition += count;
+				done += count;
+			}
+		}
+
+		void setNextReadPosition(int64 newPosition) override { mPosition = jmax((int64)0, newPosition); }
+		int64 getNextReadPosition() const override
+		{
+			const int64 length = getTotalLength();
+			return mLooping && length > 0 ? mPosition % length : mPosition;
+		}
+		int64 getTotalLength() const override { return mAudio->mBuffer.getNumSamples(); }
+		bool isLooping() const override { return mLooping; }
+		void setLooping(bool shouldLoop) override { mLooping = shouldLoop; }
+	private:
+		std::shared_ptr<const DecodedAudio> mAudio;
+		int64 mPosition = 0;
+		bool mLooping = false;
+	};
+
+	/// Safe to use from any thread
+	class DecodedSampleCache
+	{
+	public:
+		DecodedSampleCache(int64 byteBudget) : mByteBudget(byteBudget) {}
+
+		/// Returns nullptr on a miss, a hit becomes most recently used
+		std::shared_ptr<const DecodedAudio> get(const File& file);
+		void put(const File& file, std::shared_ptr<const DecodedAudio> audio);
+		bool contains(const File& file);
+		void clear();
+
+		void setByteBudget(int64 byteBudget);
+		int64 getByteBudget() const { return mByteBudget; }
+		int64 getBytesUsed() const { return mBytesUsed; }
+		int getHitCount() const { return mHits; }
+		int getMissCount() const { return mMisses; }
+
+		/// Reads the whole file, nullptr if it can't be read
+		static std::shared_ptr<const DecodedAudio> decode(AudioFormatReader& reader);
+	private:
+		struct Entry
+		{
+			String mKey;
+			std::shared_ptr<const DecodedAudio> mAudio;
+		};
+		void evictToBudget();
+
+		CriticalSection mLock;
+		std::list<Entry> mEntries; //front is most recently used
+		std::atomic<int64> mByteBudget;
+		std::atomic<int64> mBytesUsed { 0 };
+		std::atomic<int> mHits { 0 };
+		std::atomic<int> mMisses { 0 };
+
+		JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DecodedSampleCache)
+	};
+}
+#endif
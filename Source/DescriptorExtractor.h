@@ -0,0 +1,212 @@
+/*
+  ==============================================================================
+
+    DescriptorExtractor.h
+    Author:  Jake Rose
+
+	Computes a SampleDescriptor from a mono signal. Level and envelope come
+	from the time domain, the spectral shape and MFCCs from 1024 point dsp FFT
+	frames, averaged weighted by frame energy so a long tail of silence does
+	not wash out the sound. Pure, any thread.
+
+  ==============================================================================
+*/
+
+#ifndef DESCRIPTOREXTRACTOR_H
+#define DESCRIPTOREXTRACTOR_H
+
+#include "JuceHeader.h"
+
+#include "SampleDescriptor.h"
+
+#include <cmath>
+#include <vector>
+
+class DescriptorExtractor
+{
+public:
+	static const int FFT_ORDER = 10;
+	static const int FFT_SIZE = 1 << FFT_ORDER;
+	static const int HOP = FFT_SIZE / 2;
+	static const int NUM_MEL_BANDS = 26;
+
+	/// seconds is the length of the whole file, mono may only hold the start of it
+	static SampleDescriptor extract(const float* mono, int numSamples, double sampleRate, double seconds)
+	{
+		SampleDescriptor descriptor;
+		descriptor.set(SampleDescriptor::Duration, (float)std::log10(jmax(0.01, seconds)) / 2.0f);
+		if (mono == nullptr || numSamples <= 0 || sampleRate <= 0.0)
+			return descriptor;
+
+		extractLevels(descriptor, mono, numSamples, sampleRate);
+		extractSpectrum(descriptor, mono, numSamples, sampleRate);
+		return descriptor;
+	}
+
+private:
+	/// Level in dB scaled so -60 to 0 maps onto -1 to 1
+	static float scaleDecibels(double gain) { return (float)((Decibels::gainToDecibels(gain, -60.0) + 30.0) / 30.0); }
+	/// Frequencies on a log scale, 62Hz to 16kHz onto -1 to 1
+	static float scaleFrequency(double hertz) { return (float)(std::log2(jmax(1.0, hertz) / 1000.0) / 4.0); }
+
+	static void extractLevels(SampleDescriptor& descriptor, const float* mono, int numSamples, double sampleRate)
+	{
+		double sum = 0.0;
+		float peak = 0.0f;
+		int crossings = 0;
+		for (int i = 0; i < numSamples; i++)
+		{
+			sum += mono[i] * mono[i];
+			peak = jmax(peak, std::abs(mono[i]));
+			if (i > 0 && (mono[i] >= 0.0f) != (mono[i - 1] >= 0.0f))
+				crossings++;
+		}
+		const double rms = std::sqrt(sum / numSamples);
+		descriptor.set(SampleDescriptor::Loudness, scaleDecibels(rms));
+		descriptor.set(SampleDescriptor::Peak, scaleDecibels(peak));
+		descriptor.set(SampleDescriptor::Crest, rms > 0.0 ? (float)(Decibels::gainToDecibels(peak / rms) / 15.0 - 1.0) : -1.0f);
+		descriptor.set(SampleDescriptor::ZeroCrossings, scaleFrequency(crossings * sampleRate / (2.0 * numSamples)));
+
+		//time until 10ms windows come close to the loudest, short for hits, long for swells and pads
+		const int window = jmax(1, (int)(sampleRate * 0.01));
+		std::vector<double> energies;
+		double loudest = 0.0;
+		for (int start = 0; start < numSamples; start += window)
+		{
+			double energy = 0.0;
+			for (int i = start; i < jmin(numSamples, start + window); i++)
+				energy += mono[i] * mono[i];
+			energies.push_back(energy);
+			loudest = jmax(loudest, energy);
+		}
+		int loudestAt = 0;
+		while (loudestAt < (int)energies.size() && energies[loudestAt] < 0.9 * loudest)
+			loudestAt++;
+		loudestAt *= window;
+		const double attack = jmax(0.001, loudestAt / sampleRate);
+		descriptor.set(SampleDescriptor::Attack, (float)((std::log10(attack) + 1.5) / 1.5));
+	}
+
+	static void extractSpectrum(SampleDescriptor& descriptor, const float* mono, int numSamples, double sampleRate)
+	{
+		const int bins = FFT_SIZE / 2 + 1;
+		const double binWidth = sampleRate / FFT_SIZE;
+		const std::vector<std::vector<float>> melBands = getMelBands(sampleRate);
+
+		dsp::FFT fft(FFT_ORDER);
+		dsp::WindowingFunction<float> window(FFT_SIZE, dsp::WindowingFunction<float>::hann, false);
+		std::vector<float> frame(FFT_SIZE * 2);
+		std::vector<float> previous(bins, 0.0f);
+		std::vector<double> mel(NUM_MEL_BANDS);
+
+		double totalWeight = 0.0, centroid = 0.0, centroidSquares = 0.0, rolloff = 0.0, flatness = 0.0, flux = 0.0, lowEnergy = 0.0;
+		std::array<double, SampleDescriptor::NUM_MFCC_MEANS + 1> mfcc {}, mfccSquares {};
+		//one-shots shorter than a frame still get a zero padded one
+		for (int start = 0; start == 0 || start + FFT_SIZE <= numSamples; start += HOP)
+		{
+			std::fill(frame.begin(), frame.end(), 0.0f);
+			std::copy(mono + start, mono + jmin(numSamples, start + FFT_SIZE), frame.begin());
+			window.multiplyWithWindowingTable(frame.data(), FFT_SIZE);
+			fft.performFrequencyOnlyForwardTransform(frame.data(), true);
+
+			double power = 0.0, weightedFrequency = 0.0, logPower = 0.0, rise = 0.0, low = 0.0;
+			for (int bin = 1; bin < bins; bin++)
+			{
+				const double magnitude = frame[bin];
+				power += magnitude * magnitude;
+				weightedFrequency += bin * binWidth * magnitude * magnitude;
+				logPower += std::log(magnitude * magnitude + 1.0e-12);
+				rise += jmax(0.0f, frame[bin] - previous[bin]);
+				if (bin * binWidth < 200.0)
+					low += magnitude * magnitude;
+				previous[bin] = frame[bin];
+			}
+			if (power <= 1.0e-9)
+				continue;
+
+			double cumulative = 0.0;
+			int rolloffBin = bins - 1;
+			for (int bin = 1; bin < bins; bin++)
+			{
+				cumulative += frame[bin] * frame[bin];
+				if (cumulative >= 0.85 * power)
+				{
+					rolloffBin = bin;
+					break;
+				}
+			}
+
+			const double weight = power;
+			const double frameCentroid = scaleFrequency(weightedFrequency / power);
+			totalWeight += weight;
+			centroid += weight * frameCentroid;
+			centroidSquares += weight * frameCentroid * frameCentroid;
+			rolloff += weight * scaleFrequency(rolloffBin * binWidth);
+			flatness += weight * std::exp(logPower / (bins - 1)) / (power / (bins - 1));
+			flux += weight * rise / jmax(1.0e-9, std::sqrt(power));
+			lowEnergy += weight * low / power;
+
+			for (int band = 0; band < NUM_MEL_BANDS; band++)
+			{
+				double energy = 0.0;
+				for (int bin = 0; bin < bins; bin++)
+					energy += melBands[band][bin] * frame[bin] * frame[bin];
+				mel[band] = std::log(energy + 1.0e-10);
+			}
+			for (int c = 1; c <= SampleDescriptor::NUM_MFCC_MEANS; c++)
+			{
+				double coefficient = 0.0;
+				for (int band = 0; band < NUM_MEL_BANDS; band++)
+					coefficient += mel[band] * std::cos(MathConstants<double>::pi * c * (band + 0.5) / NUM_MEL_BANDS);
+				coefficient *= std::sqrt(2.0 / NUM_MEL_BANDS);
+				mfcc[c] += weight * coefficient;
+				mfccSquares[c] += weight * coefficient * coefficient;
+			}
+		}
+		if (totalWeight <= 0.0)
+			return;
+
+		const double meanCentroid = centroid / totalWeight;
+		descriptor.set(SampleDescriptor::Centroid, (float)meanCentroid);
+		descriptor.set(SampleDescriptor::CentroidSpread, (float)std::sqrt(jmax(0.0, centroidSquares / totalWeight - meanCentroid * meanCentroid)) * 4.0f - 1.0f);
+		descriptor.set(SampleDescriptor::Rolloff, (float)(rolloff / totalWeight));
+		descriptor.set(SampleDescriptor::Flatness, (float)(2.0 * flatness / totalWeight - 1.0));
+		descriptor.set(SampleDescriptor::Flux, (float)std::log2(1.0 + flux / totalWeight) / 3.0f - 1.0f);
+		descriptor.set(SampleDescriptor::LowEnergy, (float)(2.0 * lowEnergy / totalWeight - 1.0));
+		for (int c = 1; c <= SampleDescriptor::NUM_MFCC_MEANS; c++)
+		{
+			const double mean = mfcc[c] / totalWeight;
+			descriptor.set(SampleDescriptor::MfccMean + c - 1, (float)(mean / 48.0));
+			if (c <= SampleDescriptor::NUM_MFCC_SPREADS)
+			{
+				const double spread = std::sqrt(jmax(0.0, mfccSquares[c] / totalWeight - mean * mean));
+				descriptor.set(SampleDescriptor::MfccSpread + c - 1, (float)(spread / 3.0 - 1.0));
+			}
+		}
+	}
+
+	/// Triangular filters evenly spaced in mel from 30Hz to 8kHz or Nyquist
+	static std::vector<std::vector<float>> getMelBands(double sampleRate)
+	{
+		auto toMel = [](double hertz) { return 2595.0 * std::log10(1.0 + hertz / 700.0); };
+		auto toHertz = [](double mel) { return 700.0 * (std::pow(10.0, mel / 2595.0) - 1.0); };
+		const int bins = FFT_SIZE / 2 + 1;
+		const double low = toMel(30.0), high = toMel(jmin(8000.0, sampleRate / 2.0));
+		std::vector<std::vector<float>> bands(NUM_MEL_BANDS, std::vector<float>(bins, 0.0f));
+		for (int band = 0; band < NUM_MEL_BANDS; band++)
+		{
+			const double left = toHertz(low + (high - low) * band / (NUM_MEL_BANDS + 1));
+			const double centre = toHertz(low + (high - low) * (band + 1) / (NUM_MEL_BANDS + 1));
+			const double right = toHertz(low + (high - low) * (band + 2) / (NUM_MEL_BANDS + 1));
+			for (int bin = 0; bin < bins; bin++)
+			{
+				const double hertz = bin * sampleRate / FFT_SIZE;
+				if (hertz > left && hertz < right)
+					bands[band][bin] = (float)(hertz <= centre ? (hertz - left) / (centre - left) : (right - hertz) / (right - centre));
+			}
+		}
+		return bands;
+	}
+};
+
+#endif
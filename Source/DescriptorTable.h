@@ -0,0 +1,62 @@
+/*
+  ==============================================================================
+
+    DescriptorTable.h
+    Author:  Jake Rose
+
+	Every analysed sample's descriptor back to back in one block, row i
+	belongs to sample i of the snapshot the table was built from. Sorting,
+	filtering and similarity scan this instead of touching samples or audio.
+
+  ==============================================================================
+*/
+
+#ifndef DESCRIPTORTABLE_H
+#define DESCRIPTORTABLE_H
+
+#include "JuceHeader.h"
+
+#include "LibrarySnapshot.h"
+#include "SampleDescriptor.h"
+
+#include <vector>
+
+namespace samplore
+{
+	class DescriptorTable
+	{
+	public:
+		/// Fills rows for every sample analysed so far
+		DescriptorTable(std::shared_ptr<const LibrarySnapshot> snapshot)
+			: mSnapshot(snapshot), mData((size_t)snapshot->size() * SampleDescriptor::SIZE, 0), mHasRow((size_t)snapshot->size(), 0)
+		{
+			for (int i = 0; i < snapshot->size(); i++)
+			{
+				if (std::shared_ptr<const SampleDescriptor> descriptor = snapshot->getRow(i)->getRecord()->mDescriptor)
+					setRow(i, *descriptor);
+			}
+		}
+
+		int size() const { return (int)mHasRow.size(); }
+		/// Rows holding a descriptor
+		int getFilledCount() const { return mFilled; }
+		bool hasRow(int index) const { return mHasRow[index] != 0; }
+		const int8* getRow(int index) const { return mData.data() + (size_t)index * SampleDescriptor::SIZE; }
+		const int8* getData() const { return mData.data(); }
+
+		void setRow(int index, const SampleDescriptor& descriptor)
+		{
+			std::copy(descriptor.mValues.begin(), descriptor.mValues.end(), mData.begin() + (size_t)index * SampleDescriptor::SIZE);
+			mFilled += mHasRow[index] ? 0 : 1;
+			mHasRow[index] = 1;
+		}
+
+		const std::shared_ptr<const LibrarySnapshot>& getSnapshot() const { return mSnapshot; }
+	private:
+		std::shared_ptr<const LibrarySnapshot> mSnapshot;
+		std::vector<int8> mData;
+		std::vector<uint8> mHasRow;
+		int mFilled = 0;
+	};
+}
+#endif
@@ -0,0 +1,106 @@
+/*
+  ==============================================================================
+
+    Diagnostics.h
+    Author:  Jake Rose
+
+	Always-on counters for the diagnostics window. Recording is a relaxed
+	atomic add, nothing here locks or allocates, so subsystems bump them
+	from any thread including the audio callback.
+
+  ==============================================================================
+*/
+
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include "JuceHeader.h"
+
+#include <array>
+#include <atomic>
+
+namespace samplore
+{
+	class Diagnostics
+	{
+	public:
+		/// Components whose paint time is counted, add before NumClasses
+		enum class PaintClass
+		{
+			SamplifyMainComponent,
+			SampleExplorer,
+			SampleContainer,
+			SampleTile,
+			SamplePlayerComponent,
+			DirectoryItem,
+			TagTile,
+			NumClasses
+		};
+		static const char* getName(PaintClass paintClass)
+		{
+			static const char* names[] = { "SamplifyMainComponent", "SampleExplorer", "SampleContainer", "SampleTile",
+				"SamplePlayerComponent", "DirectoryItem", "TagTile" };
+			static_assert(sizeof(names) / sizeof(names[0]) == (size_t)PaintClass::NumClasses, "a name per paint class");
+			return names[(int)paintClass];
+		}
+
+		struct PaintStats
+		{
+			std::atomic<int64> mCount { 0 };
+			std::atomic<int64> mMicroseconds { 0 };
+		};
+		static PaintStats& getPaintStats(PaintClass paintClass)
+		{
+			static std::array<PaintStats, (size_t)PaintClass::NumClasses> stats;
+			return stats[(size_t)paintClass];
+		}
+
+		/// Counts one paint call and its duration
+		class PaintScope
+		{
+		public:
+			explicit PaintScope(PaintClass paintClass) noexcept : mStats(getPaintStats(paintClass)), mStart(Time::getHighResolutionTicks()) {}
+			~PaintScope()
+			{
+				mStats.mCount.fetch_add(1, std::memory_order_relaxed);
+				mStats.mMicroseconds.fetch_add((int64)(Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - mStart) * 1.0e6), std::memory_order_relaxed);
+			}
+		private:
+			PaintStats& mStats;
+			int64 mStart;
+			JUCE_DECLARE_NON_COPYABLE(PaintScope)
+		};
+
+		/// Query latency histogram, bucket i counts queries under getQueryBucketLimit(i) ms, the last one the rest
+		static const int QUERY_BUCKETS = 8;
+		static double getQueryBucketLimit(int bucket)
+		{
+			static const double limits[QUERY_BUCKETS] = { 5.0, 10.0, 20.0, 50.0, 100.0, 200.0, 500.0, 0.0 };
+			return limits[bucket];
+		}
+		static std::atomic<int64>& getQueryBucket(int bucket)
+		{
+			static std::array<std::atomic<int64>, QUERY_BUCKETS> buckets {};
+			return buckets[(size_t)bucket];
+		}
+		/// From the search box changing to results being shown
+		static void recordQueryLatency(double milliseconds)
+		{
+			int bucket = 0;
+			while (bucket < QUERY_BUCKETS - 1 && milliseconds >= getQueryBucketLimit(bucket))
+			{
+				bucket++;
+			}
+			getQueryBucket(bucket).fetch_add(1, std::memory_order_relaxed);
+		}
+
+		/// Thumbnails asked for that have not finished reading their file
+		static std::atomic<int>& getThumbnailsPending()
+		{
+			static std::atomic<int> pending { 0 };
+			return pending;
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,168 @@
+#include "DiagnosticsWindow.h"
+#include "SamplifyProperties.h"
+
+using namespace samplore;
+
+DiagnosticsWindow::DiagnosticsWindow() : DocumentWindow("Performance Diagnostics", ThemeManager::getInstance().getColorForRole(ThemeManager::ColorRole::Background), DocumentWindow::closeButton, true)
+{
+	setUsingNativeTitleBar(true);
+	setContentNonOwned(&mView, true);
+	setResizable(true, false);
+	centreWithSize(getWidth(), getHeight());
+}
+
+void DiagnosticsWindow::closeButtonPressed()
+{
+	setVisible(false); //kept by the menu, reopening shows the same counters
+}
+
+DiagnosticsWindow::View::View() : mVBlank(this, [this] { frameStarted(); })
+{
+	mCopyButton.setButtonText("Copy");
+	mCopyButton.onClick = [this] { SystemClipboard::copyTextToClipboard(getReport()); };
+	addAndMakeVisible(mCopyButton);
+	ThemeManager::getInstance().addListener(this);
+	mLastRefreshMs = Time::getMillisecondCounterHiRes();
+	setSize(460, 600);
+	timerCallback();
+	startTimer(REFRESH_INTERVAL_MS);
+}
+
+DiagnosticsWindow::View::~View()
+{
+	ThemeManager::getInstance().removeListener(this);
+}
+
+void DiagnosticsWindow::View::paint(Graphics& g)
+{
+	auto& theme = ThemeManager::getInstance();
+	g.fillAll(theme.getColorForRole(ThemeManager::ColorRole::Background));
+	g.setColour(theme.getColorForRole(ThemeManager::ColorRole::TextPrimary));
+	g.setFont(FontOptions(Font::getDefaultMonospacedFontName(), 13.0f, Font::plain));
+	const int lineHeight = 17;
+	for (int i = 0; i < mLines.size(); i++)
+	{
+		g.drawText(mLines[i], 12, 8 + i * lineHeight, getWidth() - 24, lineHeight, Justification::centredLeft, false);
+	}
+}
+
+void DiagnosticsWindow::View::resized()
+{
+	mCopyButton.setBounds(getWidth() - 80, 8, 68, 24);
+}
+
+String DiagnosticsWindow::View::getReport() const
+{
+	return String(ProjectInfo::projectName) + " " + ProjectInfo::versionString + "\n" + mLines.joinIntoString("\n");
+}
+
+void DiagnosticsWindow::View::frameStarted()
+{
+	const double now = Time::getMillisecondCounterHiRes();
+	if (mLastFrameMs > 0.0)
+	{
+		const double frameMs = now - mLastFrameMs;
+		mFrames++;
+		mFrameMsTotal += frameMs;
+		mWorstFrameMs = jmax(mWorstFrameMs, frameMs);
+	}
+	mLastFrameMs = now;
+}
+
+void DiagnosticsWindow::View::timerCallback()
+{
+	const double now = Time::getMillisecondCounterHiRes();
+	const double seconds = jmax(0.001, (now - mLastRefreshMs) / 1000.0);
+	mLastRefreshMs = now;
+	mLines.clearQuick();
+
+	mLines.add("Message thread");
+	mLines.add(mFrames > 0
+		? "  frames " + String(mFrames / seconds, 1) + "/s, mean " + String(mFrameMsTotal / mFrames, 1) + " ms, worst " + String(mWorstFrameMs, 1) + " ms"
+		: String("  no frames, the thread is blocked or the window hidden"));
+	mFrames = 0;
+	mFrameMsTotal = 0.0;
+	mWorstFrameMs = 0.0;
+
+	mLines.add("");
+	mLines.add("Paint                    calls/s    avg us   ms/s");
+	for (int i = 0; i < (int)Diagnostics::PaintClass::NumClasses; i++)
+	{
+		Diagnostics::PaintStats& stats = Diagnostics::getPaintStats((Diagnostics::PaintClass)i);
+		const int64 count = stats.mCount.load(std::memory_order_relaxed);
+		const int64 micros = stats.mMicroseconds.load(std::memory_order_relaxed);
+		const int64 calls = count - mLastPaintCounts[(size_t)i];
+		const int64 spent = micros - mLastPaintMicroseconds[(size_t)i];
+		mLastPaintCounts[(size_t)i] = count;
+		mLastPaintMicroseconds[(size_t)i] = micros;
+		mLines.add("  " + String(Diagnostics::getName((Diagnostics::PaintClass)i)).paddedRight(' ', 22)
+			+ String(calls / seconds, 1).paddedLeft(' ', 8)
+			+ String(calls > 0 ? (double)spent / calls : 0.0, 0).paddedLeft(' ', 10)
+			+ String(spent / 1000.0 / seconds, 1).paddedLeft(' ', 7));
+	}
+
+	mLines.add("");
+	mLines.add("Query latency, since launch");
+	int64 buckets[Diagnostics::QUERY_BUCKETS];
+	int64 mostInBucket = 1;
+	for (int i = 0; i < Diagnostics::QUERY_BUCKETS; i++)
+	{
+		buckets[i] = Diagnostics::getQueryBucket(i).load(std::memory_order_relaxed);
+		mostInBucket = jmax(mostInBucket, buckets[i]);
+	}
+	for (int i = 0; i < Diagnostics::QUERY_BUCKETS; i++)
+	{
+		const String label = i < Diagnostics::QUERY_BUCKETS - 1
+			? "< " + String(Diagnostics::getQueryBucketLimit(i), 0) + " ms"
+			: ">= " + String(Diagnostics::getQueryBucketLimit(i - 1), 0) + " ms";
+		mLines.add("  " + label.paddedRight(' ', 10) + String(buckets[i]).paddedLeft(' ', 7) + "  "
+			+ String::repeatedString("#", (int)(buckets[i] * 24 / mostInBucket)));
+	}
+
+	mLines.add("");
+	mLines.add("Queues");
+	mLines.add("  thumbnails loading   " + String(Diagnostics::getThumbnailsPending().load()));
+	SamplifyProperties* properties = SamplifyProperties::getInstance();
+	if (std::shared_ptr<SampleLibrary> library = properties != nullptr ? properties->getSampleLibrary() : nullptr)
+	{
+		const LibraryAnalyser& analyser = library->getAnalyser();
+		mLines.add("  analysis pending     " + String(analyser.getQueuedCount() - analyser.getFinishedCount())
+			+ " of " + String(analyser.getQueuedCount()));
+	}
+
+	if (std::shared_ptr<AudioPlayer> player = properties != nullptr ? properties->getAudioPlayer() : nullptr)
+	{
+		DecodedSampleCache& cache = player->getDecodedCache();
+		const int lookups = cache.getHitCount() + cache.getMissCount();
+		mLines.add("");
+		mLines.add("Decoded sample cache");
+		mLines.add("  hit rate             " + (lookups > 0 ? String(100.0 * cache.getHitCount() / lookups, 1) + "% of " + String(lookups) : String("no lookups yet")));
+		mLines.add("  used                 " + File::descriptionOfSizeInBytes(cache.getBytesUsed()) + " of " + File::descriptionOfSizeInBytes(cache.getByteBudget()));
+
+		mLines.add("");
+		mLines.add("Audio");
+		const CallbackLoadMeter& meter = player->getLoadMeter();
+		const CallbackLoadMeter::Stats load = meter.getStats();
+		mLines.add("  callback load        " + String(load.mMin * 100.0f, 0) + "% min, " + String(load.mMean * 100.0f, 0) + "% mean, "
+			+ String(load.mMax * 100.0f, 0) + "% max");
+		mLines.add("  xruns                " + String(meter.getXrunCount()));
+		mLines.add("  preview quality      " + String(meter.wantsDraftQuality() ? "draft, the callback is short of time" : "full"));
+		mLines.add("  read-ahead underruns " + String(player->getUnderrunCount()));
+	}
+	repaint();
+}
+
+//==============================================================================
+// ThemeManager::Listener implementation
+void DiagnosticsWindow::View::themeChanged(ThemeManager::Theme newTheme)
+{
+	repaint();
+}
+
+void DiagnosticsWindow::View::colorChanged(ThemeManager::ColorRole role, Colour newColor)
+{
+	if (role == ThemeManager::ColorRole::Background || role == ThemeManager::ColorRole::TextPrimary)
+	{
+		repaint();
+	}
+}
@@ -0,0 +1,72 @@
+/*
+  ==============================================================================
+
+    DiagnosticsWindow.h
+    Author:  Jake Rose
+
+	Live numbers from the counters in Diagnostics and the player, library and
+	analyser, refreshed a few times a second. Not modal so it can stay open
+	next to whatever is slow, Copy puts the text on the clipboard for reports.
+
+  ==============================================================================
+*/
+
+#ifndef DIAGNOSTICSWINDOW_H
+#define DIAGNOSTICSWINDOW_H
+
+#include "JuceHeader.h"
+#include "ThemeManager.h"
+#include "Diagnostics.h"
+
+#include <array>
+
+namespace samplore
+{
+	class DiagnosticsWindow : public DocumentWindow
+	{
+	public:
+		DiagnosticsWindow();
+		void closeButtonPressed() override;
+
+		class View : public Component, public ThemeManager::Listener, private Timer
+		{
+		public:
+			View();
+			~View() override;
+
+			void paint(Graphics& g) override;
+			void resized() override;
+
+			/// Everything shown, as plain text
+			String getReport() const;
+
+			void themeChanged(ThemeManager::Theme newTheme) override;
+			void colorChanged(ThemeManager::ColorRole role, Colour newColor) override;
+		private:
+			void timerCallback() override;
+			void frameStarted();
+
+			static const int REFRESH_INTERVAL_MS = 500;
+
+			VBlankAttachment mVBlank;
+			TextButton mCopyButton;
+			StringArray mLines; //rebuilt every refresh
+
+			//frames since the last refresh, message thread only
+			double mLastFrameMs = 0.0;
+			int mFrames = 0;
+			double mFrameMsTotal = 0.0;
+			double mWorstFrameMs = 0.0;
+
+			//counter values at the last refresh, shown as rates
+			double mLastRefreshMs = 0.0;
+			std::array<int64, (size_t)Diagnostics::PaintClass::NumClasses> mLastPaintCounts {};
+			std::array<int64, (size_t)Diagnostics::PaintClass::NumClasses> mLastPaintMicroseconds {};
+
+			JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(View)
+		};
+	private:
+		View mView;
+	};
+}
+#endif
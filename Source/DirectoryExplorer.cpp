@@ -32,7 +32,13 @@ void DirectoryExplorer::resized()
 
 void DirectoryExplorer::refresh()
 {
+	std::vector<std::shared_ptr<SampleDirectory>> dirs = SamplifyProperties::getInstance()->getSampleLibrary()->getDirectories();
 	TreeViewItem* root = mDirectoryTree.getRootItem();
+	if (root != nullptr && dirs == mShownDirectories)
+	{
+		//check and rescan changes repaint through the items own listeners, keep selection and openness
+		return;
+	}
 	if (root == nullptr)
 	{
 		root = new DirectoryExplorerTreeViewItem("All Directories");
@@ -42,7 +48,7 @@ void DirectoryExplorer::refresh()
 	{
 		root->clearSubItems();
 	}
-	std::vector<std::shared_ptr<SampleDirectory>> dirs = SamplifyProperties::getInstance()->getSampleLibrary()->getDirectories();
+	mShownDirectories = dirs;
 	for (int i = 0; i < dirs.size(); i++)
 	{
 		DirectoryExplorerTreeViewItem* item = new DirectoryExplorerTreeViewItem(dirs[i]);
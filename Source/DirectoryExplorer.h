@@ -35,6 +35,7 @@ namespace samplore
 		//============================================================
 		
 		TreeView mDirectoryTree;
+		std::vector<std::shared_ptr<SampleDirectory>> mShownDirectories; //only rebuild the tree when these change
 		JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DirectoryExplorer)
 	};
 }
@@ -1,4 +1,5 @@
 #include "DirectoryExplorerTreeViewItem.h"
+#include "Diagnostics.h"
 #include "SamplifyMainComponent.h"
 #include "SamplifyProperties.h"
 #include "SamplifyLookAndFeel.h"
@@ -45,7 +46,7 @@ bool DirectoryExplorerTreeViewItem::mightContainSubItems()
 {
 	if (mShouldUseFile)
 	{
-		return mSampleDirectory->getFile().containsSubDirectories();
+		return mSampleDirectory->getChildDirectoryCount() > 0; //known from the tree, asking the disk is a listing per visible row
 	}
 	else
 	{
@@ -87,6 +88,7 @@ String DirectoryExplorerTreeViewItem::getName()
 
 void DirectoryExplorerTreeViewItem::paintItem(Graphics & g, int width, int height)
 {
+	Diagnostics::PaintScope paintScope(Diagnostics::PaintClass::DirectoryItem);
 	//check if not added yet, dont draw
 	if (getOwnerView() != nullptr)
 	{
@@ -180,6 +182,8 @@ void DirectoryExplorerTreeViewItem::itemOpennessChanged(bool isNowOpen)
 		if (getNumSubItems() == 0)
 		{
 			Array<File> files;
+			//restored from the index until now, checking against the disk may find other folders
+			mSampleDirectory->buildChildDirectories();
 			int childDirCount = mSampleDirectory->getChildDirectoryCount();
 			for (int i = 0; i < childDirCount; i++)
 			{
@@ -225,6 +229,15 @@ void DirectoryExplorerTreeViewItem::itemClicked(const MouseEvent& e)
 	}
 }
 
+void DirectoryExplorerTreeViewItem::itemSelectionChanged(bool isNowSelected)
+{
+	if (isNowSelected)
+	{
+		//browse only this folder and below, the root item shows everything
+		SamplifyProperties::getInstance()->getSampleLibrary()->setDirectoryScope(mShouldUseFile ? mSampleDirectory : nullptr);
+	}
+}
+
 void samplore::DirectoryExplorerTreeViewItem::refreshChildrenPaint()
 {
 	repaintItem();
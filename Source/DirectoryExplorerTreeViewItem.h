@@ -47,6 +47,7 @@ namespace samplore
 		void paintOpenCloseButton(Graphics&, const Rectangle<float>& area, Colour backgroundColour, bool isMouseOver) override;
 		void itemOpennessChanged(bool isNowOpen) override;
 		void itemClicked(const MouseEvent& e) override;
+		void itemSelectionChanged(bool isNowSelected) override;
 
 		void refreshChildrenPaint();
 		//todo allow external drag drop of files/folders into the directory
@@ -0,0 +1,153 @@
+/*
+  ==============================================================================
+
+    DuplicateIndex.h
+    Author:  Jake Rose
+
+	Groups samples that are the same file or the same sound. Identical
+	content meets through a hash of its content fingerprint, near copies
+	through a hash of the halves of their first fingerprint words, a
+	re-encode nearly always keeps some of them intact. Only samples sharing a bucket are
+	compared, so grouping stays close to linear in the library size.
+	Pure, any thread.
+
+  ==============================================================================
+*/
+
+#ifndef DUPLICATEINDEX_H
+#define DUPLICATEINDEX_H
+
+#include "JuceHeader.h"
+
+#include "AudioFingerprint.h"
+
+#include <algorithm>
+#include <numeric>
+#include <unordered_map>
+#include <vector>
+
+class DuplicateIndex
+{
+public:
+	struct Group
+	{
+		std::vector<int> mItems; //in the order they were added
+		bool mIdentical = true; //every item has the same content
+	};
+
+	/// Words of each fingerprint that go in the index
+	static const int KEY_WORDS = 8;
+	/// Near empty keys come from steady or decaying frames and match everything
+	static const int MIN_KEY_BITS = 2;
+	/// Buckets fuller than this hold a degenerate key, comparing them all would go quadratic
+	static const int MAX_BUCKET = 256;
+
+	/// Item ids count up from zero in the order of adding. content is zero when unknown
+	int add(uint64 content, const AudioFingerprint& fingerprint)
+	{
+		mContents.push_back(content);
+		mFingerprints.push_back(fingerprint);
+		return (int)mContents.size() - 1;
+	}
+
+	int size() const { return (int)mContents.size(); }
+
+	/// Every group of two or more, largest first
+	std::vector<Group> getGroups() const
+	{
+		const int count = size();
+		std::vector<int> parents((size_t)count);
+		std::iota(parents.begin(), parents.end(), 0);
+
+		std::unordered_map<uint64, int> byContent;
+		std::unordered_map<uint32, std::vector<int>> byKey;
+		for (int item = 0; item < count; item++)
+		{
+			if (mContents[item] != 0)
+			{
+				auto inserted = byContent.emplace(mContents[item], item);
+				if (!inserted.second)
+				{
+					unite(parents, inserted.first->second, item);
+					continue; //its words are the same as the first copy's
+				}
+			}
+			const AudioFingerprint& fingerprint = mFingerprints[item];
+			for (int i = 0; i < jmin(KEY_WORDS, fingerprint.mCount); i++)
+			{
+				//half words, a copy only has to keep one of them intact to be found
+				const uint32 word = fingerprint.mWords[i];
+				for (uint32 key : { (word >> 16) << 1, ((word & 0xffff) << 1) | 1 })
+				{
+					if (AudioFingerprinter::countBits(key >> 1) >= MIN_KEY_BITS)
+						byKey[key].push_back(item);
+				}
+			}
+		}
+
+		for (auto& bucket : byKey)
+		{
+			std::vector<int>& items = bucket.second;
+			if (items.size() < 2 || (int)items.size() > MAX_BUCKET)
+				continue;
+			items.erase(std::unique(items.begin(), items.end()), items.end());
+			for (size_t i = 0; i < items.size(); i++)
+			{
+				for (size_t j = i + 1; j < items.size(); j++)
+				{
+					if (find(parents, items[i]) != find(parents, items[j])
+						&& AudioFingerprinter::isSameSound(mFingerprints[items[i]], mFingerprints[items[j]]))
+					{
+						unite(parents, items[i], items[j]);
+					}
+				}
+			}
+		}
+
+		std::vector<int> sizes((size_t)count, 0);
+		for (int item = 0; item < count; item++)
+		{
+			sizes[find(parents, item)]++;
+		}
+		std::unordered_map<int, int> groupOfRoot;
+		std::vector<Group> groups;
+		for (int item = 0; item < count; item++)
+		{
+			const int root = find(parents, item);
+			if (sizes[root] < 2)
+				continue;
+			auto inserted = groupOfRoot.emplace(root, (int)groups.size());
+			if (inserted.second)
+				groups.emplace_back();
+			Group& group = groups[inserted.first->second];
+			if (!group.mItems.empty() && (mContents[item] == 0 || mContents[item] != mContents[group.mItems.front()]))
+				group.mIdentical = false;
+			group.mItems.push_back(item);
+		}
+		std::stable_sort(groups.begin(), groups.end(), [](const Group& a, const Group& b) { return a.mItems.size() > b.mItems.size(); });
+		return groups;
+	}
+private:
+	static int find(std::vector<int>& parents, int item)
+	{
+		while (parents[item] != item)
+		{
+			parents[item] = parents[parents[item]]; //path halving
+			item = parents[item];
+		}
+		return item;
+	}
+
+	static void unite(std::vector<int>& parents, int a, int b)
+	{
+		a = find(parents, a);
+		b = find(parents, b);
+		if (a != b)
+			parents[jmax(a, b)] = jmin(a, b); //the first added stays the root
+	}
+
+	std::vector<uint64> mContents;
+	std::vector<AudioFingerprint> mFingerprints;
+};
+
+#endif
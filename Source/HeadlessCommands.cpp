@@ -0,0 +1,306 @@
+#include "HeadlessCommands.h"
+#include "SampleLibrary.h"
+#include "SamplifyProperties.h"
+#include "ContentHash.h"
+#include "MusicalKey.h"
+
+#include <iostream>
+
+using namespace samplore;
+
+bool HeadlessCommands::isCommand(const StringArray& args)
+{
+	return args.size() > 0 && StringArray { "index", "query", "analyze", "stats", "help", "--help" }.contains(args[0]);
+}
+
+int HeadlessCommands::run(const StringArray& args)
+{
+	const String command = args[0];
+	if (command == "help" || command == "--help")
+	{
+		return printUsage();
+	}
+
+	Array<File> directories;
+	String expression;
+	bool hasExpression = false;
+	for (int i = 1; i < args.size(); i++)
+	{
+		if (args[i] == "--dir" && i + 1 < args.size())
+		{
+			directories.add(File::getCurrentWorkingDirectory().getChildFile(args[++i].unquoted()));
+		}
+		else if (command == "query" && !hasExpression)
+		{
+			expression = args[i].unquoted();
+			hasExpression = true;
+		}
+		else
+		{
+			std::cerr << "samplore: unexpected argument " << args[i] << ", see samplore help" << std::endl;
+			return 2;
+		}
+	}
+	if (command == "query" && !hasExpression)
+	{
+		std::cerr << "samplore: query needs an expression, \"\" matches everything" << std::endl;
+		return 2;
+	}
+	if (directories.isEmpty())
+	{
+		//the ones the app was last closed with
+		PropertiesFile settings(SamplifyProperties::getSettingsOptions());
+		const int count = settings.getIntValue("directory count");
+		for (int i = 0; i < count; i++)
+		{
+			directories.add(File(settings.getValue("directory " + String(i))));
+		}
+	}
+	for (int i = directories.size(); --i >= 0;)
+	{
+		if (!directories[i].isDirectory())
+		{
+			std::cerr << "samplore: skipping " << directories[i].getFullPathName() << ", not a directory" << std::endl;
+			directories.remove(i);
+		}
+	}
+	if (directories.isEmpty())
+	{
+		std::cerr << "samplore: no sample directories, pass --dir or add one in the app" << std::endl;
+		return 1;
+	}
+
+	if (SampleDirectory::getWildcard().isEmpty())
+	{
+		AudioFormatManager formats;
+		formats.registerBasicFormats();
+		SampleDirectory::getWildcard() = formats.getWildcardForAllFormats();
+	}
+	SampleLibrary library(false); //each command starts only the work it needs
+	for (const File& dir : directories)
+	{
+		library.addDirectory(dir); //scans right away
+	}
+
+	int result = 0;
+	if (command == "index")
+		result = index(library);
+	else if (command == "query")
+		result = query(library, expression);
+	else if (command == "analyze")
+		result = analyse(library);
+	else
+		result = stats(library);
+	std::cout.flush();
+	return result;
+}
+
+int HeadlessCommands::index(SampleLibrary& library)
+{
+	const double start = Time::getMillisecondCounterHiRes();
+	std::shared_ptr<const LibrarySnapshot> snapshot = library.getSnapshot();
+	AnalysisStore& store = library.getAnalyser().getStore();
+	const int count = snapshot->size();
+	std::vector<uint64> hashes((size_t)count, 0);
+	std::atomic<int> hashed { 0 };
+	std::atomic<int> unreadable { 0 };
+	{
+		ThreadPool pool(jmax(1, SystemStats::getNumCpus())); //whole audio payloads, mostly waiting on the disk
+		for (int first = 0; first < count; first += HASHES_PER_JOB)
+		{
+			pool.addJob([&, first]
+			{
+				for (int i = first; i < jmin(count, first + HASHES_PER_JOB); i++)
+				{
+					const File file = snapshot->getRow(i)->getRecord()->mFile;
+					uint64 contentHash = store.findContentHash(file);
+					if (contentHash == 0)
+					{
+						contentHash = ContentHash::compute(file);
+						if (contentHash == 0)
+						{
+							unreadable++;
+							continue;
+						}
+						store.setContentHash(file, contentHash);
+						hashed++;
+					}
+					hashes[(size_t)i] = contentHash;
+				}
+			});
+		}
+		while (pool.getNumJobs() > 0)
+		{
+			Thread::sleep(10);
+		}
+	}
+	store.flush();
+	for (int i = 0; i < count; i++)
+	{
+		snapshot->getRow(i)->setContentHash(hashes[(size_t)i]); //moves metadata from older versions over
+	}
+
+	DynamicObject::Ptr summary = new DynamicObject();
+	summary->setProperty("command", "index");
+	summary->setProperty("directories", getDirectoryList(library));
+	summary->setProperty("samples", count);
+	summary->setProperty("hashed", hashed.load());
+	summary->setProperty("unreadable", unreadable.load());
+	summary->setProperty("seconds", (Time::getMillisecondCounterHiRes() - start) / 1000.0);
+	print(var(summary.get()));
+	return 0;
+}
+
+int HeadlessCommands::query(SampleLibrary& library, const String& expression)
+{
+	if (SearchFilter::fromQuery(expression).usesAnalysis())
+	{
+		loadStoredAnalysis(library);
+	}
+	Sample::List samples = library.getAllSamplesInDirectories(expression, true);
+	for (int i = 0; i < samples.size(); i++)
+	{
+		Sample::Reference sample = samples[i];
+		Array<var> tags;
+		for (const String& tag : sample.getTags())
+		{
+			tags.add(tag);
+		}
+		DynamicObject::Ptr line = new DynamicObject();
+		line->setProperty("path", sample.getFile().getFullPathName());
+		line->setProperty("tags", tags);
+		line->setProperty("tempo", sample.getTempo() > 0.0f ? var(sample.getTempo()) : var());
+		line->setProperty("key", MusicalKey::isKey(sample.getKey()) ? var(MusicalKey::getName(sample.getKey())) : var());
+		print(var(line.get()));
+	}
+	return 0;
+}
+
+int HeadlessCommands::analyse(SampleLibrary& library)
+{
+	const double start = Time::getMillisecondCounterHiRes();
+	std::shared_ptr<const LibrarySnapshot> snapshot = library.getSnapshot();
+	LibraryAnalyser& analyser = library.getAnalyser();
+	analyser.analyse(snapshot);
+	double lastProgress = start;
+	while (analyser.isBusy())
+	{
+		Thread::sleep(50);
+		analyser.deliverResults(); //nothing runs the message loop meanwhile, keep results from piling up
+		const double now = Time::getMillisecondCounterHiRes();
+		if (now - lastProgress >= PROGRESS_INTERVAL_MS)
+		{
+			std::cerr << "analysed " << analyser.getFinishedCount() << " of " << analyser.getQueuedCount() << std::endl;
+			lastProgress = now;
+		}
+	}
+	analyser.deliverResults();
+	analyser.getStore().flush();
+
+	int analysed = 0;
+	for (const auto& sample : snapshot->getSamples())
+	{
+		std::shared_ptr<const Sample::Record> record = sample->getRecord();
+		if (record->mTempo >= 0.0f && record->mKey != MusicalKey::UNKNOWN && record->mDescriptor != nullptr)
+		{
+			analysed++;
+		}
+	}
+	DynamicObject::Ptr summary = new DynamicObject();
+	summary->setProperty("command", "analyze");
+	summary->setProperty("directories", getDirectoryList(library));
+	summary->setProperty("samples", snapshot->size());
+	summary->setProperty("analysed", analysed);
+	summary->setProperty("unreadable", snapshot->size() - analysed);
+	summary->setProperty("seconds", (Time::getMillisecondCounterHiRes() - start) / 1000.0);
+	print(var(summary.get()));
+	return 0;
+}
+
+int HeadlessCommands::stats(SampleLibrary& library)
+{
+	std::shared_ptr<const LibrarySnapshot> snapshot = library.getSnapshot();
+	AnalysisStore& store = library.getAnalyser().getStore();
+	int hashed = 0, analysed = 0, withTempo = 0, withKey = 0, tagged = 0;
+	StringArray tags;
+	for (const auto& sample : snapshot->getSamples())
+	{
+		std::shared_ptr<const Sample::Record> record = sample->getRecord();
+		if (!record->mTags.isEmpty())
+		{
+			tagged++;
+			for (const String& tag : record->mTags)
+			{
+				tags.addIfNotAlreadyThere(tag);
+			}
+		}
+		const uint64 contentHash = store.findContentHash(record->mFile);
+		if (contentHash == 0)
+		{
+			continue;
+		}
+		hashed++;
+		SampleAnalysis analysis;
+		if (store.getAnalysis(contentHash, analysis) && analysis.isComplete())
+		{
+			analysed++;
+			withTempo += analysis.mTempo > 0.0f ? 1 : 0;
+			withKey += MusicalKey::isKey(analysis.mKey) ? 1 : 0;
+		}
+	}
+	DynamicObject::Ptr summary = new DynamicObject();
+	summary->setProperty("command", "stats");
+	summary->setProperty("directories", getDirectoryList(library));
+	summary->setProperty("samples", snapshot->size());
+	summary->setProperty("hashed", hashed);
+	summary->setProperty("analysed", analysed);
+	summary->setProperty("withTempo", withTempo);
+	summary->setProperty("withKey", withKey);
+	summary->setProperty("tagged", tagged);
+	summary->setProperty("tags", tags.size());
+	summary->setProperty("storeBytes", AnalysisStore::getDefaultFile().getSize());
+	print(var(summary.get()));
+	return 0;
+}
+
+int HeadlessCommands::printUsage()
+{
+	std::cout << "usage: samplore <command> [--dir <path>]...\n"
+		"\n"
+		"  index           hash new and changed files so the app and later commands skip them\n"
+		"  query <expr>    samples matching a search box expression, \"\" for all\n"
+		"  analyze         tempo, key, descriptor and fingerprint of everything not analysed yet\n"
+		"  stats           counts of samples, hashes, analyses and tags\n"
+		"\n"
+		"Output is JSON, one object per line. Without --dir the app's directories are used.\n";
+	return 0;
+}
+
+void HeadlessCommands::loadStoredAnalysis(SampleLibrary& library)
+{
+	AnalysisStore& store = library.getAnalyser().getStore();
+	for (const auto& sample : library.getSnapshot()->getSamples())
+	{
+		const uint64 contentHash = store.findContentHash(sample->getRecord()->mFile);
+		SampleAnalysis analysis;
+		if (contentHash != 0 && store.getAnalysis(contentHash, analysis))
+		{
+			sample->setAnalysis(analysis);
+		}
+	}
+}
+
+var HeadlessCommands::getDirectoryList(SampleLibrary& library)
+{
+	Array<var> paths;
+	for (const auto& dir : library.getDirectories())
+	{
+		paths.add(dir->getFile().getFullPathName());
+	}
+	return paths;
+}
+
+void HeadlessCommands::print(const var& value)
+{
+	std::cout << JSON::toString(value, true) << "\n";
+}
@@ -0,0 +1,50 @@
+/*
+  ==============================================================================
+
+    HeadlessCommands.h
+    Author:  Jake Rose
+
+	Command line mode, "samplore index", "samplore query <expr>",
+	"samplore analyze" and "samplore stats" work on the library through
+	SampleLibrary without opening a window. Results go to stdout as JSON,
+	one object per line, progress and errors to stderr. Directories come
+	from --dir options, or from the app's settings when there are none.
+	The app may be open meanwhile, writes to the shared analysis store,
+	library index and metadata files take AnalysisStore::getProcessLock.
+
+  ==============================================================================
+*/
+
+#ifndef HEADLESSCOMMANDS_H
+#define HEADLESSCOMMANDS_H
+
+#include "JuceHeader.h"
+
+namespace samplore
+{
+	class SampleLibrary;
+
+	class HeadlessCommands
+	{
+	public:
+		/// True if the command line names a subcommand, the app then runs it instead of the GUI
+		static bool isCommand(const StringArray& args);
+		/// Message thread, blocks until done. Returns the process exit code
+		static int run(const StringArray& args);
+	private:
+		static int index(SampleLibrary& library);
+		static int query(SampleLibrary& library, const String& expression);
+		static int analyse(SampleLibrary& library);
+		static int stats(SampleLibrary& library);
+		static int printUsage();
+
+		/// Fills every sample's record from the AnalysisStore, so tempo and key filters work
+		static void loadStoredAnalysis(SampleLibrary& library);
+		static var getDirectoryList(SampleLibrary& library);
+		static void print(const var& value);
+
+		static const int HASHES_PER_JOB = 256;
+		static const int PROGRESS_INTERVAL_MS = 1000;
+	};
+}
+#endif
@@ -132,7 +132,7 @@ void KeyBindingEditor::rebuildKeyBindingList()
     int y = 10;
     
     // Create row for each action
-    for (int i = 0; i <= static_cast<int>(KeyBindingManager::Action::ExitApplication); ++i)
+    for (int i = 0; i <= static_cast<int>(KeyBindingManager::Action::FindSimilar); ++i)
     {
         auto action = static_cast<KeyBindingManager::Action>(i);
         
@@ -94,6 +94,13 @@ void KeyBindingManager::initializeDefaultBindings()
         "Exit",
         "Exit application"
     );
+    
+    // Library
+    mBindings[Action::FindSimilar] = KeyBinding(
+        juce::KeyPress('f', juce::ModifierKeys::ctrlModifier | juce::ModifierKeys::shiftModifier, 0),
+        "Find Similar",
+        "Show the samples that sound most like the current one"
+    );
 }
 
 KeyBindingManager::KeyBinding KeyBindingManager::getBinding(Action action) const
@@ -172,6 +179,7 @@ juce::String KeyBindingManager::getActionName(Action action)
         case Action::ToggleDirectoryWindow: return "Toggle Directory Window";
         case Action::OpenPreferences:       return "Open Preferences";
         case Action::ExitApplication:       return "Exit Application";
+        case Action::FindSimilar:           return "Find Similar Sounds";
         default:                            return "Unknown";
     }
 }
@@ -30,7 +30,8 @@ namespace samplore
             ToggleFilterWindow,
             ToggleDirectoryWindow,
             OpenPreferences,
-            ExitApplication
+            ExitApplication,
+            FindSimilar //appended, saved bindings are keyed by value
         };
 
         /// Represents a key binding with modifiers
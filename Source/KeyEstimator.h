@@ -0,0 +1,135 @@
+/*
+  ==============================================================================
+
+    KeyEstimator.h
+    Author:  Jake Rose
+
+	Key of a loop from its mono signal. Magnitude spectra from the dsp FFT are
+	folded into a 12 bin chroma vector, which is correlated with the
+	Krumhansl-Kessler profile of every major and minor key. Expects the
+	decimated signal the LibraryAnalyser produces, pure, any thread.
+
+  ==============================================================================
+*/
+
+#ifndef KEYESTIMATOR_H
+#define KEYESTIMATOR_H
+
+#include "JuceHeader.h"
+
+#include "MusicalKey.h"
+
+#include <array>
+#include <cmath>
+#include <vector>
+
+struct KeyEstimate
+{
+	int mKey = MusicalKey::NONE;
+	float mConfidence = 0.0f; //correlation with the winning profile, 0 to 1
+};
+
+class KeyEstimator
+{
+public:
+	static constexpr double MIN_FREQUENCY = 55.0;
+	static constexpr double MAX_FREQUENCY = 2000.0; //above this partials blur into the chroma of other notes
+	/// Drums and noise correlate weakly with every profile
+	static constexpr float MIN_CORRELATION = 0.5f;
+
+	static KeyEstimate estimate(const float* mono, int numSamples, double sampleRate)
+	{
+		return matchProfiles(getChroma(mono, numSamples, sampleRate));
+	}
+
+	/// Summed magnitude per pitch class, C first, all zero if too short or silent
+	static std::array<float, 12> getChroma(const float* mono, int numSamples, double sampleRate)
+	{
+		std::array<float, 12> chroma {};
+		//bins under 3Hz wide, narrow enough to split semitones at the bottom of the range
+		const int order = sampleRate > 16000.0 ? 13 : 12;
+		const int size = 1 << order;
+		if (mono == nullptr || sampleRate <= 0.0 || numSamples < size)
+			return chroma;
+
+		std::vector<int> pitchClasses(size / 2, -1);
+		for (int bin = 1; bin < size / 2; bin++)
+		{
+			const double frequency = bin * sampleRate / size;
+			if (frequency >= MIN_FREQUENCY && frequency <= MAX_FREQUENCY)
+			{
+				const int midi = (int)std::round(69.0 + 12.0 * std::log2(frequency / 440.0));
+				pitchClasses[bin] = midi % 12;
+			}
+		}
+
+		dsp::FFT fft(order);
+		dsp::WindowingFunction<float> window((size_t)size, dsp::WindowingFunction<float>::hann, false);
+		std::vector<float> frame((size_t)size * 2);
+		for (int start = 0; start + size <= numSamples; start += size / 2)
+		{
+			std::copy(mono + start, mono + start + size, frame.begin());
+			window.multiplyWithWindowingTable(frame.data(), (size_t)size);
+			fft.performFrequencyOnlyForwardTransform(frame.data(), true);
+			for (int bin = 1; bin < size / 2; bin++)
+			{
+				if (pitchClasses[bin] >= 0)
+					chroma[pitchClasses[bin]] += frame[bin];
+			}
+		}
+		return chroma;
+	}
+
+	static KeyEstimate matchProfiles(const std::array<float, 12>& chroma)
+	{
+		static const float major[] = { 6.35f, 2.23f, 3.48f, 2.33f, 4.38f, 4.09f, 2.52f, 5.19f, 2.39f, 3.66f, 2.29f, 2.88f };
+		static const float minor[] = { 6.33f, 2.68f, 3.52f, 5.38f, 2.60f, 3.53f, 2.54f, 4.75f, 3.98f, 2.69f, 3.34f, 3.17f };
+		KeyEstimate result;
+		float best = -1.0f;
+		for (int key = 0; key < MusicalKey::NUM_KEYS; key++)
+		{
+			const float* profile = MusicalKey::isMinor(key) ? minor : major;
+			std::array<float, 12> rotated;
+			for (int i = 0; i < 12; i++)
+				rotated[(i + MusicalKey::getTonic(key)) % 12] = profile[i];
+			const float correlation = correlate(chroma, rotated);
+			if (correlation > best)
+			{
+				best = correlation;
+				result.mKey = key;
+			}
+		}
+		if (best < MIN_CORRELATION)
+		{
+			result.mKey = MusicalKey::NONE;
+		}
+		result.mConfidence = jlimit(0.0f, 1.0f, best);
+		return result;
+	}
+
+private:
+	/// Pearson, zero when either side is flat
+	static float correlate(const std::array<float, 12>& a, const std::array<float, 12>& b)
+	{
+		float meanA = 0.0f, meanB = 0.0f;
+		for (int i = 0; i < 12; i++)
+		{
+			meanA += a[i];
+			meanB += b[i];
+		}
+		meanA /= 12.0f;
+		meanB /= 12.0f;
+		float covariance = 0.0f, varianceA = 0.0f, varianceB = 0.0f;
+		for (int i = 0; i < 12; i++)
+		{
+			covariance += (a[i] - meanA) * (b[i] - meanB);
+			varianceA += (a[i] - meanA) * (a[i] - meanA);
+			varianceB += (b[i] - meanB) * (b[i] - meanB);
+		}
+		if (varianceA <= 0.0f || varianceB <= 0.0f)
+			return 0.0f;
+		return covariance / std::sqrt(varianceA * varianceB);
+	}
+};
+
+#endif
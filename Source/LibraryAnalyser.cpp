@@ -0,0 +1,282 @@
+#include "LibraryAnalyser.h"
+#include "Tracer.h"
+#include "TempoEstimator.h"
+#include "KeyEstimator.h"
+#include "DescriptorExtractor.h"
+#include "AudioFingerprint.h"
+#include "ContentHash.h"
+
+using namespace samplore;
+
+class LibraryAnalyser::AnalysisJob : public ThreadPoolJob
+{
+public:
+	AnalysisJob(LibraryAnalyser& owner, std::vector<std::weak_ptr<SampleRow>> rows)
+		: ThreadPoolJob("Analysis"), mOwner(owner), mRows(std::move(rows)) {}
+
+	JobStatus runJob() override
+	{
+		Tracer::setThreadName("Analysis"); //pool threads are all called Pool
+		for (const std::weak_ptr<SampleRow>& weak : mRows)
+		{
+			if (shouldExit() || mOwner.isCancelled())
+			{
+				break;
+			}
+			if (std::shared_ptr<SampleRow> row = weak.lock())
+			{
+				mOwner.analyseSample(row);
+			}
+			else
+			{
+				//its folder was removed while it waited
+				Result result;
+				result.mRow = weak;
+				result.mFailed = true;
+				mOwner.addResult(result);
+			}
+		}
+		mOwner.mStore.flush();
+		return jobHasFinished;
+	}
+private:
+	LibraryAnalyser& mOwner;
+	std::vector<std::weak_ptr<SampleRow>> mRows;
+};
+
+LibraryAnalyser::LibraryAnalyser(const File& storeFile)
+	: mStore(storeFile), mPool(jmax(1, SystemStats::getNumCpus() - 1), 0, Thread::Priority::background) //leave a core for the UI and audio
+{
+	mFormatManager.registerBasicFormats();
+}
+
+LibraryAnalyser::~LibraryAnalyser()
+{
+	mCancelled = true;
+	mPool.removeAllJobs(true, 5000);
+	cancelPendingUpdate();
+}
+
+void LibraryAnalyser::analyse(std::shared_ptr<const LibrarySnapshot> snapshot)
+{
+	if (snapshot->mSamples == mRows)
+	{
+		return; //a folder was checked, the queue and the table still fit
+	}
+	mRows = snapshot->mSamples;
+	mTable = std::make_shared<DescriptorTable>(snapshot);
+	mRowIndices.clear();
+	mRowIndices.reserve((size_t)snapshot->size());
+	if (!isBusy())
+	{
+		mQueued = 0;
+		mFinished = 0;
+	}
+	//samples already queued keep their place, removed ones are skipped by the job holding them
+	int queued = 0;
+	std::vector<std::vector<std::weak_ptr<SampleRow>>> batches(1);
+	for (int i = 0; i < snapshot->size(); i++)
+	{
+		const std::shared_ptr<SampleRow>& row = snapshot->getRow(i);
+		mRowIndices[row.get()] = i;
+		std::shared_ptr<const Sample::Record> record = row->getRecord();
+		if (record->mTempo >= 0.0f && record->mKey != MusicalKey::UNKNOWN && record->mDescriptor != nullptr)
+		{
+			continue;
+		}
+		if (mInQueue.count(row) > 0)
+		{
+			continue;
+		}
+		if ((int)batches.back().size() == SAMPLES_PER_JOB)
+		{
+			batches.emplace_back();
+		}
+		batches.back().push_back(row);
+		mInQueue.insert(row);
+		queued++;
+	}
+	//counted before any job starts, so isBusy cannot miss samples finished early
+	mQueued += queued;
+	for (std::vector<std::weak_ptr<SampleRow>>& batch : batches)
+	{
+		if (!batch.empty())
+		{
+			mPool.addJob(new AnalysisJob(*this, std::move(batch)), true);
+		}
+	}
+}
+
+void LibraryAnalyser::queueSample(std::shared_ptr<SampleRow> row)
+{
+	if (mInQueue.count(row) > 0)
+	{
+		return;
+	}
+	if (!isBusy())
+	{
+		mQueued = 0;
+		mFinished = 0;
+	}
+	mInQueue.insert(row);
+	mQueued++;
+	mPool.addJob(new AnalysisJob(*this, { row }), true);
+}
+
+void LibraryAnalyser::analyseSample(const std::shared_ptr<SampleRow>& row)
+{
+	const File file = row->getRecord()->mFile;
+	Result result;
+	result.mRow = row;
+	if (mStore.hasFailed(file))
+	{
+		//could not be decoded and not touched since, not worth another try
+		result.mFailed = true;
+		addResult(result);
+		return;
+	}
+	//unchanged since last time, answered without opening the file
+	uint64 contentHash = mStore.findContentHash(file);
+	if (contentHash == 0 || !mStore.getAnalysis(contentHash, result.mAnalysis) || !result.mAnalysis.isComplete())
+	{
+		if (contentHash == 0)
+		{
+			contentHash = ContentHash::compute(file);
+			if (contentHash == 0)
+			{
+				//gone or unreadable, the next rescan will tell
+				result.mFailed = true;
+				addResult(result);
+				return;
+			}
+			mStore.setContentHash(file, contentHash);
+		}
+		//a copy or a move of something already analysed
+		if (!mStore.getAnalysis(contentHash, result.mAnalysis) || !result.mAnalysis.isComplete())
+		{
+			result.mAnalysis = analyseFile(file);
+			if (!result.mAnalysis.isComplete())
+			{
+				//not decodable, tried again only once the file changes
+				mStore.setFailed(file);
+				result.mFailed = true;
+				addResult(result);
+				return;
+			}
+			mStore.setTempo(contentHash, result.mAnalysis.mTempo, result.mAnalysis.mTempoConfidence);
+			mStore.setKey(contentHash, result.mAnalysis.mKey, result.mAnalysis.mKeyConfidence);
+			mStore.setDescriptor(contentHash, result.mAnalysis.mDescriptor);
+			mStore.setAudioFingerprint(contentHash, result.mAnalysis.mAudioFingerprint);
+		}
+	}
+	result.mContentHash = contentHash;
+	addResult(result);
+}
+
+void LibraryAnalyser::addResult(Result result)
+{
+	{
+		const ScopedLock sl(mResultLock);
+		mResults.push_back(std::move(result));
+	}
+	mFinished++;
+	triggerAsyncUpdate();
+}
+
+SampleAnalysis LibraryAnalyser::analyseFile(const File& file)
+{
+	SAMPLORE_TRACE_ZONE("LibraryAnalyser::analyseFile");
+	SampleAnalysis analysis;
+	std::unique_ptr<AudioFormatReader> reader(mFormatManager.createReaderFor(file));
+	if (reader == nullptr || reader->sampleRate <= 0.0 || reader->numChannels == 0)
+	{
+		return analysis;
+	}
+	//mono, low passed and decimated to around ANALYSIS_RATE
+	const int factor = jmax(1, (int)(reader->sampleRate / ANALYSIS_RATE));
+	const int64 total = jmin(reader->lengthInSamples, (int64)(MAX_SECONDS * reader->sampleRate));
+	const int blockSize = 4096 * factor;
+	const int channels = (int)jmin(reader->numChannels, (unsigned int)2);
+	IIRFilter antiAlias[2];
+	for (IIRFilter& filter : antiAlias)
+	{
+		filter.setCoefficients(IIRCoefficients::makeLowPass(reader->sampleRate, 0.45 * reader->sampleRate / factor));
+	}
+	AudioBuffer<float> block(channels, blockSize);
+	std::vector<float> mono;
+	mono.reserve((size_t)(total / factor));
+	for (int64 position = 0; position < total; position += blockSize)
+	{
+		const int count = (int)jmin((int64)blockSize, total - position);
+		if (!reader->read(&block, 0, count, position, true, channels > 1))
+		{
+			break;
+		}
+		if (channels > 1)
+		{
+			block.addFrom(0, 0, block, 1, 0, count);
+			block.applyGain(0, 0, count, 0.5f);
+		}
+		float* mixed = block.getWritePointer(0);
+		if (factor > 1)
+		{
+			for (IIRFilter& filter : antiAlias)
+				filter.processSamples(mixed, count);
+		}
+		for (int i = 0; i < count; i += factor)
+		{
+			mono.push_back(mixed[i]);
+		}
+	}
+	//everything runs on the same decode, a one-shot gets no tempo but may still have a key
+	const double rate = reader->sampleRate / factor;
+	TempoEstimate tempo = TempoEstimator::estimate(mono.data(), (int)mono.size(), rate, total == reader->lengthInSamples);
+	analysis.mTempo = tempo.mBpm;
+	analysis.mTempoConfidence = tempo.mConfidence;
+	KeyEstimate key = KeyEstimator::estimate(mono.data(), (int)mono.size(), rate);
+	analysis.mKey = key.mKey;
+	analysis.mKeyConfidence = key.mConfidence;
+	analysis.mDescriptor = DescriptorExtractor::extract(mono.data(), (int)mono.size(), rate, reader->lengthInSamples / reader->sampleRate);
+	analysis.mHasDescriptor = true;
+	analysis.mAudioFingerprint = AudioFingerprinter::compute(mono.data(), (int)mono.size(), rate, reader->lengthInSamples / reader->sampleRate);
+	analysis.mHasAudioFingerprint = true;
+	return analysis;
+}
+
+void LibraryAnalyser::handleAsyncUpdate()
+{
+	SAMPLORE_TRACE_ZONE("LibraryAnalyser::handleAsyncUpdate");
+	std::vector<Result> results;
+	{
+		const ScopedLock sl(mResultLock);
+		results.swap(mResults);
+	}
+	bool delivered = false;
+	for (const Result& result : results)
+	{
+		mInQueue.erase(result.mRow);
+		std::shared_ptr<SampleRow> row = result.mRow.lock();
+		if (result.mFailed || row == nullptr)
+		{
+			continue;
+		}
+		//rows never shown only keep the result, no Sample is made for it
+		row->setContentHash(result.mContentHash);
+		row->setAnalysis(result.mAnalysis);
+		delivered = true;
+		auto index = mRowIndices.find(row.get());
+		if (index != mRowIndices.end() && mTable != nullptr)
+		{
+			if (mTable.use_count() > 1)
+			{
+				mTable = std::make_shared<DescriptorTable>(*mTable); //someone is still reading the published one
+			}
+			mTable->setRow(index->second, result.mAnalysis.mDescriptor);
+		}
+	}
+	Tracer::counter("analysis pending", getQueuedCount() - getFinishedCount());
+	if (delivered)
+	{
+		sendChangeMessage();
+	}
+}
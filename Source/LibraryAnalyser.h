@@ -0,0 +1,100 @@
+/*
+  ==============================================================================
+
+    LibraryAnalyser.h
+    Author:  Jake Rose
+
+	Background tempo, key, descriptor and fingerprint analysis of the whole
+	library. Every core but one works through the published snapshot at
+	background priority, each file is decoded once and its result kept in
+	the AnalysisStore, so a restart picks up where the last run stopped and
+	only new or edited files are decoded.
+
+  ==============================================================================
+*/
+
+#ifndef LIBRARYANALYSER_H
+#define LIBRARYANALYSER_H
+
+#include "JuceHeader.h"
+
+#include "AnalysisStore.h"
+#include "LibrarySnapshot.h"
+#include "DescriptorTable.h"
+
+#include <set>
+#include <unordered_map>
+
+namespace samplore
+{
+	/// Sends a change message on the message thread whenever a batch of samples got their results
+	class LibraryAnalyser : public ChangeBroadcaster, private AsyncUpdater
+	{
+	public:
+		LibraryAnalyser(const File& storeFile = AnalysisStore::getDefaultFile());
+		~LibraryAnalyser();
+
+		/// Message thread. Queues the samples of snapshot neither analysed nor queued already, files that
+		/// failed before are skipped until they change. Does nothing if only folder checks changed since the last call
+		void analyse(std::shared_ptr<const LibrarySnapshot> snapshot);
+		/// Message thread. Queues one sample on its own, for a file moved before it was hashed.
+		/// Nothing if it is queued already, its job reads the file where it is by then
+		void queueSample(std::shared_ptr<SampleRow> row);
+
+		/// Samples queued since the analyser was last idle and how many of those are done
+		int getQueuedCount() const { return mQueued.load(); }
+		int getFinishedCount() const { return mFinished.load(); }
+		bool isBusy() const { return mFinished.load() < mQueued.load(); }
+
+		AnalysisStore& getStore() { return mStore; }
+		/// Message thread. Descriptors of the rows of the snapshot last passed to analyse, keep the
+		/// pointer as long as needed, rows filled in later go to a copy
+		std::shared_ptr<const DescriptorTable> getDescriptorTable() const { return mTable; }
+
+		/// Message thread. Hands waiting results to their samples now, for callers blocking the message loop
+		void deliverResults() { handleUpdateNowIfNeeded(); }
+
+		/// Any thread. Decodes and analyses file right away, nothing is stored
+		SampleAnalysis analyseFile(const File& file);
+	private:
+		class AnalysisJob;
+		struct Result
+		{
+			std::weak_ptr<SampleRow> mRow;
+			bool mFailed = false; //unreadable, nothing to hand over
+			uint64 mContentHash = 0;
+			SampleAnalysis mAnalysis;
+		};
+		using RowSet = std::set<std::weak_ptr<SampleRow>, std::owner_less<std::weak_ptr<SampleRow>>>;
+
+		//Worker threads
+		void analyseSample(const std::shared_ptr<SampleRow>& row);
+		void addResult(Result result);
+		bool isCancelled() const { return mCancelled.load(); }
+
+		void handleAsyncUpdate() override;
+
+		static const int SAMPLES_PER_JOB = 64;
+		static constexpr double ANALYSIS_RATE = 22050.0; //keeps cymbal and hat brightness in the descriptors
+		static constexpr double MAX_SECONDS = 30.0; //enough beats for anything longer
+
+		AnalysisStore mStore;
+		AudioFormatManager mFormatManager;
+		ThreadPool mPool;
+		std::atomic<bool> mCancelled { false };
+		std::atomic<int> mQueued { 0 };
+		std::atomic<int> mFinished { 0 };
+
+		//message thread
+		std::shared_ptr<DescriptorTable> mTable;
+		std::shared_ptr<const LibrarySnapshot::Rows> mRows; //the table was built for these
+		std::unordered_map<const SampleRow*, int> mRowIndices; //table row of each of mRows
+		RowSet mInQueue; //queued and not delivered yet, whichever snapshot they came from
+
+		CriticalSection mResultLock;
+		std::vector<Result> mResults; //waiting for the message thread
+
+		JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LibraryAnalyser)
+	};
+}
+#endif
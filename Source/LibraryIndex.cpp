@@ -0,0 +1,164 @@
+#include "LibraryIndex.h"
+#include "Tracer.h"
+#include "AnalysisStore.h"
+
+using namespace samplore;
+
+LibraryIndex::LibraryIndex(const File& file) : mFile(file)
+{
+	if (!load())
+	{
+		mRoots.clear(); //keep nothing from a torn file
+	}
+}
+
+const LibraryIndex::Folder* LibraryIndex::find(const File& root, const String& wildcard) const
+{
+	auto it = mRoots.find(root.getFullPathName());
+	return it != mRoots.end() && it->second.mWildcard == wildcard ? &it->second.mFolder : nullptr;
+}
+
+void LibraryIndex::set(const File& root, const String& wildcard, Folder folder)
+{
+	mRoots[root.getFullPathName()] = { wildcard, std::move(folder) };
+}
+
+void LibraryIndex::forget(const File& root)
+{
+	mRoots.erase(root.getFullPathName());
+	mForgotten.insert(root.getFullPathName());
+}
+
+bool LibraryIndex::load()
+{
+	SAMPLORE_TRACE_ZONE("LibraryIndex::load");
+	MemoryBlock data; //one read, then parsed from memory
+	if (!mFile.loadFileAsData(data))
+	{
+		return true; //nothing indexed yet
+	}
+	MemoryInputStream in(data, false);
+	if (in.readInt() != MAGIC || in.readInt() != VERSION)
+	{
+		return false;
+	}
+	const int roots = in.readInt();
+	for (int i = 0; i < roots && !in.isExhausted(); i++)
+	{
+		const String path = in.readString();
+		Root root;
+		root.mWildcard = in.readString();
+		if (!readFolder(in, root.mFolder, 0))
+		{
+			return false;
+		}
+		mRoots[path] = std::move(root);
+	}
+	return in.readInt() == MAGIC; //written last, a file cut short reads zeros instead
+}
+
+bool LibraryIndex::readFolder(InputStream& in, Folder& folder, int depth)
+{
+	folder.mName = in.readString();
+	folder.mModified = in.readInt64();
+	const int samples = in.readInt();
+	//every entry takes at least a byte, larger counts than what is left are corrupt
+	if (depth > MAX_DEPTH || samples < 0 || samples > in.getNumBytesRemaining())
+	{
+		return false;
+	}
+	folder.mSamples.resize((size_t)samples);
+	for (SampleEntry& entry : folder.mSamples)
+	{
+		entry.mName = in.readString();
+		entry.mContentHash = (uint64)in.readInt64();
+		entry.mSize = in.readInt64();
+		entry.mModified = in.readInt64();
+		const int tags = in.readInt();
+		if (tags < 0 || tags > in.getNumBytesRemaining())
+		{
+			return false;
+		}
+		for (int t = 0; t < tags; t++)
+		{
+			entry.mTags.add(in.readString());
+		}
+	}
+	const int folders = in.readInt();
+	if (folders < 0 || folders > in.getNumBytesRemaining())
+	{
+		return false;
+	}
+	folder.mFolders.resize((size_t)folders);
+	for (Folder& child : folder.mFolders)
+	{
+		if (!readFolder(in, child, depth + 1))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool LibraryIndex::save()
+{
+	SAMPLORE_TRACE_ZONE("LibraryIndex::save");
+	const InterProcessLock::ScopedLockType processLock(AnalysisStore::getProcessLock());
+	{
+		LibraryIndex stored(mFile);
+		for (auto& root : stored.mRoots)
+		{
+			if (mRoots.count(root.first) == 0 && mForgotten.count(root.first) == 0)
+				mRoots[root.first] = std::move(root.second);
+		}
+	}
+	mFile.getParentDirectory().createDirectory();
+	TemporaryFile temp(mFile);
+	{
+		FileOutputStream out(temp.getFile());
+		if (out.failedToOpen())
+		{
+			return false;
+		}
+		out.writeInt(MAGIC);
+		out.writeInt(VERSION);
+		out.writeInt((int)mRoots.size());
+		for (const auto& root : mRoots)
+		{
+			out.writeString(root.first);
+			out.writeString(root.second.mWildcard);
+			writeFolder(out, root.second.mFolder);
+		}
+		out.writeInt(MAGIC);
+		out.flush();
+		if (!out.getStatus().wasOk())
+		{
+			return false;
+		}
+	}
+	return temp.overwriteTargetFileWithTemporary();
+}
+
+void LibraryIndex::writeFolder(OutputStream& out, const Folder& folder)
+{
+	out.writeString(folder.mName);
+	out.writeInt64(folder.mModified);
+	out.writeInt((int)folder.mSamples.size());
+	for (const SampleEntry& entry : folder.mSamples)
+	{
+		out.writeString(entry.mName);
+		out.writeInt64((int64)entry.mContentHash);
+		out.writeInt64(entry.mSize);
+		out.writeInt64(entry.mModified);
+		out.writeInt(entry.mTags.size());
+		for (const String& tag : entry.mTags)
+		{
+			out.writeString(tag);
+		}
+	}
+	out.writeInt((int)folder.mFolders.size());
+	for (const Folder& child : folder.mFolders)
+	{
+		writeFolder(out, child);
+	}
+}
@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+
+    LibraryIndex.h
+    Author:  Jake Rose
+
+	The folder trees of the sample directories as they were last seen, with
+	every sample's content hash and tags, in one file in the app data folder.
+	Startup rebuilds the tree from it instead of listing every folder and
+	parsing a metadata file per sample. Only folders whose modification time
+	changed are listed again, the folders below an unchanged one are checked
+	once expanded or rescanned. A sample's metadata file is read the first
+	time something beyond its tags is needed. Each entry keeps the size and
+	modification time the file had, a file overwritten in place does not
+	change its folder and is caught by those instead.
+
+  ==============================================================================
+*/
+
+#ifndef LIBRARYINDEX_H
+#define LIBRARYINDEX_H
+
+#include "JuceHeader.h"
+
+#include <map>
+#include <set>
+#include <vector>
+
+namespace samplore
+{
+	class LibraryIndex
+	{
+	public:
+		struct SampleEntry
+		{
+			String mName;
+			uint64 mContentHash = 0;
+			StringArray mTags;
+			int64 mSize = -1; //of the file when indexed, negative if unknown so it never matches
+			int64 mModified = 0; //milliseconds
+		};
+		struct Folder
+		{
+			String mName;
+			int64 mModified = 0; //of the folder itself, changes when entries are added, removed or renamed
+			std::vector<SampleEntry> mSamples;
+			std::vector<Folder> mFolders;
+		};
+
+		/// Reads file, an unreadable or older index is treated as empty
+		explicit LibraryIndex(const File& file);
+
+		/// Tree last stored for root, nullptr if it was never indexed or listed with another wildcard
+		const Folder* find(const File& root, const String& wildcard) const;
+		void set(const File& root, const String& wildcard, Folder folder);
+		/// Drops root, also from the file when saving
+		void forget(const File& root);
+		/// Writes every root, replacing the file only once the new one is complete. Roots another
+		/// process stored since we loaded are kept unless forgotten, so a command line run over
+		/// other directories does not lose the app's
+		bool save();
+
+		static File getDefaultFile(const File& analysisStoreFile) { return analysisStoreFile.getSiblingFile("LibraryIndex.bin"); }
+	private:
+		bool load();
+		static bool readFolder(InputStream& in, Folder& folder, int depth);
+		static void writeFolder(OutputStream& out, const Folder& folder);
+
+		static const int MAGIC = 0x58444953; //"SIDX"
+		static const int VERSION = 3; //1 held content hashes of sampled large payloads, 2 no file sizes or times
+		static const int MAX_DEPTH = 256; //deeper trees in the file are corrupt
+
+		struct Root
+		{
+			String mWildcard; //the formats it was listed with, a new format means listing again
+			Folder mFolder;
+		};
+
+		File mFile;
+		std::map<String, Root> mRoots; //by full path
+		std::set<String> mForgotten;
+
+		JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LibraryIndex)
+	};
+}
+#endif
@@ -0,0 +1,64 @@
+/*
+  ==============================================================================
+
+    LibrarySnapshot.h
+    Author:  Jake Rose
+
+	Immutable, versioned view of every sample in the library. The message thread
+	builds a new one whenever folders are scanned, added, removed or checked and
+	swaps it in, background queries keep reading whichever one they started with.
+	Checking a folder only changes the enabled bits, the sample rows are shared
+	with the previous snapshot. Rows hold what queries read, the Sample behind
+	one is made when a result needs it, see SampleRow.
+
+  ==============================================================================
+*/
+
+#ifndef LIBRARYSNAPSHOT_H
+#define LIBRARYSNAPSHOT_H
+
+#include "JuceHeader.h"
+
+#include "SampleRow.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace samplore
+{
+	class SampleDirectory;
+
+	struct LibrarySnapshot
+	{
+		using Rows = std::vector<std::shared_ptr<SampleRow>>;
+		using FolderRanges = std::unordered_map<const SampleDirectory*, Range<int>>;
+
+		uint64 mVersion = 0;
+		/// Changes only when rows do, not when folders are checked
+		uint64 mRowsVersion = 0;
+		/// Every root's sample table back to back, each in folder pre-order
+		std::shared_ptr<const Rows> mSamples = std::make_shared<const Rows>();
+		/// Bit per row, set if the owning folder was checked when published
+		BigInteger mEnabled;
+		/// Roots at publish time, the index of their first sample and their table version, only compare the pointers
+		std::vector<const SampleDirectory*> mRoots;
+		std::vector<int> mRootStarts;
+		std::vector<uint64> mRootTableVersions;
+		std::vector<uint64> mRootLayoutVersions;
+
+		/// Rows of each built folder's subtree, laid out with the rows so the tree can be rescanned before we are replaced
+		std::shared_ptr<const FolderRanges> mFolderRanges = std::make_shared<const FolderRanges>();
+
+		int size() const { return (int)mSamples->size(); }
+		const Rows& getSamples() const { return *mSamples; }
+		const std::shared_ptr<SampleRow>& getRow(int row) const { return (*mSamples)[(size_t)row]; }
+
+		/// Rows below folder and in it, every row if it was not in the library when published
+		Range<int> getFolderRange(const SampleDirectory* folder) const
+		{
+			auto it = mFolderRanges->find(folder);
+			return it != mFolderRanges->end() ? it->second : Range<int>(0, size());
+		}
+	};
+}
+#endif
@@ -22,6 +22,8 @@
 #include "ThemeManager.h"
 #include "UI/IconLibrary.h"
 #include "KeyBindingManager.h"
+#include "HeadlessCommands.h"
+#include "Tracer.h"
 
 namespace samplore
 {
@@ -33,11 +35,25 @@ namespace samplore
 
 		const String getApplicationName() override { return ProjectInfo::projectName; }
 		const String getApplicationVersion() override { return ProjectInfo::versionString; }
-		bool moreThanOneInstanceAllowed() override { return false; }
+		bool moreThanOneInstanceAllowed() override { return HeadlessCommands::isCommand(getArguments()); }
 
 		//==============================================================================
 		void initialise(const String& commandLine) override
 		{
+			if (getCommandLineParameterArray().contains("--trace"))
+			{
+				Tracer::start(); //written out on shutdown
+				Tracer::setThreadName("Message");
+			}
+			if (HeadlessCommands::isCommand(getArguments()))
+			{
+				//scripted use, no window and none of the GUI singletons
+				mHeadless = true;
+				setApplicationReturnValue(HeadlessCommands::run(getArguments()));
+				stopTrace();
+				quit();
+				return;
+			}
 			/*
 			Time timeToKill = Time(2020, 8, 1, 0, 0); //month is between 0-11
 			Time cTime = Time::getCurrentTime();
@@ -62,7 +78,12 @@ namespace samplore
 
 		void shutdown() override
 		{
+			if (mHeadless)
+			{
+				return;
+			}
 			mainWindow.reset(nullptr); //(deletes our window)
+			stopTrace();
 			SamplifyProperties::cleanupInstance();
 			KeyBindingManager::cleanupInstance();
 			IconLibrary::cleanupInstance();
@@ -169,6 +190,25 @@ namespace samplore
 
 	private:
 		std::unique_ptr<MainWindow> mainWindow;
+		bool mHeadless = false;
+
+		/// Command line without the flags that apply to every mode
+		static StringArray getArguments()
+		{
+			StringArray args = getCommandLineParameterArray();
+			args.removeString("--trace");
+			return args;
+		}
+
+		void stopTrace()
+		{
+			if (Tracer::isEnabled())
+			{
+				const File file = Tracer::getDefaultFile();
+				if (Tracer::stop(file))
+					Logger::writeToLog("trace written to " + file.getFullPathName());
+			}
+		}
 	};
 
 }
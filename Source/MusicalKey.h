@@ -0,0 +1,100 @@
+/*
+  ==============================================================================
+
+    MusicalKey.h
+    Author:  Jake Rose
+
+	Keys as a single int, the tonic's pitch class with 12 added for minor.
+	Names both ways, plus Camelot numbers so sorting puts harmonically
+	compatible keys next to each other.
+
+  ==============================================================================
+*/
+
+#ifndef MUSICALKEY_H
+#define MUSICALKEY_H
+
+#include "JuceHeader.h"
+
+#include <limits>
+
+struct MusicalKey
+{
+	static const int NUM_KEYS = 24;
+	static const int UNKNOWN = -1; //not analysed yet
+	static const int NONE = NUM_KEYS; //analysed, nothing tonal in it
+
+	static bool isKey(int key) { return key >= 0 && key < NUM_KEYS; }
+	static bool isMinor(int key) { return key >= 12; }
+	static int getTonic(int key) { return key % 12; }
+
+	/// "C#", "Am", empty if key is not a key
+	static String getName(int key)
+	{
+		static const char* const names[] = { "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B" };
+		if (!isKey(key))
+			return {};
+		return String(names[getTonic(key)]) + (isMinor(key) ? "m" : "");
+	}
+
+	/// Wheel position 1 to 12, fifths apart, a minor key shares its relative major's number
+	static int getCamelotNumber(int key)
+	{
+		const int major = isMinor(key) ? (getTonic(key) + 3) % 12 : getTonic(key);
+		return (7 * major + 7) % 12 + 1;
+	}
+
+	static String getCamelotName(int key)
+	{
+		return isKey(key) ? String(getCamelotNumber(key)) + (isMinor(key) ? "A" : "B") : String();
+	}
+
+	/// Ascending around the Camelot wheel, minor before its relative major, anything else last
+	static float getSortValue(int key)
+	{
+		if (!isKey(key))
+			return std::numeric_limits<float>::max();
+		return (float)(getCamelotNumber(key) * 2 + (isMinor(key) ? 0 : 1));
+	}
+
+	/// Accepts "Am", "A min", "Bbm", "F#", "C major" and Camelot "8A", UNKNOWN if it is none of those
+	static int fromName(const String& text)
+	{
+		String name = text.trim().toLowerCase().removeCharacters(" ");
+		if (name.isEmpty())
+			return UNKNOWN;
+		if (CharacterFunctions::isDigit(name[0]))
+		{
+			const int number = name.getIntValue();
+			const juce_wchar letter = name.getLastCharacter();
+			if (number < 1 || number > 12 || (letter != 'a' && letter != 'b') || name.length() > String(number).length() + 1)
+				return UNKNOWN;
+			const int major = (7 * (number - 8) % 12 + 12) % 12; //7 is its own inverse mod 12
+			return letter == 'b' ? major : 12 + (major + 9) % 12;
+		}
+		static const int letterPitches[] = { 9, 11, 0, 2, 4, 5, 7 }; //a to g
+		if (name[0] < 'a' || name[0] > 'g')
+			return UNKNOWN;
+		int tonic = letterPitches[name[0] - 'a'];
+		int next = 1;
+		if (name[1] == '#')
+		{
+			tonic++;
+			next++;
+		}
+		else if (name[1] == 'b')
+		{
+			tonic--;
+			next++;
+		}
+		tonic = (tonic + 12) % 12;
+		const String quality = name.substring(next);
+		if (quality.isEmpty() || quality == "maj" || quality == "major")
+			return tonic;
+		if (quality == "m" || quality == "min" || quality == "minor")
+			return 12 + tonic;
+		return UNKNOWN;
+	}
+};
+
+#endif
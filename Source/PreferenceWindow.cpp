@@ -669,7 +669,7 @@ void PreferenceWindow::View::updateDirectoryList()
     // Clear existing list items
     mDirectoryListContainer.removeAllChildren();
     
-    auto dirs = SamplifyProperties::getInstance()->getSampleLibrary()->getDirectories();
+    const auto& dirs = SamplifyProperties::getInstance()->getSampleLibrary()->getDirectories();
     int y = 0;
     const int itemHeight = 40;
     int width = 550; // Fixed width based on viewport
@@ -1,12 +1,63 @@
 #include "Sample.h"
 #include <string>
+#include <limits>
 #include "SamplifyProperties.h"
+#include "SampleDirectory.h"
+#include "SampleRow.h"
+#include "Tracer.h"
+#include "Diagnostics.h"
 
 using namespace samplore;
 
-Sample::Sample(const File& file) : mFile(file)
+namespace
 {
-	mPropertiesFile.reset(getPropertiesFile(mFile));
+	String getLegacyPropertiesName(const File& sampleFile)
+	{
+		return sampleFile.getFullPathName().removeCharacters("\\:") + ".sample";
+	}
+
+	/// Tags of both, the description of from only if into has none
+	void mergeProperties(const PropertiesFile& from, PropertiesFile& into)
+	{
+		const String version(ProjectInfo::versionNumber);
+		if (from.getValue("VersionNumber") != version)
+		{
+			return; //nothing loadPropertiesFile would read
+		}
+		if (into.getValue("VersionNumber") != version)
+		{
+			into.clear();
+			into.addAllPropertiesFrom(from);
+			return;
+		}
+		StringArray tags;
+		for (const PropertiesFile* file : { (const PropertiesFile*)&into, &from })
+		{
+			for (int i = 0; i < file->getIntValue("TagCount"); i++)
+				tags.addIfNotAlreadyThere(file->getValue("Tag" + String(i)));
+		}
+		into.setValue("TagCount", tags.size());
+		for (int i = 0; i < tags.size(); i++)
+		{
+			into.setValue("Tag" + String(i), tags[i]);
+		}
+		if (into.getValue("Description").isEmpty())
+		{
+			into.setValue("Description", from.getValue("Description"));
+		}
+	}
+}
+
+Sample::Sample(const File& file, SampleDirectory* rootDirectory) : mFile(file), mRootDirectory(rootDirectory)
+{
+	SAMPLORE_TRACE_ZONE("Sample::loadProperties"); //PropertiesFile parsing, the bulk of a scan
+	mFileSize = mFile.getSize();
+	mFileModified = mFile.getLastModificationTime().toMilliseconds();
+	if (AnalysisStore* store = getAnalysisStore())
+	{
+		mContentHash = store->findContentHash(mFile); //unchanged since the analyser last hashed it
+	}
+	openPropertiesFile();
 	if (mPropertiesFile->isValidFile())
 	{
 		loadPropertiesFile();
@@ -16,29 +67,269 @@ Sample::Sample(const File& file) : mFile(file)
 		//todo add what to do for new files
 
 	}
+	publishRecord();
+}
+
+Sample::Sample(const File& file, SampleDirectory* rootDirectory, const LibraryIndex::SampleEntry& entry, bool checked)
+	: mFile(file), mContentHash(entry.mContentHash), mRootDirectory(rootDirectory), mTags(entry.mTags),
+	mFileSize(entry.mSize), mFileModified(entry.mModified), mUnverified(!checked)
+{
+	registerSharedProperties(); //so edits to a copy reach us before our file is read
+	publishRecord();
 }
 
 Sample::~Sample()
 {
+	closePropertiesFile(); //first, a copy being edited may call reloadPropertiesFile until we are out
 	// Remove ourselves as a listener from the thumbnail if it exists
 	if (mThumbnail)
 	{
 		mThumbnail->removeChangeListener(this);
 	}
+	if (mThumbnailPending)
+	{
+		Diagnostics::getThumbnailsPending()--;
+	}
 }
 
 bool Sample::isPropertiesFileValid()
 {
+	loadDeferredProperties();
 	return mPropertiesFile->isValidFile();
 }
 
-bool Sample::isQueryValid(juce::String query)
+bool Sample::isQueryValid(const SearchFilter& filter) const
+{
+	return getRecord()->matches(filter);
+}
+
+void Sample::setAnalysis(const SampleAnalysis& analysis)
+{
+	const bool descriptorChanged = analysis.mHasDescriptor && (mDescriptor == nullptr || !(*mDescriptor == analysis.mDescriptor));
+	if (analysis.mTempo != mTempo || analysis.mKey != mKey || descriptorChanged)
+	{
+		mTempo = analysis.mTempo;
+		mKey = analysis.mKey;
+		if (descriptorChanged)
+		{
+			mDescriptor = std::make_shared<const SampleDescriptor>(analysis.mDescriptor);
+		}
+		publishRecord();
+	}
+}
+
+void Sample::setContentHash(uint64 contentHash)
+{
+	if (contentHash == 0)
+	{
+		return;
+	}
+	if (mUnverified)
+	{
+		mUnverified = false; //the analyser read the file as it is now, no need to look at it again
+		if (mContentHash != 0 && contentHash != mContentHash)
+		{
+			forgetIndexedEntry(); //the tags it gave belong to what the file held before
+		}
+	}
+	if (contentHash == mContentHash)
+	{
+		return;
+	}
+	loadDeferredProperties();
+	//set before hashing or under the content before an edit, they stay with the file
+	const StringArray tags = mTags;
+	const String description = mInformationDescription;
+	closePropertiesFile();
+	mContentHash = contentHash;
+	openPropertiesFile();
+	mTags.clear();
+	loadPropertiesFile();
+	const StringArray loaded = mTags;
+	const String loadedDescription = mInformationDescription;
+	mTags.mergeArray(tags);
+	if (loadedDescription.isEmpty())
+	{
+		mInformationDescription = description;
+	}
+	if (mTags != loaded || mInformationDescription != loadedDescription)
+	{
+		savePropertiesFile();
+	}
+	if (mTags != tags)
+	{
+		//moved here from somewhere else, or a copy of a tagged file
+		publishRecord();
+		notifyMetadataChanged();
+	}
+}
+
+void Sample::openPropertiesFile()
+{
+	const File legacy = getPropertiesFolder().getChildFile(getLegacyPropertiesName(mFile));
+	if (mContentHash == 0)
+	{
+		mPropertiesFile.reset(getPropertiesFile(mFile));
+		return;
+	}
+	registerSharedProperties();
+	{
+		const ScopedLock sl(getSharedPropertiesLock());
+		SharedProperties& shared = getSharedProperties()[mContentHash];
+		if (shared.mFile == nullptr)
+		{
+			shared.mFile.reset(getPropertiesFile(mContentHash));
+		}
+		mPropertiesFile = shared.mFile;
+	}
+	if (legacy.existsAsFile())
+	{
+		//written before content hashes or before the analyser got here, merge it in once
+		std::unique_ptr<PropertiesFile> byPath(getPropertiesFile(mFile));
+		mergeProperties(*byPath, *mPropertiesFile);
+		byPath = nullptr;
+		if (mPropertiesFile->saveIfNeeded())
+		{
+			legacy.deleteFile();
+		}
+	}
+}
+
+void Sample::closePropertiesFile()
+{
+	if (mContentHash != 0)
+	{
+		const ScopedLock sl(getSharedPropertiesLock());
+		auto it = getSharedProperties().find(mContentHash);
+		if (it != getSharedProperties().end())
+		{
+			std::vector<Sample*>& samples = it->second.mSamples;
+			samples.erase(std::remove(samples.begin(), samples.end(), this), samples.end());
+			if (samples.empty())
+			{
+				getSharedProperties().erase(it);
+			}
+		}
+	}
+	mPropertiesFile = nullptr; //saves pending changes if we were the last
+}
+
+void Sample::registerSharedProperties()
+{
+	if (mContentHash == 0)
+	{
+		return;
+	}
+	const ScopedLock sl(getSharedPropertiesLock());
+	std::vector<Sample*>& samples = getSharedProperties()[mContentHash].mSamples;
+	if (std::find(samples.begin(), samples.end(), this) == samples.end())
+	{
+		samples.push_back(this);
+	}
+}
+
+void Sample::reloadPropertiesFile()
+{
+	if (mPropertiesFile == nullptr)
+	{
+		loadDeferredProperties();
+		return;
+	}
+	const StringArray tags = mTags;
+	mTags.clear();
+	loadPropertiesFile();
+	if (mTags != tags)
+	{
+		publishRecord();
+	}
+	sendChangeMessage();
+}
+
+void Sample::loadDeferredProperties()
+{
+	if (mPropertiesFile != nullptr)
+	{
+		return;
+	}
+	SAMPLORE_TRACE_ZONE("Sample::loadProperties");
+	verifyIndexedEntry();
+	openPropertiesFile();
+	const StringArray tags = mTags;
+	mTags.clear();
+	loadPropertiesFile();
+	if (mTags != tags)
+	{
+		//tagged by something else since the index was written
+		publishRecord();
+		notifyMetadataChanged();
+	}
+}
+
+LibraryIndex::SampleEntry Sample::getIndexEntry() const
+{
+	LibraryIndex::SampleEntry entry;
+	entry.mName = mFile.getFileName();
+	entry.mContentHash = mContentHash;
+	entry.mTags = mTags;
+	entry.mSize = mFileSize;
+	entry.mModified = mFileModified;
+	return entry;
+}
+
+void Sample::verifyIndexedEntry()
+{
+	if (!mUnverified)
+	{
+		return;
+	}
+	mUnverified = false;
+	const int64 size = mFile.getSize();
+	const int64 modified = mFile.getLastModificationTime().toMilliseconds();
+	if (size == mFileSize && modified == mFileModified)
+	{
+		return;
+	}
+	//overwritten in place, its folder looked untouched
+	forgetIndexedEntry();
+	mFileSize = size;
+	mFileModified = modified;
+	if (AnalysisStore* store = getAnalysisStore())
+	{
+		mContentHash = store->findContentHash(mFile);
+		registerSharedProperties();
+	}
+}
+
+void Sample::forgetIndexedEntry()
 {
-	if(mFile.getFullPathName().containsIgnoreCase(query) || mTags.contains("#" + query))
+	closePropertiesFile();
+	mContentHash = 0;
+	mFileSize = -1; //never matches, the next launch reads it like a new file
+	if (!mTags.isEmpty())
 	{
-		return true;
+		mTags.clear();
+		publishRecord();
+		notifyMetadataChanged();
 	}
-	return false;
+}
+
+void Sample::publishRecord()
+{
+	auto record = std::make_shared<Record>();
+	record->mFile = mFile;
+	record->mTags = mTags;
+	record->mTempo = mTempo;
+	record->mKey = mKey;
+	record->mDescriptor = mDescriptor;
+	std::atomic_store(&mRecord, std::shared_ptr<const Record>(record));
+}
+
+void Sample::takeAnalysis(const Record& record)
+{
+	mTempo = record.mTempo;
+	mKey = record.mKey;
+	mDescriptor = record.mDescriptor;
+	publishRecord();
 }
 
 /* deprecated
@@ -72,32 +363,55 @@ void Sample::determineSampleType()
 
 void Sample::changeListenerCallback(ChangeBroadcaster * source)
 {
+	if (mThumbnailPending && source == mThumbnail.get() && mThumbnail->isFullyLoaded())
+	{
+		mThumbnailPending = false;
+		Diagnostics::getThumbnailsPending()--;
+	}
 	sendChangeMessage();
 }
 
-PropertiesFile* Sample::getPropertiesFile(const File& sampleFile)
+PropertiesFile::Options Sample::getPropertiesOptions()
 {
-	String folderName = sampleFile.getFullPathName();
 	PropertiesFile::Options options = PropertiesFile::Options();
-	//options.folderName = sampleFile.get
 	options.applicationName = "SampleProperties";
 	options.filenameSuffix = ".sample";
 	options.commonToAllUsers = false;
 	options.folderName = "Samplore";
 	options.osxLibrarySubFolder = "Application Support/Samplore";
-	/*
-	else if (SystemStats::getOperatingSystemType() == SystemStats::OperatingSystemType::Windows)
+	options.processLock = &AnalysisStore::getProcessLock(); //a command line run may save the same file
+	return options;
+}
+
+void Sample::notifyMetadataChanged()
+{
+	if (SamplifyProperties* properties = SamplifyProperties::getInstance()) //none without the app
 	{
+		properties->getSampleLibrary()->sampleMetadataChanged();
 	}
-	*/
-	String path = options.getDefaultFile().getFullPathName();
-	PropertiesFile* file = new PropertiesFile(File(path.substring(0, path.length() - options.getDefaultFile().getFileName().length()) + String(File::getSeparatorString()) + "SampleProperties").getChildFile(sampleFile.getFullPathName().removeCharacters("\\:") + ".sample"), options);
-	return file;
+}
+
+void Sample::requestContentHash(const std::shared_ptr<SampleRow>& row)
+{
+	if (SamplifyProperties* properties = SamplifyProperties::getInstance())
+	{
+		properties->getSampleLibrary()->hashSample(row);
+	}
+}
+
+PropertiesFile* Sample::getPropertiesFile(const File& sampleFile)
+{
+	return new PropertiesFile(getPropertiesFolder().getChildFile(getLegacyPropertiesName(sampleFile)), getPropertiesOptions());
+}
+
+PropertiesFile* Sample::getPropertiesFile(uint64 contentHash)
+{
+	return new PropertiesFile(getPropertiesFolder().getChildFile(String::toHexString((int64)contentHash).paddedLeft('0', 16) + ".sample"), getPropertiesOptions());
 }
 
 void Sample::savePropertiesFile()
 {
-	if (mPropertiesFile->isValidFile())
+	if (mPropertiesFile != nullptr && mPropertiesFile->isValidFile()) //still deferred means nothing changed
 	{
 		mPropertiesFile->clear();
 		mPropertiesFile->setValue("VersionNumber", String(ProjectInfo::versionNumber));
@@ -109,12 +423,31 @@ void Sample::savePropertiesFile()
 		mPropertiesFile->setValue("Color", mColor.toString());
 		mPropertiesFile->setValue("Description", mInformationDescription);
 	}
-
+	//copies of the same content write the same file, they would otherwise save over this with what they read before
+	if (mContentHash == 0)
+	{
+		return;
+	}
+	//held throughout, a copy released on a worker waits in closePropertiesFile until we are done with it
+	const ScopedLock sl(getSharedPropertiesLock());
+	auto it = getSharedProperties().find(mContentHash);
+	if (it == getSharedProperties().end())
+	{
+		return;
+	}
+	const std::vector<Sample*> copies = it->second.mSamples; //reloading may leave the registry
+	for (Sample* copy : copies)
+	{
+		if (copy != this)
+		{
+			copy->reloadPropertiesFile();
+		}
+	}
 }
 
 void Sample::loadPropertiesFile()
 {
-	if (mPropertiesFile->isValidFile())
+	if (mPropertiesFile != nullptr && mPropertiesFile->isValidFile())
 	{
 		if (mPropertiesFile->getValue("VersionNumber") == String(ProjectInfo::versionNumber))
 		{
@@ -140,54 +473,78 @@ void Sample::loadPropertiesFile()
 StringArray Sample::Reference::getRelativeParentFolders() const
 {
 	jassert(!isNull());
-	std::shared_ptr<Sample> sample = mSample.lock();
+	std::shared_ptr<Sample> sample = getSample();
 	StringArray folders;
-	File file(sample->mFile);
-	File root = SamplifyProperties::getInstance()->getSampleLibrary()->getRelativeDirectoryForFile(file);
-	while (file.isAChildOf(root))
+	if (sample->mRootDirectory == nullptr)
+	{
+		return folders;
+	}
+	//from the path, the folders below the root may not have been built
+	const File root = sample->mRootDirectory->getFile();
+	File dir = sample->mFile.getParentDirectory();
+	while (dir.isAChildOf(root))
 	{
-		file = file.getParentDirectory();
-		folders.add(file.getFileName());
+		folders.add(dir.getFileName());
+		dir = dir.getParentDirectory();
+	}
+	if (dir == root)
+	{
+		folders.add(root.getFileName());
 	}
 	return folders;
 }
 
 
-Sample::Reference::Reference(std::shared_ptr<Sample> sample)
+Sample::Reference::Reference(std::shared_ptr<SampleRow> row)
 {
-	mSample = sample;
+	mRow = row;
 }
 
-Sample::Reference::Reference(nullptr_t null) : mSample() { jassert(isNull()); }
+Sample::Reference::Reference(nullptr_t null) : mRow() { jassert(isNull()); }
 
 Sample::Reference::Reference(const Sample::Reference& ref)
 {
-	mSample = ref.mSample;
+	mRow = ref.mRow;
+}
+
+std::shared_ptr<Sample> Sample::Reference::getSample() const
+{
+	std::shared_ptr<SampleRow> row = mRow.lock();
+	return row != nullptr ? row->getSample() : nullptr;
+}
+
+std::shared_ptr<const Sample::Record> Sample::Reference::getRecord() const
+{
+	std::shared_ptr<SampleRow> row = mRow.lock();
+	return row != nullptr ? row->getRecord() : nullptr;
 }
 
 std::shared_ptr<SampleAudioThumbnail> Sample::Reference::getThumbnail() const
 {
 	jassert(!isNull());
-	return mSample.lock()->mThumbnail;
+	return getSample()->mThumbnail;
 }
 
 File Sample::Reference::getFile() const
 {
 	jassert(!isNull());
-	return mSample.lock()->mFile;
+	return getRecord()->mFile;
 }
 
 String Sample::Reference::getInfoText() const
 {
 	jassert(!isNull());
-	return mSample.lock()->mInformationDescription;
+	std::shared_ptr<Sample> sample = getSample();
+	sample->loadDeferredProperties();
+	return sample->mInformationDescription;
 }
 
 void Sample::Reference::setInfoText(String newText) const
 {
 	jassert(!isNull());
 	newText = newText.removeCharacters("\n"); //prevent errors, might need to remove more too
-	std::shared_ptr<Sample> sample = mSample.lock();
+	std::shared_ptr<Sample> sample = getSample();
+	sample->loadDeferredProperties();
 
 	sample->mInformationDescription =newText;
 	sample->savePropertiesFile();
@@ -197,19 +554,41 @@ void Sample::Reference::setInfoText(String newText) const
 void Sample::Reference::setColor(Colour newColor)
 {
 	jassert(!isNull());
-	mSample.lock()->mColor = newColor;
+	std::shared_ptr<Sample> sample = getSample();
+	sample->loadDeferredProperties();
+	sample->mColor = newColor;
 }
 
 Colour samplore::Sample::Reference::getColor() const
 {
 	jassert(!isNull());
-	return mSample.lock()->mColor;
+	std::shared_ptr<Sample> sample = getSample();
+	sample->loadDeferredProperties();
+	return sample->mColor;
 }
 
 double Sample::Reference::getLength() const
 {
 	jassert(!isNull());
-	return mSample.lock()->mLength;
+	return getSample()->mLength;
+}
+
+float Sample::Reference::getTempo() const
+{
+	jassert(!isNull());
+	return getRecord()->mTempo;
+}
+
+int Sample::Reference::getKey() const
+{
+	jassert(!isNull());
+	return getRecord()->mKey;
+}
+
+std::shared_ptr<const SampleDescriptor> Sample::Reference::getDescriptor() const
+{
+	jassert(!isNull());
+	return getRecord()->mDescriptor;
 }
 
 
@@ -217,18 +596,27 @@ double Sample::Reference::getLength() const
 StringArray Sample::Reference::getTags() const
 {
 	jassert(!isNull());
-	return mSample.lock()->mTags;
+	return getRecord()->mTags;
+}
+
+bool Sample::Reference::isQueryValid(const SearchFilter& filter) const
+{
+	std::shared_ptr<const Record> record = getRecord();
+	return record != nullptr && record->matches(filter);
 }
 
 void Sample::Reference::addTag(juce::String tag)
 {
 	if (!isNull())
 	{
-		std::shared_ptr<Sample> sample = mSample.lock();
+		std::shared_ptr<Sample> sample = getSample();
+		sample->loadDeferredProperties();
 		if (!sample->mTags.contains(tag))
 		{
 			sample->mTags.add(tag);
+			sample->publishRecord();
 			sample->savePropertiesFile();
+			notifyMetadataChanged();
 		}
 	}
 }
@@ -237,30 +625,39 @@ void Sample::Reference::removeTag(juce::String tag)
 {
 	if (!isNull())
 	{
-		std::shared_ptr<Sample> sample = mSample.lock();
+		std::shared_ptr<Sample> sample = getSample();
+		sample->loadDeferredProperties();
 		if (sample->mTags.contains(tag))
 		{
 			sample->mTags.remove(sample->mTags.indexOf(tag, true));
+			sample->publishRecord();
 			sample->savePropertiesFile();
+			notifyMetadataChanged();
 		}
 	}
 }
 void Sample::Reference::generateThumbnailAndCache()
 {
-	std::shared_ptr<Sample> sample = mSample.lock();
+	SAMPLORE_TRACE_ZONE("Sample::generateThumbnail");
+	std::shared_ptr<Sample> sample = getSample();
 	if (!isNull() && sample->mThumbnail == nullptr)
 	{
 		sample->mThumbnailCache = std::make_shared<AudioThumbnailCache>(1);
 		AudioFormatManager* afm = SamplifyProperties::getInstance()->getAudioPlayer()->getFormatManager();
 		sample->mThumbnail = std::make_shared<SampleAudioThumbnail>(512, *afm, *sample->mThumbnailCache);
 		sample->mThumbnail->addChangeListener(sample->getChangeListener());
-		AudioFormatReader* reader = afm->createReaderFor(sample->mFile);
+		AudioFormatReader* reader = AudioPlayer::createReaderFor(*afm, sample->mFile);
 		if (reader != nullptr)
 		{
-			sample->mThumbnail->setSource(new FileInputSource(sample->mFile));
 			sample->mLength = (float)reader->lengthInSamples / reader->sampleRate;
+			//cached under the content so a renamed file keeps its thumbnail, the modification time
+			//keeps a file edited in place from showing the old one before it is hashed again
+			const uint64 identity = sample->mContentHash != 0 ? sample->mContentHash : (uint64)sample->mFile.hashCode64();
+			const int64 hash = (int64)(identity ^ ((uint64)sample->mFile.getLastModificationTime().toMilliseconds() * 0x9E3779B97F4A7C15ULL));
+			sample->mThumbnail->setReader(reader, hash); //takes ownership
+			sample->mThumbnailPending = true;
+			Diagnostics::getThumbnailsPending()++;
 		}
-		delete reader;
 	}
 	
 }
@@ -269,7 +666,7 @@ void Sample::Reference::addChangeListener(ChangeListener* listener)
 {
 	if (!isNull())
 	{
-		std::shared_ptr<Sample> sample = mSample.lock();
+		std::shared_ptr<Sample> sample = getSample();
 		sample->addChangeListener(listener);
 	}
 }
@@ -278,17 +675,58 @@ void Sample::Reference::removeChangeListener(ChangeListener* listener)
 {
 	if (!isNull())
 	{
-		std::shared_ptr<Sample> sample = mSample.lock();
+		std::shared_ptr<Sample> sample = getSample();
 		sample->removeChangeListener(listener);
 	}
 }
 
 void Sample::Reference::renameFile(String name)
 {
-	//todo test on old library
-	std::shared_ptr<Sample> sample = mSample.lock();
-	sample->mFile.moveFileTo(sample->mFile.getSiblingFile(name));
-	sample->mFile = sample->mFile.getSiblingFile(name);
+	jassert(!isNull());
+	moveFile(getFile().getSiblingFile(name));
+}
+
+bool Sample::Reference::moveFile(const File& destination) const
+{
+	jassert(!isNull());
+	std::shared_ptr<SampleRow> row = mRow.lock();
+	std::shared_ptr<Sample> sample = row->getSample();
+	const File source = sample->mFile;
+	AnalysisStore* store = getAnalysisStore();
+	if (destination == source || !source.moveFileTo(destination))
+	{
+		return false;
+	}
+	sample->mFile = destination;
+	if (store != nullptr)
+	{
+		store->moveContentHash(source, destination);
+	}
+	if (sample->mContentHash == 0)
+	{
+		//not reached by the analyser yet, its metadata is keyed by path and moves along
+		const bool opened = sample->mPropertiesFile != nullptr;
+		sample->mPropertiesFile = nullptr; //saves pending changes
+		const File from = getPropertiesFolder().getChildFile(getLegacyPropertiesName(source));
+		const File to = getPropertiesFolder().getChildFile(getLegacyPropertiesName(destination));
+		if (from.existsAsFile())
+		{
+			from.moveFileTo(to);
+		}
+		else
+		{
+			to.deleteFile(); //left by a file that was there before
+		}
+		if (opened)
+		{
+			sample->mPropertiesFile.reset(getPropertiesFile(destination));
+		}
+		//hashed off the message thread, setContentHash then merges the path keyed file into the shared one
+		requestContentHash(row);
+	}
+	sample->publishRecord();
+	notifyMetadataChanged();
+	return true;
 }
 
 
@@ -337,6 +775,11 @@ void Sample::List::addSamples(const std::vector<Sample::Reference>& samples)
 	addSamples(Sample::List(samples));
 }
 
+void Sample::List::addSection(const String& title)
+{
+	mSections.push_back({ title, size() });
+}
+
 void Sample::List::removeSample(Sample::Reference sample)
 {
 	for (int i = 0; i < mSamples.size(); i++)
@@ -352,6 +795,7 @@ void Sample::List::removeSample(Sample::Reference sample)
 void Sample::List::removeSample(int index)
 {
 	mSamples.erase(mSamples.begin() + index);
+	mSections.clear();
 }
 
 void Sample::List::removeSamples(std::vector<Sample::Reference> samples)
@@ -381,16 +825,20 @@ void Sample::List::removeSamples(const Sample::List& list)
 void Sample::List::clear()
 {
 	mSamples.clear();
+	mSections.clear();
 }
 
 void samplore::Sample::List::sort(SortingMethod method)
 {
+	mSections.clear(); //a sorted list mixes the groups
 	if (method == SortingMethod::Random)
 	{
 		randomize();
 	}
 	else if (method == SortingMethod::Newest 
-		|| method == SortingMethod::Oldest)
+		|| method == SortingMethod::Oldest
+		|| method == SortingMethod::Tempo
+		|| method == SortingMethod::Key)
 	{
 		quickSort(method, 0, mSamples.size() - 1);
 	}
@@ -435,7 +883,7 @@ int Sample::List::partition(SortingMethod method, int low, int high)
 	mSamples[pivotIndex] = tmp;
 	return i + 1;
 }
-float Sample::getValueForSortType(SortingMethod method) const
+float Sample::Record::getValueForSortType(SortingMethod method) const
 {
 	if (method == SortingMethod::Newest)
 	{
@@ -445,6 +893,15 @@ float Sample::getValueForSortType(SortingMethod method) const
 	{
 		return -mFile.getCreationTime().toMilliseconds();
 	}
+	else if (method == SortingMethod::Tempo)
+	{
+		//slowest first, anything without a beat after the loops
+		return mTempo > 0.0f ? mTempo : std::numeric_limits<float>::max();
+	}
+	else if (method == SortingMethod::Key)
+	{
+		return MusicalKey::getSortValue(mKey);
+	}
 	return 0.0f;
 }
 
@@ -479,4 +936,5 @@ Sample::Reference Sample::List::operator[](int index) const
 void Sample::List::operator=(const Sample::List& other)
 {
 	mSamples = other.mSamples;
+	mSections = other.mSections;
 }
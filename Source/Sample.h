@@ -15,28 +15,51 @@
 
 #include "SampleAudioThumbnail.h"
 #include "SortingMethod.h"
+#include "SearchFilter.h"
+#include "AnalysisStore.h"
+#include "LibraryIndex.h"
+
+#include <unordered_map>
 
 namespace samplore
 {
+	class SampleDirectory;
+	class SampleRow;
 	class Sample : public ChangeBroadcaster, public ChangeListener
 	{
 	public:
 		/// <summary>
-		/// Clean pointer of Sample for easy passoff
+		/// Immutable copy of what background readers need from a sample. Edits publish a new
+		/// record instead of touching the old one, so workers can read without locking.
+		/// </summary>
+		struct Record
+		{
+			File mFile;
+			StringArray mTags;
+			float mTempo = -1.0f; //negative until analysed, zero if there is no beat
+			int mKey = MusicalKey::UNKNOWN;
+			std::shared_ptr<const SampleDescriptor> mDescriptor; //nullptr until analysed
+			bool matches(const SearchFilter& filter) const { return filter.matches(mFile.getFullPathName(), mTags, mTempo, mKey); }
+			float getValueForSortType(SortingMethod method) const;
+		};
+		/// <summary>
+		/// Clean pointer of Sample for easy passoff. Points at the library row, the Sample is made the
+		/// first time something the record does not hold is asked for
 		/// </summary>
 		class Reference
 		{
 		public:
-			Reference(std::shared_ptr<Sample> sample);
+			Reference(std::shared_ptr<SampleRow> row);
 			Reference(nullptr_t null);
 			Reference(const Sample::Reference& ref);
 			
-			bool isNull() const { return mSample.expired(); }
+			bool isNull() const { return mRow.expired(); }
 
 			std::shared_ptr<SampleAudioThumbnail> getThumbnail() const;
 
 			File getFile() const;
 
+			/// Folders from the one holding the file up to its root, empty once the root was removed
 			StringArray getRelativeParentFolders() const;
 
 			//String getRelativePathName() const;
@@ -49,34 +72,60 @@ namespace samplore
 			Colour getColor() const;
 
 			double getLength() const;
+			/// Beats per minute, zero for one-shots, negative until analysed
+			float getTempo() const;
+			/// See MusicalKey, UNKNOWN until analysed
+			int getKey() const;
+			/// nullptr until analysed
+			std::shared_ptr<const SampleDescriptor> getDescriptor() const;
 
 			StringArray getTags() const;
 			void addTag(juce::String tag);
 			void removeTag(juce::String tag);
 			 
+			bool isQueryValid(const SearchFilter& filter) const;
+
 			void generateThumbnailAndCache();
-			float getValueForSortType(SortingMethod method) const { return mSample.lock()->getValueForSortType(method); }
+			float getValueForSortType(SortingMethod method) const { return getRecord()->getValueForSortType(method); }
 		
 			void addChangeListener(ChangeListener* listener);
 			void removeChangeListener(ChangeListener* listener);
 
 			void renameFile(String name);
+			/// Moves the file, its tags, thumbnail and analysis go with it
+			bool moveFile(const File& destination) const;
 
 			friend bool operator==(const Sample::Reference& lhs, const Sample::Reference& rhs);
 			friend bool operator!=(const Sample::Reference& lhs, const Sample::Reference& rhs);
 		private:
-			std::weak_ptr<Sample> mSample; //weak pointer for safety
+			std::shared_ptr<Sample> getSample() const;
+			std::shared_ptr<const Record> getRecord() const;
+
+			std::weak_ptr<SampleRow> mRow; //weak pointer for safety
 			JUCE_LEAK_DETECTOR(Sample::Reference)
 		};
 		class List
 		{
 		public:
+			/// Immutable shared result set, cheap to hold and pass around from the UI
+			using Snapshot = std::shared_ptr<const List>;
+			/// Heading over the samples from mStart up to the next section
+			struct Section
+			{
+				String mTitle;
+				int mStart = 0;
+			};
+
 			List(const std::vector<Sample::Reference>& list);
 			List();
 			
 			void addSample(const Sample::Reference sample);
 			void addSamples(const Sample::List& list);
 			void addSamples(const std::vector<Sample::Reference>& samples);
+			/// Samples added from here on are shown under title
+			void addSection(const String& title);
+			/// Empty unless the results come in groups, sorting or removing samples drops them
+			const std::vector<Section>& getSections() const { return mSections; }
 
 			void removeSample(Sample::Reference sample);
 			void removeSample(int index);
@@ -98,11 +147,15 @@ namespace samplore
 			void operator=(const Sample::List& other);
 		protected:
 			std::vector<Sample::Reference> mSamples;
+			std::vector<Section> mSections;
 			SortingMethod mListSortingMethod = SortingMethod::None;
 			JUCE_LEAK_DETECTOR(List)
 		};
 
-		Sample(const File&);
+		Sample(const File&, SampleDirectory* rootDirectory = nullptr);
+		/// From the LibraryIndex, the metadata file is not read until something besides the tags is needed.
+		/// Unless checked already, the entry is taken on trust until then, see verifyIndexedEntry
+		Sample(const File&, SampleDirectory* rootDirectory, const LibraryIndex::SampleEntry& entry, bool checked);
 		~Sample();
 
 		void changeListenerCallback(ChangeBroadcaster* source);
@@ -110,23 +163,102 @@ namespace samplore
 		void savePropertiesFile();
 		void loadPropertiesFile();
 
-		float getValueForSortType(SortingMethod method) const;
 		/*Checks if file both exist and has same or older version number*/
 		bool isPropertiesFileValid();
-		bool isQueryValid(juce::String query); //used in search
+		bool isQueryValid(const SearchFilter& filter) const; //used in search
+		/// Message thread, results from the LibraryAnalyser
+		void setAnalysis(const SampleAnalysis& analysis);
+		/// Safe from any thread
+		std::shared_ptr<const Record> getRecord() const { return std::atomic_load(&mRecord); }
+		/// Message thread, from the LibraryAnalyser once the file has been hashed
+		void setContentHash(uint64 contentHash);
+		uint64 getContentHash() const { return mContentHash; }
+		/// Message thread, what the LibraryIndex keeps of us for the next launch
+		LibraryIndex::SampleEntry getIndexEntry() const;
+		/// Message thread, compares the file with the size and time the index gave, reading it again if
+		/// it was overwritten in place. Done when the metadata is first needed, the command line does it up front
+		void verifyIndexedEntry();
+		/// Message thread, by our row as the root lets go of it, snapshots and results can keep us alive longer
+		void clearRootDirectory() { mRootDirectory = nullptr; }
+		/// Legacy, keyed by path and lost when the file moves
 		static PropertiesFile* getPropertiesFile(const File& sampleFile);
+		/// Keyed by ContentHash, found again wherever the file goes. Samples share one per hash, see openPropertiesFile
+		static PropertiesFile* getPropertiesFile(uint64 contentHash);
+
+		/// Where the metadata files go, benchmarks point it somewhere disposable
+		static File& getPropertiesFolder()
+		{
+			static File folder = getPropertiesOptions().getDefaultFile().getSiblingFile("SampleProperties");
+			return folder;
+		}
+		/// Set by the SampleLibrary, so new samples find their content hash without reading the file
+		static AnalysisStore*& getAnalysisStore()
+		{
+			static AnalysisStore* store = nullptr;
+			return store;
+		}
 	private:
 		File mFile;
-		std::unique_ptr<PropertiesFile> mPropertiesFile = nullptr;
+		uint64 mContentHash = 0; //zero until hashed
+		SampleDirectory* mRootDirectory = nullptr; //the root we were listed under, nullptr once it is gone
+		std::shared_ptr<PropertiesFile> mPropertiesFile = nullptr; //nullptr until needed when restored from the index, shared by copies
 		StringArray mTags;
+		int64 mFileSize = -1; //as last seen, negative if unknown
+		int64 mFileModified = 0;
+		bool mUnverified = false; //restored from an index entry not yet compared with the file
 		//std::map<juce::String, double> mCuePoints;
 		juce::String mInformationDescription;
 		double mLength = -1;
+		float mTempo = -1.0f;
+		int mKey = MusicalKey::UNKNOWN;
+		std::shared_ptr<const SampleDescriptor> mDescriptor;
 		std::shared_ptr<AudioThumbnailCache> mThumbnailCache = nullptr;
 		std::shared_ptr<SampleAudioThumbnail> mThumbnail = nullptr;
+		bool mThumbnailPending = false; //counted in Diagnostics until fully loaded
 		juce::Colour mColor; //saved with sample, the sampletile core color
 		int mUseCount; //count number of times dragged into the program
 		bool mUserHidden; //todo
+		std::shared_ptr<const Record> mRecord; //only touch with std::atomic_load/atomic_store
+
+		/// Call on the message thread after changing mFile, mTags or the analysis
+		void publishRecord();
+		/// By our row as it makes us, the analysis it was handed before we existed
+		void takeAnalysis(const Record& record);
+		/// Keyed by content once it is known, copies of the same content share the one PropertiesFile.
+		/// A path keyed file, from older versions or written before hashing, is merged in and deleted
+		void openPropertiesFile();
+		/// Leaves the shared PropertiesFile, the last sample to go saves it
+		void closePropertiesFile();
+		/// Counted among the samples sharing a PropertiesFile, before it is opened
+		void registerSharedProperties();
+		/// Reads the metadata again after a copy of the same content changed it
+		void reloadPropertiesFile();
+		/// Reads the metadata file of a sample restored from the index, before its color, description or tags change
+		void loadDeferredProperties();
+		/// The file changed since the index was written, drops the content hash and tags it gave
+		void forgetIndexedEntry();
+		static PropertiesFile::Options getPropertiesOptions();
+		struct SharedProperties
+		{
+			std::shared_ptr<PropertiesFile> mFile; //nullptr until one of the samples needs it
+			std::vector<Sample*> mSamples;
+		};
+		/// By content hash, guarded by getSharedPropertiesLock as samples may be released on worker threads
+		static std::unordered_map<uint64, SharedProperties>& getSharedProperties()
+		{
+			static std::unordered_map<uint64, SharedProperties> shared;
+			return shared;
+		}
+		static CriticalSection& getSharedPropertiesLock()
+		{
+			static CriticalSection lock;
+			return lock;
+		}
+		/// Drops cached query results, nothing to do on the command line or in benchmarks
+		static void notifyMetadataChanged();
+		/// Hashes the sample of row off the message thread, see SampleLibrary::hashSample
+		static void requestContentHash(const std::shared_ptr<SampleRow>& row);
+		friend class SampleRow;
 		JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Sample)
 	};
 
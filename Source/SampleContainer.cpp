@@ -1,7 +1,10 @@
 #include "SampleContainer.h"
+#include "Diagnostics.h"
+#include "Tracer.h"
 #include "SampleLibrary.h"
 #include "SamplifyProperties.h"
 #include "SamplifyLookAndFeel.h"
+#include "ThemeManager.h"
 
 #include <algorithm>
 #include <cmath>
@@ -20,12 +23,26 @@ SampleContainer::~SampleContainer()
 
 void SampleContainer::paint (Graphics& g)
 {
-	
+	SAMPLORE_TRACE_ZONE("SampleContainer::paint");
+	Diagnostics::PaintScope paintScope(Diagnostics::PaintClass::SampleContainer);
+	const Rectangle<int> clip = g.getClipBounds();
+	int padding = AppValues::getInstance().SAMPLE_TILE_CONTAINER_ITEM_PADDING;
+	g.setColour(ThemeManager::getInstance().getColorForRole(ThemeManager::ColorRole::TextPrimary));
+	g.setFont(FontOptions(16.0f, Font::bold));
+	for (const SectionLayout& section : mSections)
+	{
+		Rectangle<int> heading(0, section.mTop, getWidth(), getHeadingHeight(section));
+		if (!heading.isEmpty() && heading.intersects(clip))
+		{
+			g.drawText(section.mTitle, heading.reduced(padding * 4, 0), Justification::centredLeft);
+		}
+	}
 }
 
 void SampleContainer::resized()
 {
 	// Set total height based on all samples
+	layoutSections();
 	int totalHeight = calculateTotalHeight();
 	setSize(getWidth(), totalHeight);
 	
@@ -36,35 +53,32 @@ void SampleContainer::resized()
 
 void SampleContainer::updateVisibleItems(int viewportTop, int viewportHeight)
 {
-	if (mCurrentSamples.size() == 0)
-	{
-		// Hide all tiles
-		for (auto& tile : mTilePool)
-		{
-			tile->setVisible(false);
-		}
-		return;
-	}
-	
 	int columns = getColumnCount();
-	if (columns <= 0)
-		return;
-	
-	int tileWidth = getTileWidth();
 	int tileHeight = getTileHeight();
-	int padding = AppValues::getInstance().SAMPLE_TILE_CONTAINER_ITEM_PADDING;
-	
-	// Calculate which rows are visible (with buffer for smooth scrolling)
-	int firstVisibleRow = jmax(0, (viewportTop / tileHeight) - 1);
-	int lastVisibleRow = jmin(getTotalRowCount() - 1, 
-	                          ((viewportTop + viewportHeight) / tileHeight) + 1);
+	if (columns <= 0 || tileHeight <= 0)
+		return;
 	
-	// Calculate range of sample indices that are visible
-	int firstVisibleIndex = firstVisibleRow * columns;
-	int lastVisibleIndex = jmin((int)mCurrentSamples.size() - 1, 
-	                            (lastVisibleRow + 1) * columns - 1);
+	// Calculate which samples are visible (with a row either side for smooth scrolling)
+	int top = viewportTop - tileHeight;
+	int bottom = viewportTop + viewportHeight + tileHeight;
+	int firstVisibleIndex = 0;
+	int lastVisibleIndex = -1;
+	for (const SectionLayout& section : mSections)
+	{
+		int rowsTop = section.mTop + getHeadingHeight(section);
+		int rows = getSectionRowCount(section);
+		if (rowsTop >= bottom)
+			break;
+		if (rows == 0 || rowsTop + rows * tileHeight <= top)
+			continue;
+		int firstRow = jmax(0, (top - rowsTop) / tileHeight);
+		int lastRow = jmin(rows - 1, (bottom - rowsTop) / tileHeight);
+		if (lastVisibleIndex < firstVisibleIndex)
+			firstVisibleIndex = section.mStart + firstRow * columns;
+		lastVisibleIndex = jmin(section.mEnd - 1, section.mStart + (lastRow + 1) * columns - 1);
+	}
 	
-	int visibleCount = lastVisibleIndex - firstVisibleIndex + 1;
+	int visibleCount = jmax(0, lastVisibleIndex - firstVisibleIndex + 1);
 	
 	// Ensure we have enough tiles in the pool
 	while ((int)mTilePool.size() < visibleCount)
@@ -75,19 +89,13 @@ void SampleContainer::updateVisibleItems(int viewportTop, int viewportHeight)
 	}
 	
 	// Update visible tiles
-	for (int i = 0; i < visibleCount && (firstVisibleIndex + i) < (int)mCurrentSamples.size(); i++)
+	for (int i = 0; i < visibleCount; i++)
 	{
 		int sampleIndex = firstVisibleIndex + i;
-		int column = sampleIndex % columns;
-		int row = sampleIndex / columns;
-		
 		SampleTile* tile = mTilePool[i].get();
 		tile->setVisible(true);
-		tile->setBounds((column * tileWidth) + padding,
-		                (row * tileHeight) + padding,
-		                tileWidth - (padding * 2),
-		                tileHeight - (padding * 2));
-		tile->setSample(mCurrentSamples[sampleIndex]);
+		tile->setBounds(getTileBounds(sampleIndex));
+		tile->setSample((*mCurrentSamples)[sampleIndex]);
 	}
 	
 	// Hide unused tiles
@@ -98,6 +106,68 @@ void SampleContainer::updateVisibleItems(int viewportTop, int viewportHeight)
 	
 	mLastViewportTop = viewportTop;
 	mLastViewportHeight = viewportHeight;
+	if (firstVisibleIndex != mFirstVisibleIndex || visibleCount != mVisibleCount || mResultsChanged)
+	{
+		//anything on screen may be auditioned next, get its attack ready on disk
+		Array<File> visibleFiles;
+		for (int i = firstVisibleIndex; i <= lastVisibleIndex; i++)
+		{
+			Sample::Reference sample = (*mCurrentSamples)[i];
+			if (!sample.isNull())
+				visibleFiles.add(sample.getFile());
+		}
+		SamplifyProperties::getInstance()->getAudioPlayer()->getPrefixCache().requestPrefixes(visibleFiles);
+	}
+	mFirstVisibleIndex = firstVisibleIndex;
+	mVisibleCount = visibleCount;
+	mResultsChanged = false;
+}
+
+void SampleContainer::layoutSections()
+{
+	mSections.clear();
+	const std::vector<Sample::List::Section>& sections = mCurrentSamples->getSections();
+	const int count = mCurrentSamples->size();
+	if (sections.empty() || sections.front().mStart > 0)
+	{
+		//ungrouped results, or ones before the first group
+		mSections.push_back({ String(), 0, sections.empty() ? count : sections.front().mStart, 0 });
+	}
+	for (size_t i = 0; i < sections.size(); i++)
+	{
+		mSections.push_back({ sections[i].mTitle, sections[i].mStart, i + 1 < sections.size() ? sections[i + 1].mStart : count, 0 });
+	}
+	int top = 0;
+	for (SectionLayout& section : mSections)
+	{
+		section.mTop = top;
+		top += getHeadingHeight(section) + getSectionRowCount(section) * getTileHeight();
+	}
+}
+
+int SampleContainer::getHeadingHeight(const SectionLayout& section) const
+{
+	return section.mTitle.isEmpty() ? 0 : (int)AppValues::getInstance().SAMPLE_CONTAINER_SECTION_HEADING_HEIGHT;
+}
+
+int SampleContainer::getSectionRowCount(const SectionLayout& section) const
+{
+	int columns = getColumnCount();
+	return columns > 0 ? (section.mEnd - section.mStart + columns - 1) / columns : 0; // Ceiling division
+}
+
+Rectangle<int> SampleContainer::getTileBounds(int index) const
+{
+	//the last section starting at or before index, empty ones before it are skipped
+	auto section = std::upper_bound(mSections.begin(), mSections.end(), index,
+		[](int i, const SectionLayout& s) { return i < s.mStart; }) - 1;
+	int columns = getColumnCount();
+	int tileWidth = getTileWidth();
+	int tileHeight = getTileHeight();
+	int padding = AppValues::getInstance().SAMPLE_TILE_CONTAINER_ITEM_PADDING;
+	int local = index - section->mStart;
+	return Rectangle<int>((local % columns) * tileWidth, section->mTop + getHeadingHeight(*section) + (local / columns) * tileHeight,
+		tileWidth, tileHeight).reduced(padding);
 }
 
 void SampleContainer::clearItems()
@@ -105,11 +175,14 @@ void SampleContainer::clearItems()
 	mTilePool.clear();
 }
 
-void SampleContainer::setSampleItems(Sample::List currentSamples)
+void SampleContainer::setSampleItems(Sample::List::Snapshot samples)
 {
-	mCurrentSamples = currentSamples;
+	mCurrentSamples = samples != nullptr ? samples : std::make_shared<const Sample::List>();
+	mResultsChanged = true;
 	
 	// Recalculate total height based on all samples
+	layoutSections();
+	repaint(); //the headings
 	int totalHeight = calculateTotalHeight();
 	setSize(getWidth(), totalHeight);
 	
@@ -118,21 +191,42 @@ void SampleContainer::setSampleItems(Sample::List currentSamples)
 	                   mLastViewportHeight >= 0 ? mLastViewportHeight : getParentHeight());
 }
 
+void SampleContainer::preloadNeighbours(const Sample::Reference& sample)
+{
+	int last = jmin(mFirstVisibleIndex + mVisibleCount, mCurrentSamples->size());
+	for (int i = mFirstVisibleIndex; i < last; i++)
+	{
+		if ((*mCurrentSamples)[i] == sample)
+		{
+			Array<Sample::Reference> neighbours;
+			for (int offset = 1; offset <= AppValues::getInstance().PREVIEW_PRELOAD_NEIGHBOURS; offset++)
+			{
+				if (i + offset < mCurrentSamples->size())
+					neighbours.add((*mCurrentSamples)[i + offset]);
+				if (i - offset >= 0)
+					neighbours.add((*mCurrentSamples)[i - offset]);
+			}
+			SamplifyProperties::getInstance()->getAudioPlayer()->preloadSamples(neighbours);
+			return;
+		}
+	}
+}
+
 int SampleContainer::calculateTotalHeight() const
 {
-	int tileHeight = getTileHeight();
-	int totalRows = getTotalRowCount();
-	return tileHeight * totalRows;
+	if (mSections.empty())
+		return 0;
+	const SectionLayout& last = mSections.back();
+	return last.mTop + getHeadingHeight(last) + getSectionRowCount(last) * getTileHeight();
 }
 
 int SampleContainer::getTotalRowCount() const
 {
-	int columns = getColumnCount();
-	if (columns <= 0)
-		return 0;
-	
-	// Calculate total rows needed for ALL samples
-	return (mCurrentSamples.size() + columns - 1) / columns;  // Ceiling division
+	// Calculate total rows needed for ALL samples, every section starts a row
+	int rows = 0;
+	for (const SectionLayout& section : mSections)
+		rows += getSectionRowCount(section);
+	return rows;
 }
 
 int SampleContainer::getColumnCount() const
@@ -32,7 +32,9 @@ namespace samplore
 		void updateVisibleItems(int viewportTop, int viewportHeight);
 		void clearItems();
 
-		void setSampleItems(Sample::List mSamples);
+		void setSampleItems(Sample::List::Snapshot samples);
+		/// Asks the player to open the samples either side of sample, looked up among the visible tiles
+		void preloadNeighbours(const Sample::Reference& sample);
 		//======================================================
 		int calculateTotalHeight() const;
 		int getTotalRowCount() const;
@@ -40,14 +42,31 @@ namespace samplore
 		int getTileHeight() const;
 		int getTileWidth() const;
 	private:
+		/// One group of results, its tiles start on a row of their own below its heading
+		struct SectionLayout
+		{
+			String mTitle; //empty for results that are not grouped, no heading then
+			int mStart = 0; //first sample
+			int mEnd = 0; //one past the last
+			int mTop = 0; //of the heading
+		};
+		/// Rebuilds mSections for the current samples and width
+		void layoutSections();
+		int getHeadingHeight(const SectionLayout& section) const;
+		int getSectionRowCount(const SectionLayout& section) const;
+		Rectangle<int> getTileBounds(int index) const;
 		//=============================================================================
 		/// Pool of reusable SampleTile objects
 		std::vector<std::unique_ptr<SampleTile>> mTilePool;
-		/// All samples (full list)
-		Sample::List mCurrentSamples;
+		/// All samples (full list), shared with the library rather than copied
+		Sample::List::Snapshot mCurrentSamples = std::make_shared<const Sample::List>();
+		std::vector<SectionLayout> mSections; //top to bottom, a single untitled one unless the results are grouped
 		/// Current viewport position for optimization
 		int mLastViewportTop = -1;
 		int mLastViewportHeight = -1;
+		int mFirstVisibleIndex = 0;
+		int mVisibleCount = 0;
+		bool mResultsChanged = false; //the visible range may match the last one but hold other samples
 
 		JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SampleContainer)
 	};
@@ -0,0 +1,55 @@
+/*
+  ==============================================================================
+
+    SampleDescriptor.h
+    Author:  Jake Rose
+
+	Fixed length summary of how a sample sounds, one signed byte per feature.
+	Every feature is scaled to roughly -1 to 1 before quantising, so distances
+	between descriptors weigh features alike and never need the audio again.
+
+  ==============================================================================
+*/
+
+#ifndef SAMPLEDESCRIPTOR_H
+#define SAMPLEDESCRIPTOR_H
+
+#include "JuceHeader.h"
+
+#include <array>
+#include <cmath>
+
+struct SampleDescriptor
+{
+	static const int NUM_MFCC_MEANS = 12; //c1 to c12, c0 is loudness again
+	static const int NUM_MFCC_SPREADS = 8;
+
+	enum Feature
+	{
+		Loudness,
+		Peak,
+		Crest,
+		Centroid,
+		CentroidSpread,
+		Rolloff,
+		Flatness,
+		ZeroCrossings,
+		Attack,
+		Duration,
+		Flux,
+		LowEnergy,
+		MfccMean,
+		MfccSpread = MfccMean + NUM_MFCC_MEANS,
+		NumFeatures = MfccSpread + NUM_MFCC_SPREADS
+	};
+	static const int SIZE = NumFeatures;
+
+	std::array<int8, SIZE> mValues {};
+
+	float get(int feature) const { return mValues[feature] / 127.0f; }
+	void set(int feature, float value) { mValues[feature] = (int8)std::lround(jlimit(-1.0f, 1.0f, value) * 127.0f); }
+
+	bool operator==(const SampleDescriptor& other) const { return mValues == other.mValues; }
+};
+
+#endif
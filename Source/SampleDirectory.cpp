@@ -9,10 +9,78 @@
 */
 
 #include "SampleDirectory.h"
+#include "Tracer.h"
+
+#include <map>
+
 using namespace samplore;
 
-SampleDirectory::SampleDirectory(File file)
+namespace
 {
+	/// Entries of the rows from begin to end still in directory
+	template <typename Iterator>
+	void addIndexEntries(LibraryIndex::Folder& folder, const File& directory, Iterator begin, Iterator end)
+	{
+		for (Iterator row = begin; row != end; ++row)
+		{
+			if ((*row)->getRecord()->mFile.getParentDirectory() == directory) //not if moved away since the last rescan
+			{
+				folder.mSamples.push_back((*row)->getIndexEntry());
+			}
+		}
+	}
+}
+
+SampleDirectory::SampleDirectory(File file, SampleDirectory* parent) : mParent(parent)
+{
+	load(file, nullptr, {});
+}
+
+SampleDirectory::SampleDirectory(File file, const LibraryIndex& index)
+{
+	const LibraryIndex::Folder* indexed = index.find(file, getWildcard());
+	if (indexed == nullptr)
+	{
+		load(file, nullptr, {});
+		return;
+	}
+	Rows rows;
+	UnbuiltFolder unbuilt = takeIndexed(*indexed, file, rows);
+	load(file, &unbuilt, std::move(rows));
+}
+
+SampleDirectory::SampleDirectory(File file, UnbuiltFolder& indexed, Rows rows, SampleDirectory* parent) : mParent(parent)
+{
+	load(file, &indexed, std::move(rows));
+}
+
+SampleDirectory::UnbuiltFolder SampleDirectory::takeIndexed(const LibraryIndex::Folder& indexed, const File& file, Rows& rows)
+{
+	UnbuiltFolder unbuilt;
+	unbuilt.mName = indexed.mName;
+	unbuilt.mModified = indexed.mModified;
+	unbuilt.mSampleCount = (int)indexed.mSamples.size();
+	const size_t first = rows.size();
+	for (const LibraryIndex::SampleEntry& entry : indexed.mSamples)
+	{
+		//checked once the sample is needed, a stat each here would cost what listing does
+		rows.push_back(std::make_shared<SampleRow>(file.getChildFile(entry.mName), this, entry));
+	}
+	for (const LibraryIndex::Folder& folder : indexed.mFolders)
+	{
+		unbuilt.mFolders.push_back(takeIndexed(folder, file.getChildFile(folder.mName), rows));
+	}
+	unbuilt.mSubtreeSampleCount = (int)(rows.size() - first);
+	return unbuilt;
+}
+
+void SampleDirectory::load(const File& file, UnbuiltFolder* indexed, Rows rows)
+{
+	SAMPLORE_TRACE_ZONE("SampleDirectory::scan");
+	if (mParent != nullptr)
+	{
+		mRoot = mParent->mRoot;
+	}
 	if (file.exists())
 	{
 		mCheckStatus = CheckStatus::Enabled;
@@ -21,57 +89,157 @@ SampleDirectory::SampleDirectory(File file)
 	{
 		mCheckStatus = CheckStatus::NotLoaded;
 	}
-	//add all child directories as sampleDirectory, then recursively all them do the same for all child folders
-	DirectoryIterator dirIter = DirectoryIterator(file, false, "*", File::findDirectories);
-	while (dirIter.next())
+	mDirectory = file;
+	mModified = file.getLastModificationTime().toMilliseconds(); //before listing, so a file added meanwhile is seen next time
+
+	if (indexed != nullptr && indexed->mModified == mModified)
 	{
-		std::shared_ptr<SampleDirectory> sampDir = std::make_shared<SampleDirectory>(dirIter.getFile());
-		sampDir->addChangeListener(this);
-		mChildDirectories.push_back(sampDir);
+		//nothing added, removed or renamed here, take the listing and the tags as stored. The folders
+		//below are only looked at once built, until then their rows are laid out after ours
+		mChildSamples.assign(rows.begin(), rows.begin() + indexed->mSampleCount);
+		mUnbuiltSamples.assign(rows.begin() + indexed->mSampleCount, rows.end());
+		mUnbuiltFolders = std::move(indexed->mFolders);
+		mBuilt = mUnbuiltFolders.empty();
 	}
+	else
+	{
+		//anything still in the index below a modified folder is reused by name
+		std::map<String, std::pair<UnbuiltFolder*, Rows>> indexedFolders;
+		std::map<String, std::shared_ptr<SampleRow>> indexedSamples;
+		if (indexed != nullptr)
+		{
+			Rows::iterator next = rows.begin() + indexed->mSampleCount;
+			for (UnbuiltFolder& folder : indexed->mFolders)
+			{
+				indexedFolders[folder.mName] = { &folder, Rows(next, next + folder.mSubtreeSampleCount) };
+				next += folder.mSubtreeSampleCount;
+			}
+			for (Rows::iterator row = rows.begin(); row != rows.begin() + indexed->mSampleCount; ++row)
+			{
+				indexedSamples[(*row)->getIndexEntry().mName] = *row;
+			}
+		}
 
-	//add all child samples in the actual folder
-	DirectoryIterator sampleIter = DirectoryIterator(file, false, getWildcard(), File::findFiles);
-	while (sampleIter.next())
+		//add all child directories as sampleDirectory, then recursively all them do the same for all child folders
+		DirectoryIterator dirIter = DirectoryIterator(file, false, "*", File::findDirectories);
+		while (dirIter.next())
+		{
+			auto found = indexedFolders.find(dirIter.getFile().getFileName());
+			std::shared_ptr<SampleDirectory> sampDir;
+			if (found != indexedFolders.end())
+			{
+				sampDir.reset(new SampleDirectory(dirIter.getFile(), *found->second.first, std::move(found->second.second), this));
+				indexedFolders.erase(found);
+			}
+			else
+			{
+				sampDir = std::make_shared<SampleDirectory>(dirIter.getFile(), this);
+			}
+			countChildStatus(sampDir->getCheckStatus(), 1);
+			mChildDirectories.push_back(sampDir);
+		}
+
+		//add all child samples in the actual folder
+		DirectoryIterator sampleIter = DirectoryIterator(file, false, getWildcard(), File::findFiles);
+		int64 size = 0;
+		Time modified;
+		while (sampleIter.next(nullptr, nullptr, &size, &modified, nullptr, nullptr))
+		{
+			auto found = indexedSamples.find(sampleIter.getFile().getFileName());
+			//a file of the same name moved in or written over since is read like a new one
+			if (found != indexedSamples.end())
+			{
+				const LibraryIndex::SampleEntry entry = found->second->getIndexEntry();
+				if (entry.mSize == size && entry.mModified == modified.toMilliseconds())
+				{
+					mChildSamples.push_back(found->second);
+					indexedSamples.erase(found);
+					continue;
+				}
+			}
+			mChildSamples.push_back(std::make_shared<SampleRow>(std::make_shared<Sample>(sampleIter.getFile(), mRoot)));
+		}
+
+		//gone since the index was written, or read again above
+		for (const auto& sample : indexedSamples)
+		{
+			sample.second->clearRootDirectory();
+		}
+		for (const auto& folder : indexedFolders)
+		{
+			for (const auto& row : folder.second.second)
+			{
+				row->clearRootDirectory();
+			}
+		}
+	}
+
+	if (mParent == nullptr)
 	{
-		mChildSamples.push_back(std::make_shared<Sample>(sampleIter.getFile()));
+		rebuildSampleTable();
 	}
-	mDirectory = file;
 }
 
 SampleDirectory::~SampleDirectory()
 {
-	// Remove ourselves as a listener from all child directories before destruction
-	for (auto& childDir : mChildDirectories)
+	//rows in snapshots and folders held by the tree view can outlive us, leave nothing pointing back here
+	for (const auto& row : mSampleTable)
 	{
-		if (childDir)
-		{
-			childDir->removeChangeListener(this);
-		}
+		row->clearRootDirectory();
+	}
+	for (const auto& childDir : mChildDirectories)
+	{
+		childDir->mParent = nullptr;
+		childDir->setRoot(childDir.get());
 	}
 }
 
-Sample::List samplore::SampleDirectory::getChildSamplesRecursive(juce::String query, bool ignoreCheckSystem)
+void SampleDirectory::setRoot(SampleDirectory* root)
 {
-	Sample::List list;
-	if (mCheckStatus == CheckStatus::Disabled || mCheckStatus == CheckStatus::NotLoaded)
+	mRoot = root;
+	for (const auto& childDir : mChildDirectories)
 	{
-		return list;
+		childDir->setRoot(root);
 	}
+}
 
-	for (int i = 0; i < mChildDirectories.size(); i++)
+void SampleDirectory::storeInIndex(LibraryIndex& index) const
+{
+	jassert(mParent == nullptr);
+	index.set(mDirectory, getWildcard(), toIndex());
+}
+
+LibraryIndex::Folder SampleDirectory::toIndex() const
+{
+	LibraryIndex::Folder folder;
+	folder.mName = mDirectory.getFileName();
+	folder.mModified = mModified;
+	addIndexEntries(folder, mDirectory, mChildSamples.begin(), mChildSamples.end());
+	//never built, written back as restored with whatever the rows learnt since
+	Rows::const_iterator next = mUnbuiltSamples.begin();
+	for (const UnbuiltFolder& unbuilt : mUnbuiltFolders)
 	{
-		list += mChildDirectories[i]->getChildSamplesRecursive(query, ignoreCheckSystem);
+		folder.mFolders.push_back(toIndex(unbuilt, mDirectory.getChildFile(unbuilt.mName), next));
 	}
-	if (ignoreCheckSystem || mIncludeChildSamples)
+	for (const auto& childDir : mChildDirectories)
 	{
-		for (int i = 0; i < mChildSamples.size(); i++)
-		{
-			if(mChildSamples[i]->isQueryValid(query))
-				list.addSample(Sample::Reference(mChildSamples[i]));
-		}
+		folder.mFolders.push_back(childDir->toIndex());
 	}
-	return list;
+	return folder;
+}
+
+LibraryIndex::Folder SampleDirectory::toIndex(const UnbuiltFolder& unbuilt, const File& file, Rows::const_iterator& next)
+{
+	LibraryIndex::Folder folder;
+	folder.mName = unbuilt.mName;
+	folder.mModified = unbuilt.mModified;
+	addIndexEntries(folder, file, next, next + unbuilt.mSampleCount);
+	next += unbuilt.mSampleCount;
+	for (const UnbuiltFolder& child : unbuilt.mFolders)
+	{
+		folder.mFolders.push_back(toIndex(child, file.getChildFile(child.mName), next));
+	}
+	return folder;
 }
 
 Sample::List samplore::SampleDirectory::getChildSamples()
@@ -85,87 +253,188 @@ Sample::List samplore::SampleDirectory::getChildSamples()
 	
 }
 
-void SampleDirectory::updateChildrenItems(CheckStatus checkStatus)
+void SampleDirectory::cycleCurrentCheck()
 {
-	mCheckStatus = checkStatus;
-	for (int i = 0; i < mChildDirectories.size(); i++)
+	switch (mCheckStatus)
 	{
-		mChildDirectories[i]->setCheckStatus(checkStatus);
+	case CheckStatus::Mixed:
+	case CheckStatus::Enabled:
+		setCheckStatus(CheckStatus::Disabled);
+		break;
+	case CheckStatus::Disabled:
+		setCheckStatus(CheckStatus::Enabled);
+		break;
 	}
+	
 }
 
-void samplore::SampleDirectory::changeListenerCallback(ChangeBroadcaster* source)
+void samplore::SampleDirectory::setCheckStatus(CheckStatus newCheckStatus)
 {
-	recursiveRefresh();
-	sendChangeMessage();
+	SampleDirectory& root = getRoot();
+	CheckStatus oldCheckStatus = mCheckStatus;
+	applyCheckStatusToSubtree(newCheckStatus, &root);
+	if (mParent != nullptr)
+	{
+		mParent->childCheckStatusChanged(oldCheckStatus, mCheckStatus, root);
+	}
+	root.sendChangeMessage(); //the library listens to the root, messages are coalesced
 }
 
-void SampleDirectory::cycleCurrentCheck()
+void SampleDirectory::countChildStatus(CheckStatus status, int delta)
 {
-	switch (mCheckStatus)
+	switch (status)
 	{
-	case CheckStatus::Mixed:
 	case CheckStatus::Enabled:
-		setCheckStatus(CheckStatus::Disabled);
+		mEnabledChildCount += delta;
 		break;
 	case CheckStatus::Disabled:
-		setCheckStatus(CheckStatus::Enabled);
+		mDisabledChildCount += delta;
+		break;
+	case CheckStatus::Mixed:
+		mMixedChildCount += delta;
+		break;
+	default:
 		break;
 	}
-	
 }
 
-void samplore::SampleDirectory::setCheckStatus(CheckStatus newCheckStatus)
+CheckStatus SampleDirectory::getStatusFromChildCounts() const
 {
-	updateChildrenItems(newCheckStatus);
-	sendChangeMessage();
+	if (mMixedChildCount > 0 || (mEnabledChildCount > 0 && mDisabledChildCount > 0))
+	{
+		return CheckStatus::Mixed;
+	}
+	else if (mEnabledChildCount > 0)
+	{
+		return CheckStatus::Enabled;
+	}
+	else if (mDisabledChildCount > 0)
+	{
+		return CheckStatus::Disabled;
+	}
+	return mCheckStatus; //no loaded children, keep our own
 }
 
-void samplore::SampleDirectory::recursiveRefresh()
+void SampleDirectory::applyCheckStatusToSubtree(CheckStatus status, SampleDirectory* root)
 {
 	for (int i = 0; i < mChildDirectories.size(); i++)
 	{
-		mChildDirectories[i]->recursiveRefresh();
+		mChildDirectories[i]->applyCheckStatusToSubtree(status, root);
 	}
-	bool foundDisabled = false;
-	bool foundEnabled = false;
+	mEnabledChildCount = mDisabledChildCount = mMixedChildCount = 0;
 	for (int i = 0; i < mChildDirectories.size(); i++)
 	{
-		if (mChildDirectories[i]->getCheckStatus() == CheckStatus::Mixed)
-		{
-			foundDisabled = true;
-			foundEnabled = true;
-		}
-		else if (mChildDirectories[i]->getCheckStatus() == CheckStatus::Disabled)
-		{
-			foundDisabled = true;
-		}
-		else if (mChildDirectories[i]->getCheckStatus() == CheckStatus::Enabled)
-		{
-			foundEnabled = true;
-		}
-		if (foundEnabled && foundDisabled)
-		{
-			mCheckStatus = CheckStatus::Mixed;
-		}
-		else if (foundEnabled)
-		{
-			mCheckStatus = CheckStatus::Enabled;
-		}
-		else if (foundDisabled)
-		{
-			mCheckStatus = CheckStatus::Disabled;
-		}
+		countChildStatus(mChildDirectories[i]->getCheckStatus(), 1);
+	}
+	if (mCheckStatus == status || mCheckStatus == CheckStatus::NotLoaded)
+	{
+		return;
+	}
+	mCheckStatus = status;
+	if (root != nullptr) //null while a freshly scanned folder is not in the table yet
+	{
+		updateEnabledSamples(*root);
+	}
+	sendChangeMessage();
+}
+
+void SampleDirectory::childCheckStatusChanged(CheckStatus oldStatus, CheckStatus newStatus, SampleDirectory& root)
+{
+	countChildStatus(oldStatus, -1);
+	countChildStatus(newStatus, 1);
+	CheckStatus derived = getStatusFromChildCounts();
+	if (derived == mCheckStatus)
+	{
+		return; //nothing above us can change either
+	}
+	CheckStatus previous = mCheckStatus;
+	mCheckStatus = derived;
+	updateEnabledSamples(root);
+	sendChangeMessage();
+	if (mParent != nullptr)
+	{
+		mParent->childCheckStatusChanged(previous, derived, root);
 	}
 }
 
+void SampleDirectory::updateEnabledSamples(SampleDirectory& root)
+{
+	//the rows of unbuilt folders follow ours and go with our check
+	const int count = (int)(mChildSamples.size() + mUnbuiltSamples.size());
+	if (count > 0)
+	{
+		root.mEnabledSamples.setRange(mSampleStart, count, isEnabledStatus(mCheckStatus));
+	}
+}
+
+bool SampleDirectory::containsDirectory(const SampleDirectory& other) const
+{
+	return other.mRoot == mRoot && other.mFolderIndex >= mFolderIndex && other.mFolderIndex < mFolderEnd;
+}
+
+bool SampleDirectory::containsSample(const Sample::Reference& sample) const
+{
+	//by path, the folder holding it may not have been built
+	return !sample.isNull() && sample.getFile().isAChildOf(mDirectory);
+}
+
 std::shared_ptr<SampleDirectory> samplore::SampleDirectory::getChildDirectory(int index)
 {
+	buildChildDirectories();
 	return mChildDirectories[index];
 }
 
+void SampleDirectory::buildChildDirectories()
+{
+	if (mBuilt)
+	{
+		return;
+	}
+	SAMPLORE_TRACE_ZONE("SampleDirectory::buildChildDirectories");
+	buildChildren();
+	SampleDirectory& root = getRoot();
+	root.rebuildSampleTable();
+	root.sendChangeMessage(); //the library lays out the new folders, and any rows listed again
+}
+
+void SampleDirectory::buildChildren()
+{
+	if (mBuilt)
+	{
+		return;
+	}
+	mBuilt = true;
+	std::vector<UnbuiltFolder> folders;
+	folders.swap(mUnbuiltFolders);
+	Rows rows;
+	rows.swap(mUnbuiltSamples);
+	Rows::iterator next = rows.begin();
+	for (UnbuiltFolder& folder : folders)
+	{
+		Rows subtree(next, next + folder.mSubtreeSampleCount);
+		next += folder.mSubtreeSampleCount;
+		std::shared_ptr<SampleDirectory> sampDir(new SampleDirectory(mDirectory.getChildFile(folder.mName), folder, std::move(subtree), this));
+		if (mCheckStatus == CheckStatus::Disabled)
+		{
+			sampDir->applyCheckStatusToSubtree(CheckStatus::Disabled, nullptr);
+		}
+		countChildStatus(sampDir->getCheckStatus(), 1);
+		mChildDirectories.push_back(sampDir);
+	}
+}
+
 void SampleDirectory::rescanFiles()
 {
+	SAMPLORE_TRACE_ZONE("SampleDirectory::rescanFiles");
+	rescanFilesRecursive();
+	getRoot().rebuildSampleTable();
+	sendChangeMessage();
+}
+
+void SampleDirectory::rescanFilesRecursive()
+{
+	buildChildren(); //listed again below anyway
+	mModified = mDirectory.getLastModificationTime().toMilliseconds();
 	// Rescan child directories - add new ones, keep existing
 	std::vector<File> existingDirs;
 	for (const auto& childDir : mChildDirectories)
@@ -188,25 +457,68 @@ void SampleDirectory::rescanFiles()
 		}
 		if (!exists)
 		{
-			auto sampDir = std::make_shared<SampleDirectory>(dirFile);
-			sampDir->addChangeListener(this);
+			auto sampDir = std::make_shared<SampleDirectory>(dirFile, this);
+			if (mCheckStatus == CheckStatus::Disabled)
+			{
+				sampDir->applyCheckStatusToSubtree(CheckStatus::Disabled, nullptr);
+			}
 			mChildDirectories.push_back(sampDir);
 		}
 	}
 	
 	// Rescan sample files - rebuild the list entirely
+	for (const auto& row : mChildSamples)
+	{
+		row->clearRootDirectory(); //may live on in results, no longer part of the tree
+	}
 	mChildSamples.clear();
 	DirectoryIterator sampleIter(mDirectory, false, getWildcard(), File::findFiles);
 	while (sampleIter.next())
 	{
-		mChildSamples.push_back(std::make_shared<Sample>(sampleIter.getFile()));
+		mChildSamples.push_back(std::make_shared<SampleRow>(std::make_shared<Sample>(sampleIter.getFile(), mRoot)));
 	}
 	
-	// Recursively rescan child directories
+	// Recursively rescan child directories, then recount them as new folders may have changed our status
+	mEnabledChildCount = mDisabledChildCount = mMixedChildCount = 0;
 	for (auto& childDir : mChildDirectories)
 	{
-		childDir->rescanFiles();
+		childDir->rescanFilesRecursive();
+		countChildStatus(childDir->getCheckStatus(), 1);
 	}
-	
-	sendChangeMessage();
+	if (mCheckStatus != CheckStatus::NotLoaded)
+	{
+		mCheckStatus = getStatusFromChildCounts();
+	}
+}
+
+void SampleDirectory::rebuildSampleTable()
+{
+	SAMPLORE_TRACE_ZONE("SampleDirectory::rebuildSampleTable");
+	jassert(mParent == nullptr);
+	static uint64 lastTableVersion = 0; //message thread, across every root so versions are never reused
+	Rows previous;
+	previous.swap(mSampleTable);
+	mEnabledSamples.clear();
+	int nextFolderIndex = 0;
+	appendToSampleTable(*this, nextFolderIndex);
+	if (mSampleTableVersion == 0 || mSampleTable != previous)
+	{
+		mSampleTableVersion = ++lastTableVersion;
+	}
+	mFolderLayoutVersion = ++lastTableVersion;
+}
+
+void SampleDirectory::appendToSampleTable(SampleDirectory& root, int& nextFolderIndex)
+{
+	mFolderIndex = nextFolderIndex++;
+	mSampleStart = (int)root.mSampleTable.size();
+	root.mSampleTable.insert(root.mSampleTable.end(), mChildSamples.begin(), mChildSamples.end());
+	root.mSampleTable.insert(root.mSampleTable.end(), mUnbuiltSamples.begin(), mUnbuiltSamples.end());
+	updateEnabledSamples(root);
+	for (int i = 0; i < mChildDirectories.size(); i++)
+	{
+		mChildDirectories[i]->appendToSampleTable(root, nextFolderIndex);
+	}
+	mFolderEnd = nextFolderIndex;
+	mSampleEnd = (int)root.mSampleTable.size();
 }
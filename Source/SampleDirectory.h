@@ -15,6 +15,8 @@
 #include <vector>
 
 #include "Sample.h"
+#include "SampleRow.h"
+#include "LibraryIndex.h"
 
 namespace samplore
 {
@@ -25,39 +27,122 @@ namespace samplore
 		Disabled,
 		Mixed,
 	};
-	class SampleDirectory: public ChangeBroadcaster, public ChangeListener
+	class SampleDirectory: public ChangeBroadcaster
 	{
 	public:
-		SampleDirectory(File file);
+		SampleDirectory(File file, SampleDirectory* parent = nullptr);
+		/// Root from index, only folders modified since it was stored are listed again. The folders below
+		/// one that was not are built once expanded, until then their samples are rows of the table only
+		SampleDirectory(File file, const LibraryIndex& index);
 		~SampleDirectory();
+		/// Root only, writes the tree as it is now for the next launch
+		void storeInIndex(LibraryIndex& index) const;
 		File getFile() const { return mDirectory; }
-		Sample::List getChildSamplesRecursive(juce::String query, bool ignoreCheckSystem);
 		Sample::List getChildSamples();
 
-		void updateChildrenItems(CheckStatus checkStatus);
-
-		void changeListenerCallback(ChangeBroadcaster* source) override;
 		void cycleCurrentCheck();
 
+		/// Sets this folder and everything below it, then updates the parents in O(depth)
 		void setCheckStatus(CheckStatus newCheckStatus);
 		CheckStatus getCheckStatus() { return mCheckStatus; }
-		int getChildDirectoryCount() { return mChildDirectories.size(); }
+		/// Known without building them
+		int getChildDirectoryCount() { return mBuilt ? (int)mChildDirectories.size() : (int)mUnbuiltFolders.size(); }
 
-		void recursiveRefresh();
 		void rescanFiles();
+		/// Builds the child folders first if they were restored from the index and not built yet
 		std::shared_ptr<SampleDirectory> getChildDirectory(int index);
+		/// Makes a node for each child folder restored from the index, checking each against the disk
+		/// as startup used to. Lays out the root again and tells it, nothing if they were built already
+		void buildChildDirectories();
+		/// False while the folders below are restored from the index and not built yet
+		bool isBuilt() const { return mBuilt; }
+		SampleDirectory* getParentDirectory() const { return mParent; }
+		SampleDirectory& getRoot() { return *mRoot; }
+
+		/// Pre-order numbering within the root, the subtree is [getFolderIndex(), getFolderEnd())
+		int getFolderIndex() const { return mFolderIndex; }
+		int getFolderEnd() const { return mFolderEnd; }
+		/// Range of the root sample table holding this subtree
+		Range<int> getSampleRange() const { return Range<int>(mSampleStart, mSampleEnd); }
+		/// True if other is this folder or below it
+		bool containsDirectory(const SampleDirectory& other) const;
+		bool containsSample(const Sample::Reference& sample) const;
+
+		/// Root only, every sample below the root in folder pre-order, built or not
+		const std::vector<std::shared_ptr<SampleRow>>& getSampleTable() const { return mSampleTable; }
+		/// Root only, true if the folder holding getSampleTable()[index] is checked
+		bool isSampleEnabled(int index) const { return mEnabledSamples[index]; }
+		/// Root only, bit per entry of getSampleTable()
+		const BigInteger& getEnabledSamples() const { return mEnabledSamples; }
+		/// Root only, unique to each layout of the sample table, checks leave it alone
+		uint64 getSampleTableVersion() const { return mSampleTableVersion; }
+		/// Root only, changes with the table and whenever folders are built, their rows staying where they were
+		uint64 getFolderLayoutVersion() const { return mFolderLayoutVersion; }
 
 
 	friend class SamploreApplication; //sets the wildcard really early
 	friend class DirectoryExplorerTreeViewItem;
 private:
+	/// What is kept of an indexed folder until it is built, its samples are rows of the table already
+	struct UnbuiltFolder
+	{
+		String mName;
+		int64 mModified = 0;
+		int mSampleCount = 0; //in the folder itself, the first rows of its subtree
+		int mSubtreeSampleCount = 0; //in it and below
+		std::vector<UnbuiltFolder> mFolders;
+	};
+	using Rows = std::vector<std::shared_ptr<SampleRow>>;
 
 	SampleDirectory(const samplore::SampleDirectory& samplify) {}; //dont call me
+	/// Folder below one restored from the index, rows are the samples of its subtree in pre-order
+	SampleDirectory(File file, UnbuiltFolder& indexed, Rows rows, SampleDirectory* parent);
+
+	static bool isEnabledStatus(CheckStatus status) { return status == CheckStatus::Enabled || status == CheckStatus::Mixed; }
+	void countChildStatus(CheckStatus status, int delta);
+	CheckStatus getStatusFromChildCounts() const;
+	void applyCheckStatusToSubtree(CheckStatus status, SampleDirectory* root);
+	void childCheckStatusChanged(CheckStatus oldStatus, CheckStatus newStatus, SampleDirectory& root);
+	void updateEnabledSamples(SampleDirectory& root);
+	/// Lists file, or takes its contents from indexed and rows if the folder has not been modified since
+	void load(const File& file, UnbuiltFolder* indexed, Rows rows);
+	/// A row for every sample of indexed and below, added to rows in pre-order
+	UnbuiltFolder takeIndexed(const LibraryIndex::Folder& indexed, const File& file, Rows& rows);
+	/// Nodes for the unbuilt folders, without laying out the root
+	void buildChildren();
+	LibraryIndex::Folder toIndex() const;
+	static LibraryIndex::Folder toIndex(const UnbuiltFolder& unbuilt, const File& file, Rows::const_iterator& next);
+	void setRoot(SampleDirectory* root);
+	void rescanFilesRecursive();
+	/// Root only, lays every sample out depth first and rebuilds the enabled bitmap
+	void rebuildSampleTable();
+	void appendToSampleTable(SampleDirectory& root, int& nextFolderIndex);
+
 	CheckStatus mCheckStatus = CheckStatus::Enabled;
 	File mDirectory;
-	bool mIncludeChildSamples = true; //if the folder should load its own samples when getsamples is called
-	std::vector<std::shared_ptr<Sample>> mChildSamples; //safer
+	int64 mModified = 0; //of the folder when it was last listed, milliseconds
+	SampleDirectory* mParent = nullptr;
+	SampleDirectory* mRoot = this;
+	Rows mChildSamples; //in this folder
 	std::vector<std::shared_ptr<SampleDirectory>> mChildDirectories;
+	//restored from the index and not built yet, see buildChildDirectories
+	bool mBuilt = true;
+	std::vector<UnbuiltFolder> mUnbuiltFolders;
+	Rows mUnbuiltSamples; //of the unbuilt folders, in pre-order after ours
+	//tri-state bookkeeping so a child change doesnt need to rescan its siblings
+	int mEnabledChildCount = 0;
+	int mDisabledChildCount = 0;
+	int mMixedChildCount = 0;
+	int mSampleStart = 0; //index of our first sample in the root sample table
+	int mSampleEnd = 0; //one past the last sample of our subtree
+	int mFolderIndex = 0;
+	int mFolderEnd = 0;
+
+	//Root only
+	Rows mSampleTable;
+	BigInteger mEnabledSamples; //bit per entry of mSampleTable, set if its folder is checked
+	uint64 mSampleTableVersion = 0;
+	uint64 mFolderLayoutVersion = 0;
 
 	// Use function to avoid static destruction order issues
 	static String& getWildcard()
@@ -1,4 +1,5 @@
 #include "SampleExplorer.h"
+#include "Diagnostics.h"
 #include "SampleLibrary.h"
 #include "SamplifyProperties.h"
 #include "SamplifyMainComponent.h"
@@ -30,6 +31,8 @@ SampleExplorer::SampleExplorer() : mViewport(&mSampleContainer)
 
 SampleExplorer::~SampleExplorer()
 {
+	stopTimer();
+
 	// Remove from ThemeManager
 	ThemeManager::getInstance().removeListener(this);
 	
@@ -42,6 +45,7 @@ SampleExplorer::~SampleExplorer()
 
 void SampleExplorer::paint (Graphics& g)
 {
+	Diagnostics::PaintScope paintScope(Diagnostics::PaintClass::SampleExplorer);
 	auto& theme = ThemeManager::getInstance();
 	auto sampleLib = SamplifyProperties::getInstance()->getSampleLibrary();
 	
@@ -88,7 +92,7 @@ void SampleExplorer::paint (Graphics& g)
 		String message = "Add sample directories to get started.\n\nGo to File -> Preferences to add directories.";
 		g.drawFittedText(message, messageBox, Justification::centred, 4);
 	}
-	else if (sampleLib->getCurrentSamples().size() == 0)
+	else if (sampleLib->getCurrentSampleCount() == 0)
 	{
 		// Directories exist but no samples found
 		g.fillAll(theme.getColorForRole(ThemeManager::ColorRole::Background));
@@ -143,7 +147,7 @@ void SampleExplorer::resized()
 {
 	auto sampleLib = SamplifyProperties::getInstance()->getSampleLibrary();
 	bool hasDirectories = !sampleLib->getDirectories().empty();
-	bool hasSamples = sampleLib->getCurrentSamples().size() > 0;
+	bool hasSamples = sampleLib->getCurrentSampleCount() > 0;
 	
 	// Hide search/filter UI when showing empty state
 	bool showUI = hasDirectories && (hasSamples || !mSearchBar.getText().isEmpty());
@@ -159,7 +163,35 @@ void SampleExplorer::resized()
 
 void SampleExplorer::textEditorTextChanged(TextEditor& e)
 {
-	SamplifyProperties::getInstance()->getSampleLibrary()->updateCurrentSamples(e.getText());
+	//restart the countdown on every keystroke so only the latest text is queried
+	startTimer(AppValues::getInstance().SEARCH_DEBOUNCE_MS);
+}
+
+void SampleExplorer::timerCallback()
+{
+	stopTimer();
+	SamplifyProperties::getInstance()->getSampleLibrary()->updateCurrentSamples(mSearchBar.getText());
+}
+
+bool SampleExplorer::isInterestedInFileDrag(const StringArray& files)
+{
+	if (files.size() != 1 || File(files[0]).isDirectory())
+	{
+		return false;
+	}
+	const String name = File(files[0]).getFileName();
+	for (const String& pattern : StringArray::fromTokens(SampleDirectory::getWildcard(), ";", ""))
+	{
+		if (name.matchesWildcard(pattern.trim(), true))
+			return true;
+	}
+	return false;
+}
+
+void SampleExplorer::filesDropped(const StringArray& files, int x, int y)
+{
+	mSearchBar.setText("", false); //the results no longer answer the query
+	SamplifyProperties::getInstance()->getSampleLibrary()->showSimilarSamples(File(files[0]));
 }
 
 void SampleExplorer::changeListenerCallback(ChangeBroadcaster* source)
@@ -168,7 +200,7 @@ void SampleExplorer::changeListenerCallback(ChangeBroadcaster* source)
 	{
 		if (sl->isAsyncValid())
 		{
-			mSampleContainer.setSampleItems(Sample::List()); //set to empty
+			mSampleContainer.setSampleItems(nullptr); //set to empty
 			mIsUpdating = true;
 			repaint();
 		}
@@ -200,6 +232,14 @@ void SampleExplorer::comboBoxChanged(ComboBox* comboBoxThatHasChanged)
 	{
 		SamplifyProperties::getInstance()->getSampleLibrary()->sortSamples(SortingMethod::Random);
 	}
+	else if (comboBoxThatHasChanged->getSelectedId() == (int)SortingMethod::Tempo)
+	{
+		SamplifyProperties::getInstance()->getSampleLibrary()->sortSamples(SortingMethod::Tempo);
+	}
+	else if (comboBoxThatHasChanged->getSelectedId() == (int)SortingMethod::Key)
+	{
+		SamplifyProperties::getInstance()->getSampleLibrary()->sortSamples(SortingMethod::Key);
+	}
 }
 
 SampleExplorer::SampleViewport::SampleViewport(SampleContainer* container)
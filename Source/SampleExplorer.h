@@ -24,7 +24,9 @@ namespace samplore
 		public TextEditor::Listener, 
 		public ComboBox::Listener,
 		public ChangeListener,
-		public ThemeManager::Listener
+		public ThemeManager::Listener,
+		public FileDragAndDropTarget,
+		private Timer
 	{
 	public:
 		enum ColourIds
@@ -65,6 +67,10 @@ namespace samplore
 
 		void comboBoxChanged(ComboBox* comboBoxThatHasChanged) override;
 
+		/// Dropping an audio file from outside shows the library's closest matches to it
+		bool isInterestedInFileDrag(const StringArray& files) override;
+		void filesDropped(const StringArray& files, int x, int y) override;
+
 		TextEditor& getSearchBar() { return mSearchBar; }
 		SampleContainer& getSampleContainer() { return mSampleContainer; }
 		
@@ -75,6 +81,8 @@ namespace samplore
 		
 	private:
 		//============================================================
+		void timerCallback() override; //debounced search
+
 		bool mIsUpdating = false;
 		ComboBox mFilter;
 		SampleViewport mViewport;
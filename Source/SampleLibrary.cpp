@@ -1,15 +1,51 @@
 #include "SampleLibrary.h"
+#include "Tracer.h"
+#include "Diagnostics.h"
+#include "DuplicateIndex.h"
 #include "SamplifyMainComponent.h"
 
+#include <map>
+
 using namespace samplore;
 
-SampleLibrary::SampleLibrary()
+namespace
 {
-	
+	void addFolderRanges(SampleDirectory& folder, int rootStart, LibrarySnapshot::FolderRanges& ranges)
+	{
+		ranges[&folder] = folder.getSampleRange() + rootStart;
+		if (!folder.isBuilt())
+		{
+			return; //the folders below have no nodes yet, their rows are in ours
+		}
+		for (int i = 0; i < folder.getChildDirectoryCount(); i++)
+		{
+			addFolderRanges(*folder.getChildDirectory(i), rootStart, ranges);
+		}
+	}
+}
+
+SampleLibrary::SampleLibrary(bool analyseInBackground, const File& storeFile)
+	: mAnalyser(storeFile), mIndex(LibraryIndex::getDefaultFile(storeFile)), mAnalyseInBackground(analyseInBackground)
+{
+	Sample::getAnalysisStore() = &mAnalyser.getStore();
+	mAnalyser.addChangeListener(this);
 }
 
 SampleLibrary::~SampleLibrary()
 {
+	++mQueryGeneration; //running queries bail out, wait for them while what they read is still here
+	setQuery(std::future<Sample::List>());
+	for (std::future<Sample::List>& abandoned : mAbandonedQueries)
+	{
+		abandoned.wait();
+	}
+	mAnalyser.removeChangeListener(this);
+	Sample::getAnalysisStore() = nullptr;
+	for (auto& dir : mDirectories)
+	{
+		dir->storeInIndex(mIndex);
+	}
+	mIndex.save();
 	// Remove ourselves as a listener from all directories before destruction
 	for (auto& dir : mDirectories)
 	{
@@ -20,23 +56,111 @@ SampleLibrary::~SampleLibrary()
 	}
 }
 
+void SampleLibrary::refreshCurrentSamples()
+{
+	//library contents changed, cached results are stale
+	mQueryCache.clear();
+	updateCurrentSamples(mCurrentQuery);
+}
+
 void SampleLibrary::updateCurrentSamples(String query)
 {
+	SAMPLORE_TRACE_ZONE("SampleLibrary::updateCurrentSamples");
+	mPendingStartMs = Time::getMillisecondCounterHiRes();
 	mCurrentQuery = query;
+	SearchFilter filter = SearchFilter::fromQuery(query);
+	int generation = ++mQueryGeneration; //older queries still running will bail out
+	mPendingIsQuery = true;
+
+	Sample::List::Snapshot results;
+	if (mQueryCache.get(filter, results))
+	{
+		setQuery(std::future<Sample::List>());
+		stopTimer();
+		mUpdatingSamples = false;
+		mCurrentSamples = results;
+		Diagnostics::recordQueryLatency(Time::getMillisecondCounterHiRes() - mPendingStartMs);
+		sendChangeMessage();
+		return;
+	}
+
+	mPendingFilter = filter;
+	if (mQueryCache.getRefinementBase(filter, results))
+	{
+		//typing more only narrows the results, filter what we already have
+		setQuery(std::async(std::launch::async, &SampleLibrary::filterSamples, this, results, filter, generation));
+	}
+	else
+	{
+		std::shared_ptr<const LibrarySnapshot> snapshot = getSnapshot();
+		setQuery(std::async(std::launch::async, &SampleLibrary::collectSamples, this, filter, false, generation, snapshot, getScopeRange(*snapshot)));
+	}
+	mUpdatingSamples = true;
+	startTimer(QUERY_POLL_INTERVAL_MS);
+	sendChangeMessage();
+}
+
+void SampleLibrary::setQuery(std::future<Sample::List> query)
+{
+	if (mUpdateSampleFuture.valid())
+	{
+		mAbandonedQueries.push_back(std::move(mUpdateSampleFuture));
+	}
+	mAbandonedQueries.erase(std::remove_if(mAbandonedQueries.begin(), mAbandonedQueries.end(),
+		[](std::future<Sample::List>& abandoned) { return abandoned.wait_for(std::chrono::seconds(0)) == std::future_status::ready; }),
+		mAbandonedQueries.end());
+	mUpdateSampleFuture = std::move(query);
+}
 
-	if (mUpdatingSamples)
+void SampleLibrary::showSimilarSamples(Sample::Reference sample)
+{
+	if (!sample.isNull())
 	{
-		mCancelUpdating = true;
+		startSimilarityQuery(sample.getFile(), sample.getDescriptor());
 	}
-	mUpdateSampleFuture = std::future<Sample::List>(getAllSamplesInDirectories_Async(query));
+}
+
+void SampleLibrary::showSimilarSamples(const File& file)
+{
+	startSimilarityQuery(file, nullptr);
+}
+
+void SampleLibrary::startSimilarityQuery(const File& file, std::shared_ptr<const SampleDescriptor> descriptor)
+{
+	int generation = ++mQueryGeneration;
+	mPendingIsQuery = false;
+	mPendingStartMs = Time::getMillisecondCounterHiRes();
+	setQuery(std::async(std::launch::async, &SampleLibrary::collectSimilarSamples, this, file, descriptor, mAnalyser.getDescriptorTable(), generation));
 	mUpdatingSamples = true;
-	//mCurrentSamples = getAllSamplesInDirectories(query, false);
+	startTimer(QUERY_POLL_INTERVAL_MS);
 	sendChangeMessage();
 }
 
+void SampleLibrary::showDuplicateSamples()
+{
+	int generation = ++mQueryGeneration;
+	mPendingIsQuery = false;
+	mPendingStartMs = Time::getMillisecondCounterHiRes();
+	setQuery(std::async(std::launch::async, &SampleLibrary::collectDuplicateSamples, this, getSnapshot(), generation));
+	mUpdatingSamples = true;
+	startTimer(QUERY_POLL_INTERVAL_MS);
+	sendChangeMessage();
+}
+
+void SampleLibrary::hashSample(std::shared_ptr<SampleRow> row)
+{
+	if (mAnalyseInBackground)
+	{
+		mAnalyser.queueSample(row);
+	}
+}
+
 void SampleLibrary::sortSamples(SortingMethod method)
 {
-	mCurrentSamples.sort(method);
+	//published snapshots are immutable, sort a copy and swap it in
+	auto sorted = std::make_shared<Sample::List>(*mCurrentSamples);
+	sorted->sort(method);
+	mCurrentSamples = sorted;
 	sendChangeMessage();
 }
 
@@ -52,11 +176,20 @@ void SampleLibrary::addDirectory(const File& dir)
 		}
 	}
 	
-	std::shared_ptr<SampleDirectory> sampDir = std::make_shared<SampleDirectory>(dir);
+	std::shared_ptr<SampleDirectory> sampDir = std::make_shared<SampleDirectory>(dir, mIndex);
+	if (!mAnalyseInBackground)
+	{
+		//no analyser comes by to catch files overwritten in place, check them before anything is queried
+		for (const auto& row : sampDir->getSampleTable())
+		{
+			row->verifyIndexedEntry();
+		}
+	}
 	sampDir->addChangeListener(this);
 	mDirectories.push_back(sampDir);
 	
 	// Rescan all samples to include new directory
+	publishSnapshot();
 	refreshCurrentSamples();
 	sendChangeMessage();
 }
@@ -68,9 +201,16 @@ void SampleLibrary::removeDirectory(const File& dir)
 		if ((*it)->getFile() == dir)
 		{
 			(*it)->removeChangeListener(this);
+			mIndex.forget(dir);
+			std::shared_ptr<SampleDirectory> scope = mDirectoryScope.lock();
+			if (scope != nullptr && (*it)->containsDirectory(*scope))
+			{
+				mDirectoryScope.reset();
+			}
 			mDirectories.erase(it);
 			
 			// Rescan all samples to remove samples from deleted directory
+			publishSnapshot();
 			refreshCurrentSamples();
 			sendChangeMessage();
 			return;
@@ -85,28 +225,112 @@ void SampleLibrary::refreshDirectories()
 	{
 		dir->rescanFiles();
 	}
+	publishSnapshot();
 	refreshCurrentSamples();
 }
-File SampleLibrary::getRelativeDirectoryForFile(const File& sampleFile) const
+void SampleLibrary::setDirectoryScope(std::shared_ptr<SampleDirectory> dir)
+{
+	if (dir == mDirectoryScope.lock())
+	{
+		return;
+	}
+	mDirectoryScope = dir;
+	refreshCurrentSamples(); //cached results belong to the old scope
+}
+
+void SampleLibrary::changeListenerCallback(ChangeBroadcaster* source)
 {
-	for (int i = 0; i < mDirectories.size(); i++)
+	if (source == &mAnalyser)
 	{
-		if (sampleFile.isAChildOf(mDirectories[i]->getFile()))
+		//new tempos and keys, only results that depend on them need to be redone
+		mQueryCache.clearAnalysisResults();
+		//similarity and duplicate results stay up, redoing the query would replace them
+		if (mPendingIsQuery && SearchFilter::fromQuery(mCurrentQuery).usesAnalysis())
 		{
-			return sampleFile.getRelativePathFrom(mDirectories[i]->getFile());
+			updateCurrentSamples(mCurrentQuery);
 		}
+		return;
+	}
+	//a root was checked, rescanned or had folders built
+	std::shared_ptr<const LibrarySnapshot> previous = getSnapshot();
+	publishSnapshot();
+	std::shared_ptr<const LibrarySnapshot> published = getSnapshot();
+	if (published->mRowsVersion != previous->mRowsVersion || published->mEnabled != previous->mEnabled)
+	{
+		refreshCurrentSamples();
 	}
-	return File();
 }
 
-void SampleLibrary::changeListenerCallback(ChangeBroadcaster* source)
+void SampleLibrary::publishSnapshot()
 {
-	refreshCurrentSamples();
+	SAMPLORE_TRACE_ZONE("SampleLibrary::publishSnapshot");
+	std::shared_ptr<const LibrarySnapshot> previous = getSnapshot();
+	auto snapshot = std::make_shared<LibrarySnapshot>();
+	snapshot->mVersion = previous->mVersion + 1;
+	bool rowsChanged = previous->mRoots.size() != mDirectories.size();
+	bool layoutChanged = rowsChanged;
+	int start = 0;
+	for (size_t i = 0; i < mDirectories.size(); i++)
+	{
+		const SampleDirectory& dir = *mDirectories[i];
+		snapshot->mRoots.push_back(&dir);
+		snapshot->mRootStarts.push_back(start);
+		snapshot->mRootTableVersions.push_back(dir.getSampleTableVersion());
+		snapshot->mRootLayoutVersions.push_back(dir.getFolderLayoutVersion());
+		rowsChanged = rowsChanged || previous->mRoots[i] != &dir || previous->mRootTableVersions[i] != dir.getSampleTableVersion();
+		layoutChanged = layoutChanged || rowsChanged || previous->mRootLayoutVersions[i] != dir.getFolderLayoutVersion();
+		BigInteger enabled = dir.getEnabledSamples();
+		enabled <<= start;
+		snapshot->mEnabled |= enabled;
+		start += (int)dir.getSampleTable().size();
+	}
+	if (rowsChanged)
+	{
+		auto rows = std::make_shared<LibrarySnapshot::Rows>();
+		rows->reserve((size_t)start);
+		for (size_t i = 0; i < mDirectories.size(); i++)
+		{
+			rows->insert(rows->end(), mDirectories[i]->getSampleTable().begin(), mDirectories[i]->getSampleTable().end());
+		}
+		snapshot->mSamples = rows;
+		snapshot->mRowsVersion = previous->mRowsVersion + 1;
+	}
+	else
+	{
+		//a folder was checked or built, the rows are where they were
+		snapshot->mSamples = previous->mSamples;
+		snapshot->mRowsVersion = previous->mRowsVersion;
+	}
+	if (layoutChanged)
+	{
+		auto ranges = std::make_shared<LibrarySnapshot::FolderRanges>();
+		for (size_t i = 0; i < mDirectories.size(); i++)
+		{
+			addFolderRanges(*mDirectories[i], snapshot->mRootStarts[i], *ranges);
+		}
+		snapshot->mFolderRanges = ranges;
+	}
+	else
+	{
+		snapshot->mFolderRanges = previous->mFolderRanges;
+	}
+	//readers holding the old snapshot keep it, and its samples, alive until they finish
+	std::atomic_store(&mSnapshot, std::shared_ptr<const LibrarySnapshot>(snapshot));
+	if (mAnalyseInBackground)
+	{
+		mAnalyser.analyse(snapshot);
+	}
 }
 
-Sample::List SampleLibrary::getCurrentSamples()
+Range<int> SampleLibrary::getScopeRange(const LibrarySnapshot& snapshot) const
 {
-	return mCurrentSamples;
+	std::shared_ptr<SampleDirectory> scope = mDirectoryScope.lock();
+	if (scope != nullptr)
+	{
+		//as laid out in the snapshot, the tree may have been rescanned since
+		return snapshot.getFolderRange(scope.get()).getIntersectionWith(Range<int>(0, snapshot.size()));
+	}
+	return Range<int>(0, snapshot.size());
 }
 
 StringArray samplore::SampleLibrary::getUsedTags()
@@ -126,18 +350,25 @@ StringArray samplore::SampleLibrary::getUsedTags()
 
 void SampleLibrary::timerCallback()
 {
-	if (mUpdateSampleFuture.valid() && mUpdatingSamples && !mCancelUpdating)
+	if (!mUpdateSampleFuture.valid() || !mUpdatingSamples)
 	{
-		mCurrentSamples = mUpdateSampleFuture.get();
 		stopTimer();
-		mUpdatingSamples = false;
-		sendChangeMessage();
+		return;
 	}
-	else
+	if (mUpdateSampleFuture.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
 	{
-		stopTimer();
+		return; //still running, poll again
 	}
-	
+	stopTimer();
+	mCurrentSamples = std::make_shared<const Sample::List>(mUpdateSampleFuture.get());
+	mUpdatingSamples = false;
+	Tracer::counter("query results", mCurrentSamples->size());
+	Diagnostics::recordQueryLatency(Time::getMillisecondCounterHiRes() - mPendingStartMs);
+	if (mPendingIsQuery)
+	{
+		mQueryCache.put(mPendingFilter, mCurrentSamples);
+	}
+	sendChangeMessage();
 }
 
 void SampleLibrary::addTag(juce::String text, Colour color)
@@ -223,23 +454,129 @@ SampleLibrary::Tag SampleLibrary::getTag(juce::String tag)
 
 Sample::List SampleLibrary::getAllSamplesInDirectories(juce::String query, bool ignoreCheckSystem)
 {
+	std::shared_ptr<const LibrarySnapshot> snapshot = getSnapshot();
+	return collectSamples(SearchFilter::fromQuery(query), ignoreCheckSystem, -1, snapshot, Range<int>(0, snapshot->size()));
+}
+
+
+std::future<Sample::List> SampleLibrary::getAllSamplesInDirectories_Async(juce::String query, bool ignoreCheckSystem)
+{
+	std::shared_ptr<const LibrarySnapshot> snapshot = getSnapshot();
+	return std::async(std::launch::async, &SampleLibrary::collectSamples, this, SearchFilter::fromQuery(query), ignoreCheckSystem, -1, snapshot, Range<int>(0, snapshot->size()));
+}
+
+Sample::List SampleLibrary::collectSamples(SearchFilter filter, bool ignoreCheckSystem, int generation, std::shared_ptr<const LibrarySnapshot> snapshot, Range<int> range)
+{
+	SAMPLORE_TRACE_ZONE("SampleLibrary::collectSamples");
+	//only reads the snapshot and per-sample records, scans and edits can carry on meanwhile
 	Sample::List list;
-	for (int i = 0; i < mDirectories.size(); i++)
+	for (int i = range.getStart(); i < range.getEnd(); i++)
 	{
-		list += mDirectories[i]->getChildSamplesRecursive(query, ignoreCheckSystem);
-		if (mCancelUpdating)
+		if ((i & 1023) == 0 && isQueryCancelled(generation))
+		{
+			return Sample::List();
+		}
+		if (!ignoreCheckSystem && !snapshot->mEnabled[i])
 		{
-			mCancelUpdating = false;
-			return list;
+			continue;
+		}
+		if (snapshot->getRow(i)->getRecord()->matches(filter))
+		{
+			list.addSample(Sample::Reference(snapshot->getRow(i)));
 		}
 	}
 	return list;
 }
 
+Sample::List SampleLibrary::collectSimilarSamples(File file, std::shared_ptr<const SampleDescriptor> descriptor, std::shared_ptr<const DescriptorTable> table, int generation)
+{
+	SAMPLORE_TRACE_ZONE("SampleLibrary::collectSimilarSamples");
+	if (descriptor == nullptr)
+	{
+		//dragged in from outside or not reached by the analyser yet
+		SampleAnalysis analysis = mAnalyser.analyseFile(file);
+		if (!analysis.mHasDescriptor || isQueryCancelled(generation))
+		{
+			return Sample::List();
+		}
+		descriptor = std::make_shared<const SampleDescriptor>(analysis.mDescriptor);
+	}
+	return mSimilarityFinder.findSimilar(*descriptor, table, getSnapshot(), SIMILAR_RESULT_COUNT, file);
+}
 
-std::future<Sample::List> SampleLibrary::getAllSamplesInDirectories_Async(juce::String query, bool ignoreCheckSystem)
+Sample::List SampleLibrary::collectDuplicateSamples(std::shared_ptr<const LibrarySnapshot> snapshot, int generation)
+{
+	SAMPLORE_TRACE_ZONE("SampleLibrary::collectDuplicateSamples");
+	AnalysisStore& store = mAnalyser.getStore();
+	//across every folder, checked or not, a copy in an unchecked one still takes up space
+	DuplicateIndex index;
+	std::vector<int> rows;
+	//a folder's rows are consecutive, listing it once gives each file's size and date from a single stat
+	File listedFolder;
+	std::map<String, std::pair<int64, int64>> listed;
+	for (int i = 0; i < snapshot->size(); i++)
+	{
+		if ((i & 1023) == 0 && isQueryCancelled(generation))
+		{
+			return Sample::List();
+		}
+		const File file = snapshot->getRow(i)->getRecord()->mFile;
+		if (file.getParentDirectory() != listedFolder)
+		{
+			listedFolder = file.getParentDirectory();
+			listed.clear();
+			DirectoryIterator iter(listedFolder, false, SampleDirectory::getWildcard(), File::findFiles);
+			int64 size = 0;
+			Time modified;
+			while (iter.next(nullptr, nullptr, &size, &modified, nullptr, nullptr))
+			{
+				listed[iter.getFile().getFileName()] = { size, modified.toMilliseconds() };
+			}
+		}
+		auto found = listed.find(file.getFileName());
+		if (found == listed.end())
+		{
+			continue; //deleted since the snapshot
+		}
+		//files the analyser has not reached have no hash, or a hash but no fingerprint yet
+		const uint64 content = store.findContentHash(file, found->second.first, found->second.second);
+		SampleAnalysis analysis;
+		if (content != 0 && store.getAnalysis(content, analysis) && analysis.mHasAudioFingerprint)
+		{
+			index.add(content, analysis.mAudioFingerprint);
+			rows.push_back(i);
+		}
+	}
+	if (isQueryCancelled(generation))
+	{
+		return Sample::List();
+	}
+	Sample::List list;
+	for (const DuplicateIndex::Group& group : index.getGroups())
+	{
+		const String count(group.mItems.size());
+		list.addSection(group.mIdentical ? "Identical - " + count + " copies" : "Near-duplicates - " + count + " samples");
+		for (int item : group.mItems)
+			list.addSample(Sample::Reference(snapshot->getRow(rows[item])));
+	}
+	return list;
+}
+
+Sample::List SampleLibrary::filterSamples(Sample::List::Snapshot base, SearchFilter filter, int generation)
 {
-	std::future<Sample::List> asfunc = std::async(std::launch::async, &SampleLibrary::getAllSamplesInDirectories, this, query, ignoreCheckSystem);
-	startTimer(300);
-	return asfunc;
+	SAMPLORE_TRACE_ZONE("SampleLibrary::filterSamples");
+	Sample::List list;
+	for (int i = 0; i < base->size(); i++)
+	{
+		if ((i & 1023) == 0 && isQueryCancelled(generation))
+		{
+			return Sample::List();
+		}
+		Sample::Reference sample = (*base)[i];
+		if (sample.isQueryValid(filter))
+		{
+			list.addSample(sample);
+		}
+	}
+	return list;
 }
\ No newline at end of file
@@ -14,9 +14,14 @@
 #include "JuceHeader.h"
 
 #include "SampleDirectory.h"
+#include "SampleQueryCache.h"
+#include "LibrarySnapshot.h"
+#include "LibraryAnalyser.h"
+#include "SimilarityIndex.h"
 
 #include <vector>
 #include <future>
+#include <atomic>
 #include <algorithm>
 
 namespace samplore
@@ -41,15 +46,30 @@ namespace samplore
 		juce::Colour mColor;
 	};
 
-		SampleLibrary();
+		/// analyseInBackground false leaves analysis to explicit LibraryAnalyser::analyse calls, for the command line.
+		/// storeFile is the analysis log, benchmarks use a disposable one, the library index is kept next to it
+		explicit SampleLibrary(bool analyseInBackground = true, const File& storeFile = AnalysisStore::getDefaultFile());
 		~SampleLibrary();
 
-		void refreshCurrentSamples() { updateCurrentSamples(mCurrentQuery); }
+		void refreshCurrentSamples();
 		void updateCurrentSamples(String query);
+		/// Replaces the current samples with those that sound most like sample, nearest first
+		void showSimilarSamples(Sample::Reference sample);
+		/// Same for a file that need not be in the library, it is analysed first
+		void showSimilarSamples(const File& file);
+		/// Replaces the current samples with every set of copies across all directories, a section
+		/// each, identical files or near-duplicates. Covers what the analyser has fingerprinted so far
+		void showDuplicateSamples();
+		/// Call when tags or paths of a sample change so cached search results are dropped
+		void sampleMetadataChanged() { mQueryCache.clear(); }
+		/// Message thread, hashes the sample of row on the analyser pool, nothing on the command line
+		void hashSample(std::shared_ptr<SampleRow> row);
 
 		void sortSamples(SortingMethod method);
 
-		Sample::List getCurrentSamples();
+		/// Current results, hold on to the snapshot instead of copying the list
+		Sample::List::Snapshot getCurrentSamples() const { return mCurrentSamples; }
+		int getCurrentSampleCount() const { return mCurrentSamples->size(); }
 		String getCurrentQuery() { return mCurrentQuery; }
 
 		StringArray getUsedTags(); //get tags that are currently connected to one or more samples
@@ -72,15 +92,23 @@ namespace samplore
 
 		///Directory Manager Merger - Reduce dependencies, less pointers, easier saving
 		void addDirectory(const File& dir);
-		std::vector<std::shared_ptr<SampleDirectory>> getDirectories() { return mDirectories; }
+		const std::vector<std::shared_ptr<SampleDirectory>>& getDirectories() const { return mDirectories; }
 		void removeDirectory(const File& dir);
 		void refreshDirectories();
 		int getDirectoryCount() { return mDirectories.size(); }
 
-		File getRelativeDirectoryForFile(const File& sampleFile) const;
+		/// Limits current samples to one folder subtree, nullptr browses every directory
+		void setDirectoryScope(std::shared_ptr<SampleDirectory> dir);
+		std::shared_ptr<SampleDirectory> getDirectoryScope() const { return mDirectoryScope.lock(); }
 
 		void changeListenerCallback(ChangeBroadcaster* source) override;
 
+		/// Latest published library, safe to call and hold from any thread
+		std::shared_ptr<const LibrarySnapshot> getSnapshot() const { return std::atomic_load(&mSnapshot); }
+
+		/// Tempo analysis of everything in the library, restarted whenever a snapshot is published
+		LibraryAnalyser& getAnalyser() { return mAnalyser; }
+
 		bool isAsyncValid() { return mUpdateSampleFuture.valid(); }
 
 		//Get Samples
@@ -88,11 +116,39 @@ namespace samplore
 		std::future<Sample::List> getAllSamplesInDirectories_Async(juce::String query = "", bool ignoreCheckSystem = false);
 
 	private:
+		//Query workers, return early once a newer query generation has started
+		Sample::List collectSamples(SearchFilter filter, bool ignoreCheckSystem, int generation, std::shared_ptr<const LibrarySnapshot> snapshot, Range<int> range);
+		Sample::List filterSamples(Sample::List::Snapshot base, SearchFilter filter, int generation);
+		Sample::List collectSimilarSamples(File file, std::shared_ptr<const SampleDescriptor> descriptor, std::shared_ptr<const DescriptorTable> table, int generation);
+		void startSimilarityQuery(const File& file, std::shared_ptr<const SampleDescriptor> descriptor);
+		Sample::List collectDuplicateSamples(std::shared_ptr<const LibrarySnapshot> snapshot, int generation);
+		bool isQueryCancelled(int generation) const { return generation >= 0 && generation != mQueryGeneration.load(); }
+		/// Makes query the current one, a superseded query still running is left to finish without waiting on it
+		void setQuery(std::future<Sample::List> query);
+		/// Rebuilds the snapshot from the directory tree, message thread only
+		void publishSnapshot();
+		/// Part of snapshot the current directory scope covers
+		Range<int> getScopeRange(const LibrarySnapshot& snapshot) const;
+
+		static const int QUERY_POLL_INTERVAL_MS = 30;
+		static const int SIMILAR_RESULT_COUNT = 50;
+
 		std::future<Sample::List> mUpdateSampleFuture;
+		std::vector<std::future<Sample::List>> mAbandonedQueries; //destroyed once ready, destroying a running one blocks
 		bool mUpdatingSamples = false;
-		bool mCancelUpdating = false;
-		Sample::List mCurrentSamples;
+		std::atomic<int> mQueryGeneration { 0 };
+		Sample::List::Snapshot mCurrentSamples = std::make_shared<const Sample::List>();
 		String mCurrentQuery;
+		SearchFilter mPendingFilter;
+		bool mPendingIsQuery = true; //similarity and duplicate results are not, keep them out of the cache and up while analysis runs
+		double mPendingStartMs = 0.0; //for the latency in Diagnostics
+		SampleQueryCache mQueryCache;
+		LibraryAnalyser mAnalyser;
+		LibraryIndex mIndex; //folder trees as last seen, saved on the way out
+		SimilarityFinder mSimilarityFinder;
+		std::weak_ptr<SampleDirectory> mDirectoryScope;
+		const bool mAnalyseInBackground;
+		std::shared_ptr<const LibrarySnapshot> mSnapshot = std::make_shared<const LibrarySnapshot>(); //only touch with std::atomic_load/atomic_store
 
 		std::vector<Tag> mTags;
 		//pointer necessary to keep the check system
@@ -10,6 +10,7 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "SamplePlayerComponent.h"
+#include "Diagnostics.h"
 #include "SamplifyProperties.h"
 #include "SamplifyLookAndFeel.h"
 #include "ThemeManager.h"
@@ -26,6 +27,8 @@ SamplePlayerComponent::SamplePlayerComponent() : mSampleTagContainer(false)
     addAndMakeVisible(mSampleRemoveColorButton);
     addAndMakeVisible(mSampleDirectoryChainButton);
     addAndMakeVisible(mSampleTagContainer);
+    addAndMakeVisible(mSpeedSlider);
+    addAndMakeVisible(mKeepPitchButton);
 
     // Color selector button
     mSampleColorSelectorButton.setName("SetSampleColor");
@@ -41,6 +44,21 @@ SamplePlayerComponent::SamplePlayerComponent() : mSampleTagContainer(false)
     mSampleDirectoryChainButton.setButtonText("Parent Folders");
     mSampleDirectoryChainButton.addListener(this);
 
+    // Preview speed, the default leaves the audio untouched
+    mSpeedSlider.setSliderStyle(Slider::LinearHorizontal);
+    mSpeedSlider.setTextBoxStyle(Slider::TextBoxLeft, false, 48, 20);
+    mSpeedSlider.setRange(TempoPitchSource::MIN_SPEED, TempoPitchSource::MAX_SPEED, 0.01);
+    mSpeedSlider.setSkewFactorFromMidPoint(1.0);
+    mSpeedSlider.setValue(1.0, dontSendNotification);
+    mSpeedSlider.setDoubleClickReturnValue(true, 1.0);
+    mSpeedSlider.setTextValueSuffix("x");
+    mSpeedSlider.setTooltip("Preview speed");
+    mSpeedSlider.onValueChange = [this]() { applyPlaybackSpeed(); };
+
+    mKeepPitchButton.setButtonText("Keep Pitch");
+    mKeepPitchButton.setTooltip("Change tempo without changing the key");
+    mKeepPitchButton.onClick = [this]() { applyPlaybackSpeed(); };
+
     // Info editor
     mSampleInfoEditor.addListener(this);
     mSampleInfoEditor.setTextToShowWhenEmpty("Add notes about this sample...",
@@ -105,6 +123,11 @@ void SamplePlayerComponent::onColourChanged(Colour newColour)
     resized();
 }
 
+void SamplePlayerComponent::applyPlaybackSpeed()
+{
+    SamplifyProperties::getInstance()->getAudioPlayer()->setPlaybackSpeed(mSpeedSlider.getValue(), mKeepPitchButton.getToggleState());
+}
+
 void SamplePlayerComponent::buttonClicked(Button* b)
 {
     Sample::Reference samp = getCurrentSample();
@@ -136,6 +159,7 @@ void SamplePlayerComponent::buttonClicked(Button* b)
 
 void SamplePlayerComponent::paint (Graphics& g)
 {
+    Diagnostics::PaintScope paintScope(Diagnostics::PaintClass::SamplePlayerComponent);
     auto& theme = ThemeManager::getInstance();
     Sample::Reference samp = getCurrentSample();
 
@@ -216,9 +240,13 @@ void SamplePlayerComponent::resized()
                                          (getHeight() / 2) - padding);
         y = m_ThumbnailRect.getBottom() + padding;
 
-        // Title and parent folders button row
-        m_TitleRect = Rectangle<int>(padding, y, getWidth() - buttonWidth - (padding * 3),
+        // Title, speed controls and parent folders button row
+        const int speedWidth = 160;
+        const int keepPitchWidth = 100;
+        m_TitleRect = Rectangle<int>(padding, y, getWidth() - buttonWidth - speedWidth - keepPitchWidth - (padding * 3) - (itemSpacing * 2),
                                       titleHeight);
+        mSpeedSlider.setBounds(m_TitleRect.getRight() + padding, y, speedWidth, titleHeight);
+        mKeepPitchButton.setBounds(mSpeedSlider.getRight() + itemSpacing, y, keepPitchWidth, titleHeight);
         mSampleDirectoryChainButton.setBounds(getWidth() - buttonWidth - padding, y,
                                                buttonWidth, titleHeight);
         y += titleHeight + itemSpacing;
@@ -255,6 +283,8 @@ void SamplePlayerComponent::resized()
         mSampleRemoveColorButton.setBounds(0, 0, 0, 0);
         mSampleDirectoryChainButton.setBounds(0, 0, 0, 0);
         mSampleTagContainer.setBounds(0, 0, 0, 0);
+        mSpeedSlider.setBounds(0, 0, 0, 0);
+        mKeepPitchButton.setBounds(0, 0, 0, 0);
     }
 }
 
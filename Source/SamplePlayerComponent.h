@@ -56,12 +56,15 @@ namespace samplore
         TextButton mSampleRemoveColorButton;
         TextButton mSampleDirectoryChainButton;
         TagContainer mSampleTagContainer;
+        Slider mSpeedSlider;
+        ToggleButton mKeepPitchButton;
 
         Rectangle<int> m_ThumbnailRect;
         Rectangle<int> m_TitleRect;
 
         std::unique_ptr<ColourSelector> mColourSelector;
         void onColourChanged(Colour newColour);
+        void applyPlaybackSpeed();
 
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SamplePlayerComponent)
     };
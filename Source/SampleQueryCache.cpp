@@ -0,0 +1,61 @@
+#include "SampleQueryCache.h"
+
+using namespace samplore;
+
+bool SampleQueryCache::get(const SearchFilter& filter, Sample::List::Snapshot& results)
+{
+	for (auto it = mEntries.begin(); it != mEntries.end(); ++it)
+	{
+		if (it->mFilter == filter)
+		{
+			mEntries.splice(mEntries.begin(), mEntries, it);
+			results = mEntries.front().mResults;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool SampleQueryCache::getRefinementBase(const SearchFilter& filter, Sample::List::Snapshot& results)
+{
+	auto best = mEntries.end();
+	for (auto it = mEntries.begin(); it != mEntries.end(); ++it)
+	{
+		if (filter.isRefinementOf(it->mFilter))
+		{
+			if (best == mEntries.end() || it->mResults->size() < best->mResults->size())
+			{
+				best = it;
+			}
+		}
+	}
+	if (best == mEntries.end())
+	{
+		return false;
+	}
+	mEntries.splice(mEntries.begin(), mEntries, best);
+	results = mEntries.front().mResults;
+	return true;
+}
+
+void SampleQueryCache::put(const SearchFilter& filter, Sample::List::Snapshot results)
+{
+	for (auto it = mEntries.begin(); it != mEntries.end(); ++it)
+	{
+		if (it->mFilter == filter)
+		{
+			mEntries.erase(it);
+			break;
+		}
+	}
+	mEntries.push_front({ filter, results });
+	while ((int)mEntries.size() > mCapacity)
+	{
+		mEntries.pop_back();
+	}
+}
+
+void SampleQueryCache::clearAnalysisResults()
+{
+	mEntries.remove_if([](const Entry& entry) { return entry.mFilter.usesAnalysis(); });
+}
@@ -0,0 +1,52 @@
+/*
+  ==============================================================================
+
+    SampleQueryCache.h
+    Author:  Jake Rose
+
+	Small LRU of recent search results. Lets search-as-you-type filter the
+	previous result ("sn" -> "snare") instead of walking the whole library.
+
+  ==============================================================================
+*/
+
+#ifndef SAMPLEQUERYCACHE_H
+#define SAMPLEQUERYCACHE_H
+
+#include "JuceHeader.h"
+
+#include "Sample.h"
+#include "SearchFilter.h"
+
+#include <list>
+
+namespace samplore
+{
+	class SampleQueryCache
+	{
+	public:
+		SampleQueryCache(int capacity = 16) : mCapacity(capacity) {}
+
+		/// Returns true and fills results if this exact filter is cached
+		bool get(const SearchFilter& filter, Sample::List::Snapshot& results);
+		/// Returns true and fills results with the smallest cached result that filter refines
+		bool getRefinementBase(const SearchFilter& filter, Sample::List::Snapshot& results);
+		void put(const SearchFilter& filter, Sample::List::Snapshot results);
+		void clear() { mEntries.clear(); }
+		/// Drops results filtered by tempo or key, the rest do not change as analysis comes in
+		void clearAnalysisResults();
+
+		int size() const { return (int)mEntries.size(); }
+	private:
+		struct Entry
+		{
+			SearchFilter mFilter;
+			Sample::List::Snapshot mResults;
+		};
+		int mCapacity;
+		std::list<Entry> mEntries; //front is most recently used
+
+		JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SampleQueryCache)
+	};
+}
+#endif
@@ -0,0 +1,122 @@
+#include "SampleRow.h"
+#include "Tracer.h"
+
+using namespace samplore;
+
+SampleRow::SampleRow(const File& file, SampleDirectory* rootDirectory, const LibraryIndex::SampleEntry& entry)
+	: mEntry(entry), mRootDirectory(rootDirectory)
+{
+	auto record = std::make_shared<Sample::Record>();
+	record->mFile = file;
+	record->mTags = entry.mTags;
+	mRecord = record;
+}
+
+SampleRow::SampleRow(std::shared_ptr<Sample> sample) : mChecked(true), mSample(std::move(sample))
+{
+}
+
+std::shared_ptr<const Sample::Record> SampleRow::getRecord() const
+{
+	if (std::shared_ptr<Sample> sample = std::atomic_load(&mSample))
+	{
+		return sample->getRecord();
+	}
+	return std::atomic_load(&mRecord);
+}
+
+std::shared_ptr<Sample> SampleRow::getSample()
+{
+	if (std::shared_ptr<Sample> sample = std::atomic_load(&mSample))
+	{
+		return sample;
+	}
+	SAMPLORE_TRACE_ZONE("SampleRow::makeSample");
+	const ScopedLock sl(getLock());
+	if (mSample == nullptr) //another thread may have made it while we waited
+	{
+		std::shared_ptr<const Sample::Record> record = std::atomic_load(&mRecord);
+		auto sample = std::make_shared<Sample>(record->mFile, mRootDirectory, mEntry, mChecked);
+		sample->takeAnalysis(*record);
+		std::atomic_store(&mSample, sample);
+	}
+	return mSample;
+}
+
+void SampleRow::setAnalysis(const SampleAnalysis& analysis)
+{
+	{
+		const ScopedLock sl(getLock());
+		if (mSample == nullptr)
+		{
+			//as Sample::setAnalysis, the Sample takes it over when made
+			auto record = std::make_shared<Sample::Record>(*std::atomic_load(&mRecord));
+			record->mTempo = analysis.mTempo;
+			record->mKey = analysis.mKey;
+			if (analysis.mHasDescriptor && (record->mDescriptor == nullptr || !(*record->mDescriptor == analysis.mDescriptor)))
+			{
+				record->mDescriptor = std::make_shared<const SampleDescriptor>(analysis.mDescriptor);
+			}
+			std::atomic_store(&mRecord, std::shared_ptr<const Sample::Record>(record));
+			return;
+		}
+	}
+	std::atomic_load(&mSample)->setAnalysis(analysis);
+}
+
+void SampleRow::setContentHash(uint64 contentHash)
+{
+	if (contentHash == 0)
+	{
+		return;
+	}
+	{
+		const ScopedLock sl(getLock());
+		if (mSample == nullptr && contentHash == mEntry.mContentHash)
+		{
+			mChecked = true; //the analyser read the file as it is now and found what the index said
+			return;
+		}
+	}
+	//changed since it was indexed, or hashed for the first time, the metadata file moves over
+	getSample()->setContentHash(contentHash);
+}
+
+void SampleRow::verifyIndexedEntry()
+{
+	if (!hasSample())
+	{
+		if (mChecked)
+		{
+			return;
+		}
+		const File file = getRecord()->mFile;
+		if (file.getSize() == mEntry.mSize && file.getLastModificationTime().toMilliseconds() == mEntry.mModified)
+		{
+			const ScopedLock sl(getLock());
+			mChecked = true;
+			return;
+		}
+	}
+	//overwritten in place, the Sample drops the hash and tags the index gave
+	getSample()->verifyIndexedEntry();
+}
+
+LibraryIndex::SampleEntry SampleRow::getIndexEntry() const
+{
+	if (std::shared_ptr<Sample> sample = std::atomic_load(&mSample))
+	{
+		return sample->getIndexEntry();
+	}
+	return mEntry;
+}
+
+void SampleRow::clearRootDirectory()
+{
+	const ScopedLock sl(getLock());
+	mRootDirectory = nullptr;
+	if (mSample != nullptr)
+	{
+		mSample->clearRootDirectory();
+	}
+}
@@ -0,0 +1,67 @@
+/*
+  ==============================================================================
+
+    SampleRow.h
+    Author:  Jake Rose
+
+	One file of the library as the snapshot, queries and the analyser see it.
+	Restored from the LibraryIndex it holds only the file, the tags and what
+	the analyser found. The Sample, with its metadata file, thumbnail and
+	listeners, is made the first time something is shown, played or edited.
+	Startup then costs a row per indexed file instead of a Sample.
+
+  ==============================================================================
+*/
+
+#ifndef SAMPLEROW_H
+#define SAMPLEROW_H
+
+#include "JuceHeader.h"
+
+#include "Sample.h"
+#include "LibraryIndex.h"
+
+namespace samplore
+{
+	class SampleDirectory;
+	class SampleRow
+	{
+	public:
+		/// From the index, the entry is taken on trust until checked, see verifyIndexedEntry
+		SampleRow(const File& file, SampleDirectory* rootDirectory, const LibraryIndex::SampleEntry& entry);
+		/// Listed from the disk, the Sample has read its metadata file already
+		explicit SampleRow(std::shared_ptr<Sample> sample);
+
+		/// Safe from any thread, never makes the Sample
+		std::shared_ptr<const Sample::Record> getRecord() const;
+		/// Safe from any thread, makes the Sample the first time
+		std::shared_ptr<Sample> getSample();
+		bool hasSample() const { return std::atomic_load(&mSample) != nullptr; }
+
+		/// Message thread, results from the LibraryAnalyser, kept in the record until the Sample is made
+		void setAnalysis(const SampleAnalysis& analysis);
+		/// Message thread, see Sample::setContentHash. The hash the index gave only marks the entry checked
+		void setContentHash(uint64 contentHash);
+		/// Message thread, see Sample::verifyIndexedEntry. Only a file changed since makes the Sample
+		void verifyIndexedEntry();
+		/// Message thread, what the LibraryIndex keeps of us for the next launch
+		LibraryIndex::SampleEntry getIndexEntry() const;
+		/// Message thread, by the root as it lets go of us, snapshots and results can keep us alive longer
+		void clearRootDirectory();
+	private:
+		LibraryIndex::SampleEntry mEntry;
+		bool mChecked = false; //the file was compared with mEntry since the index was read
+		SampleDirectory* mRootDirectory = nullptr; //handed to the Sample, nullptr once the root is gone
+		std::shared_ptr<Sample> mSample; //nullptr until needed, only touch with std::atomic_load/atomic_store
+		std::shared_ptr<const Sample::Record> mRecord; //until then, only touch with std::atomic_load/atomic_store
+
+		/// Guards making the Sample against the message thread changing what it is made from
+		static CriticalSection& getLock()
+		{
+			static CriticalSection lock;
+			return lock;
+		}
+		JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SampleRow)
+	};
+}
+#endif
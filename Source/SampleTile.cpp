@@ -1,8 +1,11 @@
 #include "SampleTile.h"
+#include "Diagnostics.h"
 
 #include "SamplifyLookAndFeel.h"
 #include "TagTile.h"
 #include "SamplifyMainComponent.h"
+#include "SampleContainer.h"
+#include "Tracer.h"
 #include "ThemeManager.h"
 #include "UI/IconLibrary.h"
 
@@ -34,6 +37,8 @@ SampleTile::~SampleTile()
 }
 void SampleTile::paint (Graphics& g)
 {
+	SAMPLORE_TRACE_ZONE("SampleTile::paint");
+	Diagnostics::PaintScope paintScope(Diagnostics::PaintClass::SampleTile);
 	if (!mSample.isNull())
 	{
 		auto& theme = ThemeManager::getInstance();
@@ -203,6 +208,8 @@ void SampleTile::mouseUp(const MouseEvent& e)
 		if (e.mods.isLeftButtonDown())
 		{
 			SamplifyProperties::getInstance()->getAudioPlayer()->loadFile(mSample);
+			if (SampleContainer* container = findParentComponentOfClass<SampleContainer>())
+				container->preloadNeighbours(mSample);
 			if (m_ThumbnailRect.contains(e.getMouseDownPosition()))
 			{
 				SamplifyProperties::getInstance()->getAudioPlayer()->playSample();
@@ -217,6 +224,8 @@ void SampleTile::mouseUp(const MouseEvent& e)
 				float mouseDownX = e.getMouseDownX();
 				SamplifyProperties::getInstance()->getAudioPlayer()->loadFile(mSample);
 				SamplifyProperties::getInstance()->getAudioPlayer()->playSample(mouseDownX / rectWidth);
+				if (SampleContainer* container = findParentComponentOfClass<SampleContainer>())
+					container->preloadNeighbours(mSample);
 			}
 			/*
 			else if (m_TitleRect.contains(e.getMouseDownPosition().toFloat()) && e.mods.isLeftButtonDown())
@@ -237,22 +246,39 @@ void SampleTile::mouseUp(const MouseEvent& e)
 				menu.addSeparator();
 				menu.addItem((int)RightClickOptions::renameSample, "Rename", true, false);
 				menu.addItem((int)RightClickOptions::deleteSample, "Move To Trash", true, false);
+				menu.addSeparator();
+				menu.addItem((int)RightClickOptions::addTriggerKeyAtStart, "Add To Drum Rack", true, false);
+				menu.addItem((int)RightClickOptions::playChromatically, "Play Chromatically", true, false);
+				menu.addItem((int)RightClickOptions::findSimilar, "Find Similar Sounds", true, false);
 
 				auto sampleFile = mSample.getFile();
-				menu.showMenuAsync(PopupMenu::Options(), [this, sampleFile](int selection)
+				Sample::Reference sample = mSample; //the tile may be showing another sample by the time this returns
+				menu.showMenuAsync(PopupMenu::Options(), [this, sampleFile, sample](int selection)
 				{
 					if (selection == (int)RightClickOptions::openExplorer)
 					{
 						sampleFile.revealToUser();
 					}
+					else if (selection == (int)RightClickOptions::addTriggerKeyAtStart)
+					{
+						SamplifyProperties::getInstance()->getAudioPlayer()->assignToDrumRack(sample);
+					}
+					else if (selection == (int)RightClickOptions::playChromatically)
+					{
+						SamplifyProperties::getInstance()->getAudioPlayer()->setChromaticSample(sample);
+					}
+					else if (selection == (int)RightClickOptions::findSimilar)
+					{
+						SamplifyProperties::getInstance()->getSampleLibrary()->showSimilarSamples(sample);
+					}
 					else if (selection == (int)RightClickOptions::renameSample)
 					{
 						mFileChooser = std::make_unique<FileChooser>("rename file", sampleFile);
 						mFileChooser->launchAsync(FileBrowserComponent::saveMode | FileBrowserComponent::canSelectFiles,
-							[this, sampleFile](const FileChooser& fc)
+							[this, sample](const FileChooser& fc)
 							{
 								auto result = fc.getResult();
-								if (result != File() && sampleFile.moveFileTo(result))
+								if (result != File() && !sample.isNull() && sample.moveFile(result))
 								{
 									SamplifyProperties::getInstance()->getSampleLibrary()->refreshCurrentSamples();
 								}
@@ -44,7 +44,9 @@ namespace samplore
 			renameSample,
 			deleteSample,
 			addTriggerKeyAtStart,
-			addTriggerKeyAtCue
+			addTriggerKeyAtCue,
+			playChromatically,
+			findSimilar
 		};
 
 		//===========================================================================
@@ -0,0 +1,371 @@
+#include "SamplerEngine.h"
+
+#include <cmath>
+
+using namespace samplore;
+
+namespace
+{
+	/// 4 point, 3rd order Hermite between x0 and x1
+	inline float hermite(float xm1, float x0, float x1, float x2, float t)
+	{
+		const float c = (x1 - xm1) * 0.5f;
+		const float v = x0 - x1;
+		const float w = c + v;
+		const float a = w + v + (x2 - x0) * 0.5f;
+		const float b = w + a;
+		return (((a * t) - b) * t + c) * t + x0;
+	}
+
+	const float CHROMATIC_RELEASE_SECONDS = 0.05f;
+	const float STEAL_RELEASE_SECONDS = 0.004f;
+	const float ALL_NOTES_OFF_RELEASE_SECONDS = 0.01f;
+}
+
+SamplerEngine::SamplerEngine()
+{
+}
+
+SamplerEngine::~SamplerEngine()
+{
+	//the audio callback is detached by now, voices only borrow from mSounds
+}
+
+void SamplerEngine::setPadSound(int pad, std::shared_ptr<const DecodedAudio> audio)
+{
+	jassert(pad >= 0 && pad < NUM_PADS);
+	if (pad >= 0 && pad < NUM_PADS)
+	{
+		setSound(pad, audio);
+	}
+}
+
+void SamplerEngine::setChromaticSound(std::shared_ptr<const DecodedAudio> audio)
+{
+	setSound(CHROMATIC_SLOT, audio);
+}
+
+void SamplerEngine::setSound(int slot, std::shared_ptr<const DecodedAudio> audio)
+{
+	const ScopedLock sl(mWriteLock);
+	collectGarbage();
+	std::unique_ptr<Sound> sound;
+	if (audio != nullptr && audio->mBuffer.getNumSamples() > 0 && audio->mBuffer.getNumChannels() > 0)
+	{
+		sound = std::make_unique<Sound>();
+		sound->mAudio = audio;
+	}
+	Event event;
+	event.mType = Event::Type::SetSound;
+	event.mSlot = slot;
+	event.mSound = sound.get();
+	if (!pushEvent(event))
+	{
+		return;
+	}
+	if (Sound* previous = mSlotMirror[slot])
+	{
+		previous->mReplacedAtEvent = mEventsPushed;
+	}
+	mSlotMirror[slot] = sound.get();
+	if (sound != nullptr)
+	{
+		mSounds.push_back(std::move(sound));
+	}
+	bool hasSounds = false;
+	for (Sound* assigned : mSlotMirror)
+	{
+		hasSounds |= assigned != nullptr;
+	}
+	mHasSounds = hasSounds;
+}
+
+void SamplerEngine::noteOn(int key, float velocity)
+{
+	Event event;
+	event.mType = Event::Type::NoteOn;
+	event.mKey = key;
+	event.mVelocity = jlimit(0.0f, 1.0f, velocity);
+	if (mMode == Mode::DrumRack)
+	{
+		if (key < 0 || key >= NUM_PADS)
+		{
+			return;
+		}
+		event.mSlot = key;
+	}
+	else
+	{
+		event.mSlot = CHROMATIC_SLOT;
+	}
+	const ScopedLock sl(mWriteLock);
+	pushEvent(event);
+}
+
+void SamplerEngine::noteOff(int key)
+{
+	if (mMode == Mode::DrumRack)
+	{
+		return; //one-shots ring out
+	}
+	Event event;
+	event.mType = Event::Type::NoteOff;
+	event.mKey = key;
+	event.mSlot = CHROMATIC_SLOT;
+	const ScopedLock sl(mWriteLock);
+	pushEvent(event);
+}
+
+void SamplerEngine::allNotesOff()
+{
+	Event event;
+	event.mType = Event::Type::AllNotesOff;
+	const ScopedLock sl(mWriteLock);
+	pushEvent(event);
+	collectGarbage();
+}
+
+void SamplerEngine::setMode(Mode mode)
+{
+	mMode = mode;
+}
+
+int SamplerEngine::claimNextPad()
+{
+	const ScopedLock sl(mWriteLock);
+	int pad = 0;
+	for (int i = 0; i < NUM_PADS; i++)
+	{
+		if (mPadClaimedAt[i] == 0)
+		{
+			pad = i;
+			break;
+		}
+		if (mPadClaimedAt[i] < mPadClaimedAt[pad])
+		{
+			pad = i;
+		}
+	}
+	mPadClaimedAt[pad] = ++mClaimCounter;
+	return pad;
+}
+
+bool SamplerEngine::pushEvent(const Event& event)
+{
+	const auto scope = mEventFifo.write(1);
+	if (scope.blockSize1 + scope.blockSize2 == 0)
+	{
+		return false; //no audio device, or the callback has stalled
+	}
+	scope.forEach([this, &event](int i) { mEvents[i] = event; });
+	mEventsPushed++;
+	return true;
+}
+
+void SamplerEngine::collectGarbage()
+{
+	const int handled = mEventsHandled.load();
+	mSounds.erase(std::remove_if(mSounds.begin(), mSounds.end(), [handled](const std::unique_ptr<Sound>& sound)
+	{
+		//the audio thread has stopped handing it out and no voice reads it any more
+		return sound->mReplacedAtEvent >= 0 && handled >= sound->mReplacedAtEvent && sound->mVoices.load() == 0;
+	}), mSounds.end());
+}
+
+void SamplerEngine::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+	mSampleRate = sampleRate > 0.0 ? sampleRate : 44100.0;
+	mScratch.setSize(2, jmax(samplesPerBlockExpected, 512));
+}
+
+void SamplerEngine::renderNextBlock(AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+	handleEvents();
+	const int chunkSize = mScratch.getNumSamples();
+	int active = 0;
+	for (Voice& voice : mVoices)
+	{
+		if (!voice.isActive())
+		{
+			continue;
+		}
+		for (int offset = 0; chunkSize > 0 && offset < numSamples && voice.isActive(); offset += chunkSize)
+		{
+			renderVoice(voice, buffer, startSample + offset, jmin(chunkSize, numSamples - offset));
+		}
+		if (voice.isActive())
+		{
+			active++;
+		}
+	}
+	mActiveVoiceCount = active;
+}
+
+void SamplerEngine::handleEvents()
+{
+	const auto scope = mEventFifo.read(mEventFifo.getNumReady());
+	scope.forEach([this](int i)
+	{
+		const Event& event = mEvents[i];
+		switch (event.mType)
+		{
+		case Event::Type::NoteOn:
+			startVoice(event.mSlot, event.mKey, event.mVelocity);
+			break;
+		case Event::Type::NoteOff:
+			for (Voice& voice : mVoices)
+			{
+				if (voice.isActive() && !voice.isReleasing() && voice.mSlot == event.mSlot && voice.mKey == event.mKey)
+					releaseVoice(voice, CHROMATIC_RELEASE_SECONDS);
+			}
+			break;
+		case Event::Type::AllNotesOff:
+			for (Voice& voice : mVoices)
+			{
+				if (voice.isActive())
+					releaseVoice(voice, ALL_NOTES_OFF_RELEASE_SECONDS);
+			}
+			break;
+		case Event::Type::SetSound:
+			//voices already playing the old sound keep it, its voice count holds it alive
+			mSlots[event.mSlot] = event.mSound;
+			break;
+		}
+		mEventsHandled++;
+	});
+}
+
+void SamplerEngine::startVoice(int slot, int key, float velocity)
+{
+	Sound* sound = mSlots[slot];
+	if (sound == nullptr)
+	{
+		return;
+	}
+	int sounding = 0;
+	Voice* oldest = nullptr;
+	for (Voice& voice : mVoices)
+	{
+		if (voice.isActive() && !voice.isReleasing())
+		{
+			sounding++;
+			if (oldest == nullptr || voice.mStartedAt < oldest->mStartedAt)
+				oldest = &voice;
+		}
+	}
+	if (sounding >= MAX_POLYPHONY && oldest != nullptr)
+	{
+		//fades out on one of the spare voices' time
+		releaseVoice(*oldest, STEAL_RELEASE_SECONDS);
+		mStolenVoiceCount++;
+	}
+	Voice* voice = findFreeVoice();
+	if (voice == nullptr)
+	{
+		//every spare is still fading, cut the quietest
+		for (Voice& candidate : mVoices)
+		{
+			if (voice == nullptr || candidate.mEnvelope < voice->mEnvelope)
+				voice = &candidate;
+		}
+		stopVoice(*voice);
+		mStolenVoiceCount++;
+	}
+
+	const DecodedAudio& audio = *sound->mAudio;
+	double increment = audio.mSampleRate > 0.0 ? audio.mSampleRate / mSampleRate : 1.0;
+	if (slot == CHROMATIC_SLOT && key != 0)
+	{
+		increment *= std::pow(2.0, key / 12.0);
+	}
+	sound->mVoices++;
+	voice->mSound = sound;
+	voice->mSlot = slot;
+	voice->mKey = key;
+	voice->mPosition = 0.0;
+	voice->mIncrement = increment;
+	voice->mVelocity = velocity;
+	voice->mEnvelope = 1.0f;
+	voice->mReleaseStep = 0.0f;
+	voice->mStartedAt = ++mVoiceCounter;
+}
+
+void SamplerEngine::releaseVoice(Voice& voice, float seconds)
+{
+	float step = 1.0f / jmax(1.0f, seconds * (float)mSampleRate);
+	voice.mReleaseStep = jmax(voice.mReleaseStep, step);
+}
+
+void SamplerEngine::stopVoice(Voice& voice)
+{
+	if (voice.mSound != nullptr)
+	{
+		voice.mSound->mVoices--; //last touch, the producer may free it from here on
+		voice.mSound = nullptr;
+	}
+	voice.mReleaseStep = 0.0f;
+}
+
+SamplerEngine::Voice* SamplerEngine::findFreeVoice()
+{
+	for (Voice& voice : mVoices)
+	{
+		if (!voice.isActive())
+			return &voice;
+	}
+	return nullptr;
+}
+
+void SamplerEngine::renderVoice(Voice& voice, AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+	const AudioBuffer<float>& source = voice.mSound->mAudio->mBuffer;
+	const int sourceLength = source.getNumSamples();
+	const int sourceChannels = jmin(source.getNumChannels(), mScratch.getNumChannels());
+	int produced = 0;
+	if (voice.mIncrement == 1.0)
+	{
+		//same rate, same pitch, a straight vector copy
+		const int position = (int)voice.mPosition;
+		produced = jlimit(0, numSamples, sourceLength - position);
+		//a sound that ended exactly on the last block leaves the position one past its last sample
+		for (int ch = 0; ch < sourceChannels && produced > 0; ch++)
+		{
+			FloatVectorOperations::copy(mScratch.getWritePointer(ch), source.getReadPointer(ch, position), produced);
+		}
+	}
+	else
+	{
+		const int last = sourceLength - 1;
+		produced = jlimit(0, numSamples, (int)std::floor((last - voice.mPosition) / voice.mIncrement) + 1);
+		for (int ch = 0; ch < sourceChannels; ch++)
+		{
+			const float* in = source.getReadPointer(ch);
+			float* out = mScratch.getWritePointer(ch);
+			double position = voice.mPosition;
+			for (int i = 0; i < produced; i++)
+			{
+				const int index = (int)position;
+				const float t = (float)(position - index);
+				out[i] = hermite(in[jmax(0, index - 1)], in[index], in[jmin(last, index + 1)], in[jmin(last, index + 2)], t);
+				position += voice.mIncrement;
+			}
+		}
+	}
+	voice.mPosition += produced * voice.mIncrement;
+
+	const float gain = voice.mVelocity * mGain.load();
+	const float startEnvelope = voice.mEnvelope;
+	const float endEnvelope = jmax(0.0f, startEnvelope - voice.mReleaseStep * produced);
+	for (int ch = 0; ch < buffer.getNumChannels() && produced > 0; ch++)
+	{
+		//mono sources feed every output channel
+		buffer.addFromWithRamp(ch, startSample, mScratch.getReadPointer(jmin(ch, sourceChannels - 1)), produced,
+			startEnvelope * gain, endEnvelope * gain);
+	}
+	voice.mEnvelope = endEnvelope;
+
+	if (produced < numSamples || (voice.isReleasing() && endEnvelope <= 0.0f))
+	{
+		stopVoice(voice);
+	}
+}
@@ -0,0 +1,148 @@
+/*
+  ==============================================================================
+
+    SamplerEngine.h
+    Author:  Jake Rose
+
+	Polyphonic one-shot sampler mixed in with the preview player. Either a
+	drum rack, where each pad plays its own sample, or a single sample played
+	chromatically. Voices are preallocated, the audio thread never allocates,
+	locks or frees.
+
+  ==============================================================================
+*/
+
+#ifndef SAMPLERENGINE_H
+#define SAMPLERENGINE_H
+
+#include "JuceHeader.h"
+
+#include "DecodedSampleCache.h"
+
+#include <array>
+
+namespace samplore
+{
+	class SamplerEngine
+	{
+	public:
+		enum class Mode
+		{
+			DrumRack,
+			Chromatic
+		};
+		static const int NUM_PADS = 16;
+		static const int MAX_POLYPHONY = 64;
+
+		SamplerEngine();
+		~SamplerEngine();
+
+		//=Any thread but the audio thread===========================
+		/// Puts audio on a drum pad, nullptr clears the pad
+		void setPadSound(int pad, std::shared_ptr<const DecodedAudio> audio);
+		/// The sample the chromatic keys transpose, unshifted on key 0
+		void setChromaticSound(std::shared_ptr<const DecodedAudio> audio);
+		/// In drum rack mode key is a pad, in chromatic mode semitones above the original pitch
+		void noteOn(int key, float velocity);
+		/// Drum pads always play to the end, chromatic notes fade out
+		void noteOff(int key);
+		void allNotesOff();
+
+		void setMode(Mode mode);
+		Mode getMode() const { return mMode; }
+		bool hasSounds() const { return mHasSounds; }
+		/// Reserves a pad for a sound still being decoded. The first pad nobody claimed yet,
+		/// or the least recently claimed one once the rack is full
+		int claimNextPad();
+		void setGain(float gain) { mGain = gain; }
+
+		//=Audio thread=============================================
+		void prepareToPlay(int samplesPerBlockExpected, double sampleRate);
+		/// Mixes every sounding voice into buffer
+		void renderNextBlock(AudioBuffer<float>& buffer, int startSample, int numSamples);
+
+		int getActiveVoiceCount() const { return mActiveVoiceCount; }
+		/// Voices cut short because the polyphony was used up
+		int getStolenVoiceCount() const { return mStolenVoiceCount; }
+	private:
+		static const int CHROMATIC_SLOT = NUM_PADS;
+		static const int NUM_SLOTS = NUM_PADS + 1;
+		static const int NUM_VOICES = MAX_POLYPHONY + 16; //spares let stolen voices fade instead of click
+		static const int EVENT_QUEUE_SIZE = 256;
+
+		/// Owned by the producer side, the audio thread only borrows the pointer
+		struct Sound
+		{
+			std::shared_ptr<const DecodedAudio> mAudio;
+			std::atomic<int> mVoices { 0 }; //audio thread voices still reading mAudio
+			int mReplacedAtEvent = -1; //free once the audio thread has handled this many events
+		};
+
+		struct Event
+		{
+			enum class Type { NoteOn, NoteOff, AllNotesOff, SetSound };
+			Type mType = Type::NoteOff;
+			int mSlot = 0;
+			int mKey = 0;
+			float mVelocity = 0.0f;
+			Sound* mSound = nullptr;
+		};
+
+		struct Voice
+		{
+			Sound* mSound = nullptr;
+			int mKey = -1;
+			int mSlot = -1;
+			double mPosition = 0.0;
+			double mIncrement = 1.0;
+			float mVelocity = 1.0f;
+			float mEnvelope = 1.0f;
+			float mReleaseStep = 0.0f; //per sample, zero while sustaining
+			uint32 mStartedAt = 0;
+
+			bool isActive() const { return mSound != nullptr; }
+			bool isReleasing() const { return mReleaseStep > 0.0f; }
+		};
+
+		void setSound(int slot, std::shared_ptr<const DecodedAudio> audio);
+		bool pushEvent(const Event& event);
+		void collectGarbage();
+
+		void handleEvents();
+		void startVoice(int slot, int key, float velocity);
+		void releaseVoice(Voice& voice, float seconds);
+		void stopVoice(Voice& voice);
+		Voice* findFreeVoice();
+		void renderVoice(Voice& voice, AudioBuffer<float>& buffer, int startSample, int numSamples);
+
+		//Producers, serialised by mWriteLock
+		CriticalSection mWriteLock;
+		std::vector<std::unique_ptr<Sound>> mSounds; //assigned and retired
+		std::array<Sound*, NUM_SLOTS> mSlotMirror {}; //what the audio thread will see once it catches up
+		std::array<uint32, NUM_PADS> mPadClaimedAt {}; //zero while unclaimed
+		uint32 mClaimCounter = 0;
+		int mEventsPushed = 0;
+		std::atomic<Mode> mMode { Mode::DrumRack };
+		std::atomic<bool> mHasSounds { false };
+		std::atomic<float> mGain { 1.0f };
+
+		//Producers -> audio thread
+		AbstractFifo mEventFifo { EVENT_QUEUE_SIZE };
+		std::array<Event, EVENT_QUEUE_SIZE> mEvents;
+		std::atomic<int> mEventsHandled { 0 };
+
+		//Audio thread only
+		std::array<Sound*, NUM_SLOTS> mSlots {};
+		std::array<Voice, NUM_VOICES> mVoices;
+		AudioBuffer<float> mScratch;
+		double mSampleRate = 44100.0;
+		uint32 mVoiceCounter = 0;
+
+		//Audio thread -> everyone
+		std::atomic<int> mActiveVoiceCount { 0 };
+		std::atomic<int> mStolenVoiceCount { 0 };
+
+		JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SamplerEngine)
+	};
+}
+#endif
@@ -34,6 +34,7 @@ namespace samplore
 		float SAMPLE_TILE_MIN_WIDTH = 150.0f;
 		float SAMPLE_TILE_ASPECT_RATIO = 0.666f;
 		float SAMPLE_TILE_CONTAINER_ITEM_PADDING = 2.0f;
+		float SAMPLE_CONTAINER_SECTION_HEADING_HEIGHT = 28.0f; //above each group of grouped results
 		float SAMPLE_TILE_CORNER_RADIUS = 8.0f;
 		float SAMPLE_TILE_OUTLINE_THICKNESS = 2.0f;
 
@@ -49,6 +50,17 @@ namespace samplore
 
 		bool RIGHTCLICKPLAYFROMPOINT = true;
 
+		int SEARCH_DEBOUNCE_MS = 150; //wait for typing to pause before querying
+
+		//Audio Preview
+		int PREVIEW_READ_AHEAD_SAMPLES = 32768; //decoded ahead of the audio thread on the read-ahead thread
+		int PREVIEW_PRELOAD_NEIGHBOURS = 2; //samples either side of the clicked tile opened ahead of time
+		int PREVIEW_DECODED_CACHE_MB = 256; //RAM for fully decoded one-shots
+		float PREVIEW_DECODED_CACHE_MAX_SECONDS = 10.0f; //longer samples always stream
+		int PREVIEW_ATTACK_PREFIX_MS = 150; //decoded start of longer samples kept on disk
+		int PREVIEW_ATTACK_PREFIX_DISK_MB = 512;
+		bool PREVIEW_ADAPTIVE_QUALITY = true; //cheaper resampling while the audio callback is short of time
+
 		Drawable* getDrawable(String id);
 		void loadDrawables();
 		void updateDrawablesColors();
@@ -1,10 +1,13 @@
 #include "SamplifyMainComponent.h"
+#include "Diagnostics.h"
 #include "SamplifyLookAndFeel.h"
 #include "ThemeManager.h"
 
 using namespace samplore;
 
 SamplifyMainComponent* SamplifyMainComponent::mInstance = nullptr;
+//drum pads bottom row first like an MPC, in chromatic mode semitones up from the original pitch
+const char* const samplerKeys = "zxcvasdfqwer1234";
 
 SamplifyMainComponent::SamplifyMainComponent() : 
 	mResizableEdgeDirectoryExplorer(&mDirectoryExplorer, &mResizableEdgeDirectoryExplorerBounds, ResizableEdgeComponent::Edge::rightEdge),
@@ -79,6 +82,22 @@ SamplifyMainComponent::~SamplifyMainComponent()
 bool SamplifyMainComponent::keyPressed(const KeyPress& key, Component* originatingComponent)
 {
 	auto& keyManager = KeyBindingManager::getInstance();
+
+	if (mAudioPlayer != nullptr && mAudioPlayer->getSampler().hasSounds())
+	{
+		for (int i = 0; i < SamplerEngine::NUM_PADS; i++)
+		{
+			if (KeyPress(samplerKeys[i]) == key)
+			{
+				if (!mHeldSamplerKeys[i])
+				{
+					mHeldSamplerKeys[i] = true;
+					mAudioPlayer->getSampler().noteOn(i, 1.0f);
+				}
+				return true;
+			}
+		}
+	}
 	
 	if (keyManager.matchesAction(key, KeyBindingManager::Action::PlayAudio))
 	{
@@ -121,10 +140,33 @@ bool SamplifyMainComponent::keyPressed(const KeyPress& key, Component* originati
 		JUCEApplication::getInstance()->systemRequestedQuit();
 		return true;
 	}
+	else if (keyManager.matchesAction(key, KeyBindingManager::Action::FindSimilar))
+	{
+		Sample::Reference sample = SamplifyProperties::getInstance()->getAudioPlayer()->getSampleReference();
+		if (!sample.isNull())
+		{
+			SamplifyProperties::getInstance()->getSampleLibrary()->showSimilarSamples(sample);
+		}
+		return true;
+	}
 	
 	return false;
 }
 
+bool SamplifyMainComponent::keyStateChanged(bool isKeyDown, Component* originatingComponent)
+{
+	for (int i = 0; i < SamplerEngine::NUM_PADS; i++)
+	{
+		if (mHeldSamplerKeys[i] && !KeyPress::isKeyCurrentlyDown(KeyPress(samplerKeys[i]).getKeyCode()))
+		{
+			mHeldSamplerKeys[i] = false;
+			if (mAudioPlayer != nullptr)
+				mAudioPlayer->getSampler().noteOff(i);
+		}
+	}
+	return false;
+}
+
 void SamplifyMainComponent::changeListenerCallback(ChangeBroadcaster* source)
 {
 	SamplifyProperties::getInstance()->savePropertiesFile();
@@ -224,6 +266,7 @@ void samplore::SamplifyMainComponent::setupLookAndFeel(LookAndFeel& laf)
 //==============================================================================
 void SamplifyMainComponent::paint (Graphics& g)
 {
+    Diagnostics::PaintScope paintScope(Diagnostics::PaintClass::SamplifyMainComponent);
     g.fillAll (getLookAndFeel().findColour(ResizableWindow::backgroundColourId));
 }
 const int edgeSize = 8;
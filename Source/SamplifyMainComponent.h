@@ -34,6 +34,7 @@ namespace samplore
 		~SamplifyMainComponent();
 
 		bool keyPressed(const KeyPress& key, Component* originatingComponent);
+		bool keyStateChanged(bool isKeyDown, Component* originatingComponent) override;
 		void changeListenerCallback(ChangeBroadcaster* source);
 		void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
 		void getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) override;
@@ -74,6 +75,8 @@ namespace samplore
 		ComponentBoundsConstrainer mResizableEdgeAudioPlayerBounds;
 
 		std::shared_ptr<AudioPlayer> mAudioPlayer;
+		/// Sampler keys currently held, so auto-repeat doesn't retrigger and release can note off
+		std::array<bool, SamplerEngine::NUM_PADS> mHeldSamplerKeys {};
 		juce::SharedResourcePointer<TooltipWindow> mTooltip;
 
 		static SamplifyMainComponent* mInstance;
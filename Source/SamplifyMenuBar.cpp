@@ -3,6 +3,7 @@
 #include "PreferenceWindow.h"
 #include "InfoWindow.h"
 #include "SamplifyMainComponent.h"
+#include "Tracer.h"
 
 using namespace samplore;
 
@@ -28,6 +29,10 @@ void SamplifyMainMenu::menuItemSelected(int menuItemID, int topLevelMenuIndex)
 	{
 		SamplifyProperties::getInstance()->getSampleLibrary()->refreshDirectories();
 	}
+	else if (menuItemID == findDuplicates)
+	{
+		SamplifyProperties::getInstance()->getSampleLibrary()->showDuplicateSamples();
+	}
 	else if (menuItemID == setVolume)
 	{
 		mVolumeWindow = std::make_unique<AlertWindow>("Set Gain", "", MessageBoxIconType::NoIcon);
@@ -75,6 +80,29 @@ void SamplifyMainMenu::menuItemSelected(int menuItemID, int topLevelMenuIndex)
 	{
 		URL("www.samplify.app").launchInDefaultBrowser();
 	}
+	else if (menuItemID == viewDiagnostics)
+	{
+		if (mDiagnosticsWindow == nullptr)
+		{
+			mDiagnosticsWindow = std::make_unique<DiagnosticsWindow>();
+		}
+		mDiagnosticsWindow->setVisible(true);
+		mDiagnosticsWindow->toFront(true);
+	}
+	else if (menuItemID == toggleTrace)
+	{
+		if (!Tracer::isEnabled())
+		{
+			Tracer::start();
+			Tracer::setThreadName("Message");
+		}
+		else
+		{
+			const File file = Tracer::getDefaultFile();
+			if (Tracer::stop(file))
+				file.revealToUser(); //open it at ui.perfetto.dev
+		}
+	}
 
 }
 
@@ -84,6 +112,7 @@ PopupMenu SamplifyMainMenu::getMenuForIndex(int menuIndex, const String& menuNam
 	if (menuIndex == 0) //File
 	{
 		menu.addItem(refreshDirectories, "Refresh Directories", true, false);
+		menu.addItem(findDuplicates, "Find Duplicate Samples", true, false);
 		menu.addSeparator();
 		menu.addItem(setPreferences, "Preferences", true, false);
 		menu.addItem(exitApplication, "Exit Application", true, false);
@@ -99,6 +128,9 @@ PopupMenu SamplifyMainMenu::getMenuForIndex(int menuIndex, const String& menuNam
 	{
 		menu.addItem(viewInformation, "View Information", true, false);
 		menu.addItem(visitWebsite, "Visit Website", true, false);
+		menu.addSeparator();
+		menu.addItem(viewDiagnostics, "Performance Diagnostics", true, false);
+		menu.addItem(toggleTrace, "Record Performance Trace", true, Tracer::isEnabled());
 	}
 	//menu.addSeparator();
 	return menu;
@@ -16,6 +16,7 @@
 
 #include "JuceHeader.h"
 #include "ThemeManager.h"
+#include "DiagnosticsWindow.h"
 
 namespace samplore
 {
@@ -42,7 +43,10 @@ namespace samplore
 			setVolume,
 			exitApplication,
 			viewInformation,
-			visitWebsite
+			visitWebsite,
+			findDuplicates,
+			toggleTrace,
+			viewDiagnostics
 		};
 
 		SamplifyMainMenu();
@@ -60,6 +64,7 @@ namespace samplore
 
 	private:
 		std::unique_ptr<AlertWindow> mVolumeWindow;
+		std::unique_ptr<DiagnosticsWindow> mDiagnosticsWindow;
 	};
 }
 #endif
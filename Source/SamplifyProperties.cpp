@@ -7,6 +7,11 @@ using namespace samplore;
 SamplifyProperties* SamplifyProperties::smAppProperties = nullptr;
 
 SamplifyProperties::SamplifyProperties()
+{
+	setStorageParameters(getSettingsOptions());
+}
+
+PropertiesFile::Options SamplifyProperties::getSettingsOptions()
 {
 	PropertiesFile::Options propFileOptions = PropertiesFile::Options();
 	propFileOptions.applicationName = "SamplifyPlus";
@@ -15,7 +20,7 @@ SamplifyProperties::SamplifyProperties()
     propFileOptions.osxLibrarySubFolder = "Application Support/SamplifyPlus";
 	propFileOptions.ignoreCaseOfKeyNames = true;
 	propFileOptions.storageFormat = PropertiesFile::StorageFormat::storeAsXML;
-	setStorageParameters(propFileOptions);
+	return propFileOptions;
 }
 
 SamplifyProperties::~SamplifyProperties()
@@ -122,6 +127,12 @@ void SamplifyProperties::loadPropertiesFile()
 		AppValues::getInstance().SAMPLE_TILE_MIN_WIDTH = (float)propFile->getDoubleValue("SAMPLE_TILE_MIN_WIDTH", 120);
 		AppValues::getInstance().AUDIO_THUMBNAIL_LINE_COUNT = (float)propFile->getDoubleValue("AUDIO_THUMBNAIL_LINE_COUNT", 50);
 		AppValues::getInstance().AUDIO_THUMBNAIL_LINE_COUNT_PLAYER = (float)propFile->getDoubleValue("AUDIO_THUMBNAIL_LINE_COUNT_PLAYER", 120);
+		AppValues::getInstance().PREVIEW_READ_AHEAD_SAMPLES = propFile->getIntValue("PREVIEW_READ_AHEAD_SAMPLES", 32768);
+		AppValues::getInstance().PREVIEW_DECODED_CACHE_MB = propFile->getIntValue("PREVIEW_DECODED_CACHE_MB", 256);
+		AppValues::getInstance().PREVIEW_DECODED_CACHE_MAX_SECONDS = (float)propFile->getDoubleValue("PREVIEW_DECODED_CACHE_MAX_SECONDS", 10.0);
+		AppValues::getInstance().PREVIEW_ATTACK_PREFIX_MS = propFile->getIntValue("PREVIEW_ATTACK_PREFIX_MS", 150);
+		AppValues::getInstance().PREVIEW_ATTACK_PREFIX_DISK_MB = propFile->getIntValue("PREVIEW_ATTACK_PREFIX_DISK_MB", 512);
+		AppValues::getInstance().PREVIEW_ADAPTIVE_QUALITY = propFile->getBoolValue("PREVIEW_ADAPTIVE_QUALITY", true);
 		AppValues::getInstance().updateDrawablesColors();
 	}
 	else
@@ -145,7 +156,7 @@ void SamplifyProperties::savePropertiesFile()
 	{
 		propFile->clear();
 		//Save Dirs
-		std::vector<std::shared_ptr<SampleDirectory>> dirs = mSampleLibrary->getDirectories();
+		const std::vector<std::shared_ptr<SampleDirectory>>& dirs = mSampleLibrary->getDirectories();
 		propFile->setValue("directory count", (int)dirs.size());
 		for (int i = 0; i < dirs.size(); i++)
 		{
@@ -171,6 +182,12 @@ void SamplifyProperties::savePropertiesFile()
 		propFile->setValue("SAMPLE_TILE_MIN_WIDTH", AppValues::getInstance().SAMPLE_TILE_MIN_WIDTH);
 		propFile->setValue("AUDIO_THUMBNAIL_LINE_COUNT_PLAYER", AppValues::getInstance().AUDIO_THUMBNAIL_LINE_COUNT_PLAYER);
 		propFile->setValue("AUDIO_THUMBNAIL_LINE_COUNT", AppValues::getInstance().AUDIO_THUMBNAIL_LINE_COUNT);
+		propFile->setValue("PREVIEW_READ_AHEAD_SAMPLES", AppValues::getInstance().PREVIEW_READ_AHEAD_SAMPLES);
+		propFile->setValue("PREVIEW_DECODED_CACHE_MB", AppValues::getInstance().PREVIEW_DECODED_CACHE_MB);
+		propFile->setValue("PREVIEW_DECODED_CACHE_MAX_SECONDS", AppValues::getInstance().PREVIEW_DECODED_CACHE_MAX_SECONDS);
+		propFile->setValue("PREVIEW_ATTACK_PREFIX_MS", AppValues::getInstance().PREVIEW_ATTACK_PREFIX_MS);
+		propFile->setValue("PREVIEW_ATTACK_PREFIX_DISK_MB", AppValues::getInstance().PREVIEW_ATTACK_PREFIX_DISK_MB);
+		propFile->setValue("PREVIEW_ADAPTIVE_QUALITY", AppValues::getInstance().PREVIEW_ADAPTIVE_QUALITY);
 	}
 	else
 	{
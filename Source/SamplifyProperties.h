@@ -30,6 +30,8 @@ namespace samplore
 		void init();
 		void cleanup();
 		//=Saving=================================================
+		/// Where the settings live, also read by the command line without an instance
+		static PropertiesFile::Options getSettingsOptions();
 		void loadPropertiesFile();
 		void savePropertiesFile();
 
@@ -5,6 +5,11 @@
     Created: 18 Jun 2020 10:29:09am
     Author:  jacob
 
+	Parsed form of the search bar text. Words are matched as one substring
+	against the file path and tags, words starting with # must match a tag.
+	bpm:120 or bpm:110-130 keeps loops analysed within that tempo, key:Am or
+	key:8A samples analysed in that key.
+
   ==============================================================================
 */
 
@@ -12,11 +17,112 @@
 #define SEARCHFILTER_H
 #include "JuceHeader.h"
 
+#include "MusicalKey.h"
+
 struct SearchFilter
 {
 public:
 	String mQuery;
 	StringArray mTags;
+	float mMinTempo = 0.0f; //both zero when tempo is not filtered
+	float mMaxTempo = 0.0f;
+	int mKey = MusicalKey::UNKNOWN; //any key
+
+	static SearchFilter fromQuery(const String& query)
+	{
+		SearchFilter filter;
+		StringArray words;
+		words.addTokens(query, " ", "\"");
+		StringArray textWords;
+		for (int i = 0; i < words.size(); i++)
+		{
+			String word = words[i].unquoted();
+			if (word.startsWithChar('#') && word.length() > 1)
+				filter.mTags.addIfNotAlreadyThere(word.substring(1), true);
+			else if (word.startsWithIgnoreCase("bpm:") && word.length() > 4)
+				filter.parseTempo(word.substring(4));
+			else if (word.startsWithIgnoreCase("key:") && MusicalKey::isKey(MusicalKey::fromName(word.substring(4))))
+				filter.mKey = MusicalKey::fromName(word.substring(4));
+			else if (word.isNotEmpty())
+				textWords.add(word);
+		}
+		filter.mQuery = textWords.joinIntoString(" ");
+		return filter;
+	}
+
+	bool isEmpty() const { return mQuery.isEmpty() && mTags.isEmpty() && !usesAnalysis(); }
+	bool hasTempoRange() const { return mMaxTempo > 0.0f; }
+	bool hasKey() const { return mKey != MusicalKey::UNKNOWN; }
+	/// Results change as the background analysis fills in samples
+	bool usesAnalysis() const { return hasTempoRange() || hasKey(); }
+
+	/// tempo is negative and key UNKNOWN until analysed, which never match a tempo or key filter
+	bool matches(const String& path, const StringArray& tags, float tempo = -1.0f, int key = MusicalKey::UNKNOWN) const
+	{
+		if (hasTempoRange() && (tempo < mMinTempo || tempo > mMaxTempo))
+			return false;
+		if (hasKey() && key != mKey)
+			return false;
+		for (int i = 0; i < mTags.size(); i++)
+		{
+			if (!tags.contains(mTags[i], true))
+				return false;
+		}
+		if (mQuery.isEmpty() || path.containsIgnoreCase(mQuery))
+			return true;
+		for (int i = 0; i < tags.size(); i++)
+		{
+			if (tags[i].containsIgnoreCase(mQuery))
+				return true;
+		}
+		return false;
+	}
+
+	/// True if every sample matching this filter also matches base,
+	/// meaning the results of base can be filtered instead of the whole library
+	bool isRefinementOf(const SearchFilter& base) const
+	{
+		if (!mQuery.containsIgnoreCase(base.mQuery))
+			return false;
+		if (base.hasTempoRange() && (!hasTempoRange() || mMinTempo < base.mMinTempo || mMaxTempo > base.mMaxTempo))
+			return false;
+		if (base.hasKey() && mKey != base.mKey)
+			return false;
+		for (int i = 0; i < base.mTags.size(); i++)
+		{
+			if (!mTags.contains(base.mTags[i], true))
+				return false;
+		}
+		return true;
+	}
+
+	bool operator==(const SearchFilter& other) const
+	{
+		if (!mQuery.equalsIgnoreCase(other.mQuery) || mTags.size() != other.mTags.size()
+			|| mMinTempo != other.mMinTempo || mMaxTempo != other.mMaxTempo || mKey != other.mKey)
+			return false;
+		return isRefinementOf(other);
+	}
+
+private:
+	/// "120" allows a little either side for rounding, "110-130" is inclusive
+	void parseTempo(const String& text)
+	{
+		float low = text.upToFirstOccurrenceOf("-", false, false).getFloatValue();
+		float high = text.containsChar('-') ? text.fromFirstOccurrenceOf("-", false, false).getFloatValue() : low;
+		if (!text.containsChar('-'))
+		{
+			low -= 1.0f;
+			high += 1.0f;
+		}
+		if (low > high)
+			std::swap(low, high);
+		if (high > 0.0f)
+		{
+			mMinTempo = jmax(1.0f, low); //zero is a one-shot, not a slow loop
+			mMaxTempo = high;
+		}
+	}
 };
 
 #endif
@@ -0,0 +1,315 @@
+#include "SimilarityIndex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+using namespace samplore;
+
+SimilarityIndex::SimilarityIndex(std::shared_ptr<const DescriptorTable> table, bool buildGraph, const std::function<bool()>& shouldStop)
+	: mTable(table)
+{
+	if (!buildGraph)
+	{
+		return;
+	}
+	const int rows = mTable->size();
+	mBaseLinks.resize((size_t)rows);
+	VisitedSet visited(rows);
+	Random random(0x5eed); //same table, same graph
+	const double levelScale = 1.0 / std::log((double)LINKS);
+	for (int row = 0; row < rows; row++)
+	{
+		if (shouldStop != nullptr && (row & 1023) == 0 && shouldStop())
+		{
+			mEntryPoint = -1;
+			mTopLevel = -1;
+			mBaseLinks.clear();
+			mUpperLinks.clear();
+			return;
+		}
+		if (mTable->hasRow(row))
+		{
+			const int level = jmin(16, (int)(-std::log(jmax(1.0e-9, (double)random.nextDouble())) * levelScale));
+			insert(row, level, visited);
+		}
+	}
+}
+
+std::vector<SimilarityIndex::Match> SimilarityIndex::search(const int8* query, int count, const std::function<bool(int)>& accept) const
+{
+	if (count <= 0)
+	{
+		return {};
+	}
+	return hasGraph() ? searchGraph(query, count, accept) : searchAll(query, count, accept);
+}
+
+std::vector<SimilarityIndex::Match> SimilarityIndex::searchAll(const int8* query, int count, const std::function<bool(int)>& accept) const
+{
+	//bounded max-heap, the root is the worst match kept so far
+	std::priority_queue<Match> best;
+	for (int row = 0; row < mTable->size(); row++)
+	{
+		if (!mTable->hasRow(row))
+		{
+			continue;
+		}
+		const int distance = getDistance(query, getRow(row));
+		if ((int)best.size() == count && distance >= best.top().mDistance)
+		{
+			continue;
+		}
+		if (!accept(row))
+		{
+			continue;
+		}
+		best.push({ row, distance });
+		if ((int)best.size() > count)
+		{
+			best.pop();
+		}
+	}
+	std::vector<Match> matches;
+	matches.reserve(best.size());
+	for (; !best.empty(); best.pop())
+	{
+		matches.push_back(best.top());
+	}
+	std::reverse(matches.begin(), matches.end());
+	return matches;
+}
+
+std::vector<SimilarityIndex::Match> SimilarityIndex::searchGraph(const int8* query, int count, const std::function<bool(int)>& accept) const
+{
+	VisitedSet visited(mTable->size());
+	int entry = mEntryPoint;
+	for (int level = mTopLevel; level > 0; level--)
+	{
+		visited.clear();
+		entry = searchLevel(query, entry, 1, level, visited).front().mRow;
+	}
+	//rejected rows still guide the walk, widen it until enough of the rows found are accepted
+	const int filled = mTable->getFilledCount();
+	for (int ef = jmax(EF_SEARCH, count * 2);; ef *= 2)
+	{
+		if (ef > filled / 4)
+		{
+			return searchAll(query, count, accept); //most rows rejected, a scan costs less than walking that wide
+		}
+		visited.clear();
+		std::vector<Match> candidates = searchLevel(query, entry, ef, 0, visited);
+		std::vector<Match> matches;
+		for (const Match& match : candidates)
+		{
+			if ((int)matches.size() == count)
+				break;
+			if (accept(match.mRow))
+				matches.push_back(match);
+		}
+		if ((int)matches.size() == count || (int)candidates.size() < ef)
+		{
+			return matches; //enough, or every reachable row has been seen
+		}
+	}
+}
+
+void SimilarityIndex::insert(int row, int level, VisitedSet& visited)
+{
+	if (mEntryPoint < 0)
+	{
+		mEntryPoint = row;
+		mTopLevel = level;
+		if (level > 0)
+			mUpperLinks[row].resize((size_t)level);
+		return;
+	}
+	if (level > 0)
+	{
+		mUpperLinks[row].resize((size_t)level);
+	}
+	const int8* query = getRow(row);
+	int entry = mEntryPoint;
+	for (int current = mTopLevel; current > level; current--)
+	{
+		visited.clear();
+		entry = searchLevel(query, entry, 1, current, visited).front().mRow;
+	}
+	for (int current = jmin(level, mTopLevel); current >= 0; current--)
+	{
+		visited.clear();
+		std::vector<Match> candidates = searchLevel(query, entry, EF_CONSTRUCTION, current, visited);
+		const int maxLinks = current == 0 ? LINKS * 2 : LINKS;
+		std::vector<int>& links = getLinks(row, current);
+		links = selectNeighbours(candidates, LINKS);
+		for (int neighbour : links)
+		{
+			std::vector<int>& back = getLinks(neighbour, current);
+			back.push_back(row);
+			if ((int)back.size() > maxLinks)
+			{
+				std::vector<Match> pool;
+				pool.reserve(back.size());
+				for (int other : back)
+					pool.push_back({ other, getDistance(getRow(neighbour), getRow(other)) });
+				std::sort(pool.begin(), pool.end());
+				back = selectNeighbours(pool, maxLinks);
+			}
+		}
+		entry = candidates.front().mRow;
+	}
+	if (level > mTopLevel)
+	{
+		mTopLevel = level;
+		mEntryPoint = row;
+	}
+}
+
+std::vector<SimilarityIndex::Match> SimilarityIndex::searchLevel(const int8* query, int entry, int ef, int level, VisitedSet& visited) const
+{
+	auto further = [](const Match& a, const Match& b) { return a.mDistance > b.mDistance; };
+	std::priority_queue<Match, std::vector<Match>, decltype(further)> toVisit(further); //nearest on top
+	std::priority_queue<Match> found; //furthest on top
+	const Match start { entry, getDistance(query, getRow(entry)) };
+	visited.visit(entry);
+	toVisit.push(start);
+	found.push(start);
+	while (!toVisit.empty())
+	{
+		const Match current = toVisit.top();
+		if (current.mDistance > found.top().mDistance)
+		{
+			break; //everything left is further than the worst kept
+		}
+		toVisit.pop();
+		for (int neighbour : getLinks(current.mRow, level))
+		{
+			if (!visited.visit(neighbour))
+			{
+				continue;
+			}
+			const int distance = getDistance(query, getRow(neighbour));
+			if ((int)found.size() < ef || distance < found.top().mDistance)
+			{
+				toVisit.push({ neighbour, distance });
+				found.push({ neighbour, distance });
+				if ((int)found.size() > ef)
+					found.pop();
+			}
+		}
+	}
+	std::vector<Match> nearest;
+	nearest.reserve(found.size());
+	for (; !found.empty(); found.pop())
+	{
+		nearest.push_back(found.top());
+	}
+	std::reverse(nearest.begin(), nearest.end());
+	return nearest;
+}
+
+std::vector<int> SimilarityIndex::selectNeighbours(const std::vector<Match>& candidates, int maxCount) const
+{
+	std::vector<int> selected;
+	std::vector<int> skipped;
+	for (const Match& candidate : candidates)
+	{
+		if ((int)selected.size() == maxCount)
+			break;
+		bool diverse = true;
+		for (int kept : selected)
+		{
+			if (getDistance(getRow(candidate.mRow), getRow(kept)) < candidate.mDistance)
+			{
+				diverse = false;
+				break;
+			}
+		}
+		(diverse ? selected : skipped).push_back(candidate.mRow);
+	}
+	//a full list keeps the graph connected in dense clusters
+	for (int i = 0; i < (int)skipped.size() && (int)selected.size() < maxCount; i++)
+	{
+		selected.push_back(skipped[i]);
+	}
+	return selected;
+}
+
+std::vector<int>& SimilarityIndex::getLinks(int row, int level)
+{
+	return level == 0 ? mBaseLinks[row] : mUpperLinks[row][level - 1];
+}
+
+const std::vector<int>& SimilarityIndex::getLinks(int row, int level) const
+{
+	return level == 0 ? mBaseLinks[row] : mUpperLinks.at(row)[level - 1];
+}
+
+SimilarityFinder::SimilarityFinder() : mBuildPool(1, 0, Thread::Priority::background)
+{
+}
+
+SimilarityFinder::~SimilarityFinder()
+{
+	mBuildPool.removeAllJobs(true, 5000);
+}
+
+Sample::List SimilarityFinder::findSimilar(const SampleDescriptor& query, std::shared_ptr<const DescriptorTable> table,
+	std::shared_ptr<const LibrarySnapshot> enabled, int count, const File& exclude)
+{
+	Sample::List list;
+	if (table == nullptr)
+	{
+		return list;
+	}
+	std::shared_ptr<const SimilarityIndex> index = getIndex(table);
+	const LibrarySnapshot& snapshot = *index->getTable()->getSnapshot();
+	//checks change without a new table, take them from the caller's snapshot when its rows are the same
+	const BigInteger& checked = enabled != nullptr && enabled->mSamples == snapshot.mSamples ? enabled->mEnabled : snapshot.mEnabled;
+	auto accept = [&snapshot, &checked, &exclude](int row)
+	{
+		return checked[row] && snapshot.getRow(row)->getRecord()->mFile != exclude;
+	};
+	for (const SimilarityIndex::Match& match : index->search(query.mValues.data(), count, accept))
+	{
+		list.addSample(Sample::Reference(snapshot.getRow(match.mRow)));
+	}
+	return list;
+}
+
+std::shared_ptr<const SimilarityIndex> SimilarityFinder::getIndex(std::shared_ptr<const DescriptorTable> table)
+{
+	if (table->getFilledCount() < SimilarityIndex::GRAPH_THRESHOLD)
+	{
+		return std::make_shared<const SimilarityIndex>(table, false);
+	}
+	const ScopedLock sl(mLock);
+	if (mGraph != nullptr && isCurrent(*mGraph->getTable(), *table))
+	{
+		return mGraph;
+	}
+	if (mBuilding == nullptr || !isCurrent(*mBuilding, *table))
+	{
+		mBuilding = table;
+		mBuildPool.removeAllJobs(true, 0); //an older table is not worth finishing
+		mBuildPool.addJob([this, table]()
+		{
+			ThreadPoolJob* job = ThreadPoolJob::getCurrentThreadPoolJob();
+			std::shared_ptr<const SimilarityIndex> graph = std::make_shared<const SimilarityIndex>(table, true,
+				[job]() { return job != nullptr && job->shouldExit(); });
+			const ScopedLock sl(mLock);
+			if (graph->hasGraph())
+				mGraph = graph;
+			if (mBuilding == table)
+				mBuilding = nullptr;
+		});
+	}
+	return std::make_shared<const SimilarityIndex>(table, false);
+}
+
+bool SimilarityFinder::isCurrent(const DescriptorTable& built, const DescriptorTable& table)
+{
+	//the same rows, whatever folders are checked now, those are filtered per query.
+	//rows filled after the build are missed until the next one, a few percent is not worth tens of seconds
+	return built.getSnapshot()->mSamples == table.getSnapshot()->mSamples && built.getFilledCount() * 20 >= table.getFilledCount() * 19;
+}
@@ -0,0 +1,132 @@
+/*
+  ==============================================================================
+
+    SimilarityIndex.h
+    Author:  Jake Rose
+
+	Nearest neighbours among the rows of a DescriptorTable. Small tables are
+	scanned whole, the byte descriptors make 100k rows about 1ms. Larger
+	ones get a hierarchical navigable small world graph (Malkov & Yashunin),
+	which answers in well under a millisecond but takes tens of seconds to
+	build, so SimilarityFinder builds it in the background and scans until
+	it is ready.
+
+  ==============================================================================
+*/
+
+#ifndef SIMILARITYINDEX_H
+#define SIMILARITYINDEX_H
+
+#include "JuceHeader.h"
+
+#include "DescriptorTable.h"
+
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+namespace samplore
+{
+	class SimilarityIndex
+	{
+	public:
+		/// Filled rows beyond which building a graph pays off, below the 200k a scan answers in about 2ms
+		static const int GRAPH_THRESHOLD = 100000;
+
+		struct Match
+		{
+			int mRow = -1;
+			int mDistance = 0;
+			bool operator<(const Match& other) const { return mDistance < other.mDistance; }
+		};
+
+		/// With buildGraph this takes seconds on a large table, keep it off the message thread.
+		/// shouldStop is polled while building, stopping leaves an index that scans
+		SimilarityIndex(std::shared_ptr<const DescriptorTable> table, bool buildGraph, const std::function<bool()>& shouldStop = nullptr);
+
+		/// Up to count filled rows accept allows, nearest first. Any thread
+		std::vector<Match> search(const int8* query, int count, const std::function<bool(int)>& accept) const;
+
+		bool hasGraph() const { return mEntryPoint >= 0; }
+		const std::shared_ptr<const DescriptorTable>& getTable() const { return mTable; }
+
+		/// Squared euclidean distance between two descriptors
+		static int getDistance(const int8* a, const int8* b)
+		{
+			//plain loop over a fixed length, compilers turn it into a handful of SIMD multiply-adds
+			int sum = 0;
+			for (int i = 0; i < SampleDescriptor::SIZE; i++)
+			{
+				const int difference = (int)a[i] - (int)b[i];
+				sum += difference * difference;
+			}
+			return sum;
+		}
+	private:
+		/// Generation stamped, clearing is a counter increment
+		struct VisitedSet
+		{
+			std::vector<uint32> mStamps;
+			uint32 mCurrent = 0;
+
+			explicit VisitedSet(int size) : mStamps((size_t)size, 0) {}
+			void clear() { mCurrent++; }
+			bool visit(int row)
+			{
+				if (mStamps[row] == mCurrent)
+					return false;
+				mStamps[row] = mCurrent;
+				return true;
+			}
+		};
+
+		std::vector<Match> searchAll(const int8* query, int count, const std::function<bool(int)>& accept) const;
+		std::vector<Match> searchGraph(const int8* query, int count, const std::function<bool(int)>& accept) const;
+
+		void insert(int row, int level, VisitedSet& visited);
+		/// Closest ef nodes on level reachable from entry, nearest first
+		std::vector<Match> searchLevel(const int8* query, int entry, int ef, int level, VisitedSet& visited) const;
+		/// Keeps neighbours that are not closer to an already kept neighbour than to the node, then the closest
+		std::vector<int> selectNeighbours(const std::vector<Match>& candidates, int maxCount) const;
+		std::vector<int>& getLinks(int row, int level);
+		const std::vector<int>& getLinks(int row, int level) const;
+		const int8* getRow(int row) const { return mTable->getRow(row); }
+
+		static const int LINKS = 16; //per node and level, twice that on the bottom level
+		static const int EF_CONSTRUCTION = 100;
+		static const int EF_SEARCH = 128;
+
+		std::shared_ptr<const DescriptorTable> mTable;
+		int mEntryPoint = -1;
+		int mTopLevel = -1;
+		std::vector<std::vector<int>> mBaseLinks; //level 0, by row
+		std::unordered_map<int, std::vector<std::vector<int>>> mUpperLinks; //levels 1 and up, few rows have any
+
+		JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SimilarityIndex)
+	};
+
+	/// Keeps the graph of the newest large table and answers with a scan while it builds
+	class SimilarityFinder
+	{
+	public:
+		SimilarityFinder();
+		~SimilarityFinder();
+
+		/// Any thread. Up to count samples of table nearest to query, nearest first, leaving out
+		/// exclude itself and folders unchecked in enabled, the newest snapshot over the same rows
+		Sample::List findSimilar(const SampleDescriptor& query, std::shared_ptr<const DescriptorTable> table,
+			std::shared_ptr<const LibrarySnapshot> enabled, int count, const File& exclude);
+	private:
+		std::shared_ptr<const SimilarityIndex> getIndex(std::shared_ptr<const DescriptorTable> table);
+		/// The graph for built still serves table if it has the same rows and most of their descriptors
+		static bool isCurrent(const DescriptorTable& built, const DescriptorTable& table);
+
+		ThreadPool mBuildPool;
+		CriticalSection mLock;
+		std::shared_ptr<const SimilarityIndex> mGraph;
+		std::shared_ptr<const DescriptorTable> mBuilding; //table a graph is being built for, if any
+
+		JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SimilarityFinder)
+	};
+}
+#endif
@@ -20,7 +20,9 @@ enum class SortingMethod
 	Oldest,
 	Recent,
 	Popular,
-	Random
+	Random,
+	Tempo,
+	Key //around the Camelot wheel
 };
 
 const std::vector<juce::String> sortingNames = {
@@ -29,5 +31,7 @@ const std::vector<juce::String> sortingNames = {
 	"Oldest",
 	"Recent",
 	"Popular",
-	"Randomize" };
+	"Randomize",
+	"Tempo",
+	"Key" };
 #endif
\ No newline at end of file
@@ -100,16 +100,16 @@ void TagExplorer::Container::updateTags(juce::String newSearch)
 	StringArray passedTags; //in dir
 	StringArray failedTags; //not in dir
 	//StringArray currentSampleTags = SamplifyProperties::getInstance()->getSampleLibrary()->getCurrentSamples();
-	Sample::List currentSamps = SamplifyProperties::getInstance()->getSampleLibrary()->getCurrentSamples();
+	Sample::List::Snapshot currentSamps = SamplifyProperties::getInstance()->getSampleLibrary()->getCurrentSamples();
 	
 	for (int i = 0; i < allTags.size(); i++)
 	{
 		if (allTags[i].mTitle.contains(newSearch))
 		{
 			bool found = false;
-			for (int j = 0; j < currentSamps.size(); j++)
+			for (int j = 0; j < currentSamps->size(); j++)
 			{
-				StringArray sampTags = currentSamps[j].getTags();
+				StringArray sampTags = (*currentSamps)[j].getTags();
 				if (sampTags.contains(allTags[i].mTitle))
 				{
 					found = true;
@@ -1,4 +1,5 @@
 #include "TagTile.h"
+#include "Diagnostics.h"
 #include "SamplifyProperties.h"
 #include "SampleTile.h"
 #include "SamplifyLookAndFeel.h"
@@ -29,6 +30,7 @@ void TagTile::setTag(juce::String tag)
 
 void TagTile::paint (Graphics& g)
 {
+	Diagnostics::PaintScope paintScope(Diagnostics::PaintClass::TagTile);
 	if (mTag != "")
 	{
 		auto& theme = ThemeManager::getInstance();
@@ -0,0 +1,139 @@
+/*
+  ==============================================================================
+
+    TempoEstimator.h
+    Author:  Jake Rose
+
+	Tempo of a loop from its mono signal. Energy flux gives an onset envelope
+	at 100 frames a second, autocorrelation of that envelope weighted toward
+	common tempos picks the beat period. Pure, any thread.
+
+  ==============================================================================
+*/
+
+#ifndef TEMPOESTIMATOR_H
+#define TEMPOESTIMATOR_H
+
+#include "JuceHeader.h"
+
+#include <cmath>
+#include <vector>
+
+struct TempoEstimate
+{
+	float mBpm = 0.0f; //zero when there is no beat to find
+	float mConfidence = 0.0f; //0 to 1, beat period peak against the envelope's energy
+};
+
+class TempoEstimator
+{
+public:
+	static constexpr double MIN_BPM = 60.0;
+	static constexpr double MAX_BPM = 200.0;
+	static constexpr double ENVELOPE_RATE = 100.0;
+	/// Shorter than this is a one-shot, not a loop
+	static constexpr double MIN_SECONDS = 1.5;
+
+	/// wholeFile says mono holds the entire sample, so its length can snap the result to whole beats
+	static TempoEstimate estimate(const float* mono, int numSamples, double sampleRate, bool wholeFile = true)
+	{
+		TempoEstimate result;
+		if (mono == nullptr || sampleRate <= 0.0 || numSamples < MIN_SECONDS * sampleRate)
+			return result;
+
+		std::vector<float> onset = getOnsetEnvelope(mono, numSamples, sampleRate);
+		const int hop = getHop(sampleRate);
+		const double envelopeRate = sampleRate / hop;
+		const int frames = (int)onset.size();
+		const int minLag = jmax(1, (int)std::floor(60.0 * envelopeRate / MAX_BPM));
+		const int maxLag = jmin(frames / 2, (int)std::ceil(60.0 * envelopeRate / MIN_BPM));
+		if (maxLag <= minLag + 1)
+			return result;
+
+		double energy = 0.0;
+		for (float value : onset)
+			energy += value * value;
+		energy /= frames;
+		if (energy <= 1.0e-9)
+			return result; //silence or a steady tone
+
+		std::vector<double> correlation(maxLag + 2, 0.0);
+		for (int lag = minLag - 1; lag <= maxLag + 1; lag++)
+		{
+			double sum = 0.0;
+			for (int i = 0; i + lag < frames; i++)
+				sum += onset[i] * onset[i + lag];
+			correlation[lag] = sum / (frames - lag);
+		}
+
+		int best = -1;
+		double bestScore = 0.0;
+		for (int lag = minLag; lag <= maxLag; lag++)
+		{
+			//log-gaussian around 120, an octave wide, keeps half and double time from winning on noise
+			const double octaves = std::log2((60.0 * envelopeRate / lag) / 120.0);
+			const double score = correlation[lag] * std::exp(-0.5 * octaves * octaves);
+			if (score > bestScore)
+			{
+				bestScore = score;
+				best = lag;
+			}
+		}
+		if (best < 0)
+			return result;
+
+		//parabola through the peak for a period between frames
+		double period = best;
+		const double left = correlation[best - 1], centre = correlation[best], right = correlation[best + 1];
+		const double curve = left - 2.0 * centre + right;
+		if (curve < 0.0)
+			period += jlimit(-0.5, 0.5, 0.5 * (left - right) / curve);
+
+		double bpm = 60.0 * envelopeRate / period;
+		if (wholeFile)
+		{
+			//loops are cut on whole beats, trust the length when it agrees
+			const double seconds = numSamples / sampleRate;
+			const double beats = bpm * seconds / 60.0;
+			const double wholeBeats = std::round(beats);
+			if (wholeBeats >= 2.0 && std::abs(beats - wholeBeats) / wholeBeats < 0.02)
+				bpm = 60.0 * wholeBeats / seconds;
+		}
+		result.mBpm = (float)(std::round(bpm * 10.0) / 10.0);
+		result.mConfidence = (float)jlimit(0.0, 1.0, centre / energy);
+		return result;
+	}
+
+	/// Half-wave rectified change in log energy, mean removed
+	static std::vector<float> getOnsetEnvelope(const float* mono, int numSamples, double sampleRate)
+	{
+		const int hop = getHop(sampleRate);
+		const int frames = numSamples / hop;
+		std::vector<float> onset((size_t)jmax(0, frames), 0.0f);
+		float previous = 0.0f;
+		double mean = 0.0;
+		for (int f = 0; f < frames; f++)
+		{
+			double sum = 0.0;
+			const float* frame = mono + (size_t)f * hop;
+			for (int i = 0; i < hop; i++)
+				sum += frame[i] * frame[i];
+			const float level = (float)std::log(1.0e-6 + sum / hop);
+			onset[f] = f > 0 ? jmax(0.0f, level - previous) : 0.0f;
+			previous = level;
+			mean += onset[f];
+		}
+		if (frames > 0)
+		{
+			mean /= frames;
+			for (float& value : onset)
+				value -= (float)mean;
+		}
+		return onset;
+	}
+
+private:
+	static int getHop(double sampleRate) { return jmax(1, roundToInt(sampleRate / ENVELOPE_RATE)); }
+};
+
+#endif
@@ -0,0 +1,433 @@
+#include "TempoPitchSource.h"
+
+#include <cmath>
+#include <cstring>
+
+using namespace samplore;
+
+namespace
+{
+	const double CUTOFF_STEP = 0.5; //ratio between neighbouring kernel tables
+	const int NUM_CUTOFFS = (int)((SincResampler::MAX_RATIO - 1.0) / CUTOFF_STEP) + 1; //31 tables, about half a megabyte
+	const double KAISER_BETA = 8.0;
+	const double WSOLA_HOP_SECONDS = 0.02;
+
+	/// Fraction of the input Nyquist kept by kernel table index
+	double getCutoff(int index)
+	{
+		return 0.95 / (1.0 + CUTOFF_STEP * index);
+	}
+
+	double besselI0(double x)
+	{
+		double sum = 1.0;
+		double term = 1.0;
+		for (int k = 1; k < 32; k++)
+		{
+			double factor = x / (2.0 * k);
+			term *= factor * factor;
+			sum += term;
+		}
+		return sum;
+	}
+
+	/// One Kaiser windowed sinc per cutoff, PHASES + 1 rows of TAPS so the last phase can be blended too
+	struct SincTables
+	{
+		std::vector<float> mCoefficients;
+
+		SincTables()
+		{
+			const int taps = SincResampler::TAPS;
+			const int rows = SincResampler::PHASES + 1;
+			mCoefficients.resize((size_t)(NUM_CUTOFFS * rows * taps));
+			for (int table = 0; table < NUM_CUTOFFS; table++)
+			{
+				const double cutoff = getCutoff(table);
+				for (int phase = 0; phase < rows; phase++)
+				{
+					float* row = mCoefficients.data() + (table * rows + phase) * taps;
+					const double fraction = (double)phase / SincResampler::PHASES;
+					double sum = 0.0;
+					for (int k = 0; k < taps; k++)
+					{
+						const double x = (k - (SincResampler::HALF_TAPS - 1)) - fraction;
+						const double y = MathConstants<double>::pi * cutoff * x;
+						const double sinc = y == 0.0 ? 1.0 : std::sin(y) / y;
+						const double w = x / SincResampler::HALF_TAPS;
+						const double window = std::abs(w) >= 1.0 ? 0.0 : besselI0(KAISER_BETA * std::sqrt(1.0 - w * w)) / besselI0(KAISER_BETA);
+						row[k] = (float)(cutoff * sinc * window);
+						sum += row[k];
+					}
+					for (int k = 0; k < taps; k++)
+					{
+						row[k] = (float)(row[k] / sum); //unity gain at DC on every phase
+					}
+				}
+			}
+		}
+	};
+
+	const SincTables& getSincTables()
+	{
+		static const SincTables tables;
+		return tables;
+	}
+
+	inline float dotProduct(const float* a, const float* b)
+	{
+		//eight independent sums so the compiler can keep them in vector registers
+		float sums[8] = {};
+		for (int k = 0; k < SincResampler::TAPS; k += 8)
+		{
+			for (int j = 0; j < 8; j++)
+			{
+				sums[j] += a[k + j] * b[k + j];
+			}
+		}
+		return ((sums[0] + sums[4]) + (sums[1] + sums[5])) + ((sums[2] + sums[6]) + (sums[3] + sums[7]));
+	}
+
+	void discardFront(AudioBuffer<float>& buffer, int count, int available)
+	{
+		for (int ch = 0; ch < buffer.getNumChannels(); ch++)
+		{
+			float* data = buffer.getWritePointer(ch);
+			std::memmove(data, data + count, sizeof(float) * (size_t)(available - count));
+		}
+	}
+}
+
+//==============================================================================
+SincResampler::SincResampler()
+{
+	getSincTables(); //built once, off the audio thread
+}
+
+void SincResampler::prepare(int numChannels, int maxBlockSize, double maxRatio)
+{
+	mMaxBlockSize = jmax(1, maxBlockSize);
+	mMaxRatio = jlimit(1.0, MAX_RATIO, maxRatio);
+	mHistory.setSize(numChannels, TAPS + 2 + (int)std::ceil(mMaxBlockSize * mMaxRatio));
+	reset();
+}
+
+void SincResampler::reset()
+{
+	mHistory.clear();
+	mAvailable = HALF_TAPS - 1; //silence before the first sample
+	mPosition = HALF_TAPS - 1;
+}
+
+const float* SincResampler::getKernel(double ratio) const
+{
+	const int table = ratio <= 1.0 ? 0 : jmin(NUM_CUTOFFS - 1, (int)std::ceil((ratio - 1.0) / CUTOFF_STEP));
+	return getSincTables().mCoefficients.data() + table * (PHASES + 1) * TAPS;
+}
+
+void SincResampler::process(AudioBuffer<float>& output, int startSample, int numSamples, double ratio,
+	const std::function<void(AudioBuffer<float>&, int, int)>& pull)
+{
+	jassert(ratio <= mMaxRatio);
+	ratio = jlimit(1.0 / 64.0, mMaxRatio, ratio);
+	const float* kernel = getKernel(ratio);
+	const int channels = jmin(output.getNumChannels(), mHistory.getNumChannels());
+
+	for (int done = 0; done < numSamples;)
+	{
+		const int count = jmin(numSamples - done, mMaxBlockSize);
+		const int needed = (int)(mPosition + (count - 1) * ratio) + HALF_TAPS + 1;
+		if (needed > mAvailable)
+		{
+			pull(mHistory, mAvailable, needed - mAvailable);
+			mAvailable = needed;
+		}
+		for (int ch = 0; ch < channels; ch++)
+		{
+			const float* in = mHistory.getReadPointer(ch);
+			float* out = output.getWritePointer(ch, startSample + done);
+			double position = mPosition;
+			if (mDraft)
+			{
+				for (int i = 0; i < count; i++)
+				{
+					const int index = (int)position;
+					const int row = roundToInt((position - index) * PHASES); //the table has PHASES + 1 rows
+					out[i] = dotProduct(kernel + row * TAPS, in + index - (HALF_TAPS - 1));
+					position += ratio;
+				}
+				continue;
+			}
+			for (int i = 0; i < count; i++)
+			{
+				const int index = (int)position;
+				const double phase = (position - index) * PHASES;
+				const int row = (int)phase;
+				const float blend = (float)(phase - row);
+				const float* x = in + index - (HALF_TAPS - 1);
+				const float a = dotProduct(kernel + row * TAPS, x);
+				const float b = dotProduct(kernel + (row + 1) * TAPS, x);
+				out[i] = a + blend * (b - a);
+				position += ratio;
+			}
+		}
+		mPosition += count * ratio;
+		//keep only the taps the next output still reaches back to
+		const int drop = (int)mPosition - (HALF_TAPS - 1);
+		if (drop > 0)
+		{
+			discardFront(mHistory, drop, mAvailable);
+			mAvailable -= drop;
+			mPosition -= drop;
+		}
+		done += count;
+	}
+	for (int ch = channels; ch < output.getNumChannels(); ch++)
+	{
+		output.clear(ch, startSample, numSamples);
+	}
+}
+
+//==============================================================================
+void WsolaStretcher::prepare(int numChannels, double sampleRate)
+{
+	mHop = jmax(64, roundToInt(sampleRate * WSOLA_HOP_SECONDS));
+	mFrame = mHop * 2;
+	mTolerance = mHop / 2;
+	mWindow.resize((size_t)mFrame);
+	for (int k = 0; k < mFrame; k++)
+	{
+		//periodic Hann, overlapping halves sum to one
+		mWindow[(size_t)k] = 0.5f - 0.5f * std::cos(MathConstants<float>::twoPi * k / mFrame);
+	}
+	//worst case span is one analysis hop at full tempo plus a frame and the search either side
+	mInput.setSize(numChannels, mFrame * 2 + mTolerance * 2 + (int)std::ceil(MAX_TEMPO * mHop) + 16);
+	mAccumulator.setSize(numChannels, mFrame);
+	mReady.setSize(numChannels, mHop);
+	reset();
+}
+
+void WsolaStretcher::reset()
+{
+	mInput.clear();
+	mAccumulator.clear();
+	mInputAvailable = 0;
+	mAnalysisPosition = 0.0;
+	mPreviousFrame = 0;
+	mHasPreviousFrame = false;
+	mReadyCount = 0;
+	mReadyPosition = 0;
+}
+
+void WsolaStretcher::process(AudioBuffer<float>& output, int startSample, int numSamples, double tempo,
+	const std::function<void(AudioBuffer<float>&, int, int)>& pull)
+{
+	tempo = jlimit(1.0 / MAX_TEMPO, MAX_TEMPO, tempo);
+	const int channels = jmin(output.getNumChannels(), mReady.getNumChannels());
+	for (int done = 0; done < numSamples;)
+	{
+		if (mReadyPosition >= mReadyCount)
+		{
+			produceHop(tempo, pull);
+		}
+		const int count = jmin(numSamples - done, mReadyCount - mReadyPosition);
+		for (int ch = 0; ch < channels; ch++)
+		{
+			output.copyFrom(ch, startSample + done, mReady, ch, mReadyPosition, count);
+		}
+		mReadyPosition += count;
+		done += count;
+	}
+	for (int ch = channels; ch < output.getNumChannels(); ch++)
+	{
+		output.clear(ch, startSample, numSamples);
+	}
+}
+
+int WsolaStretcher::getBuffered() const
+{
+	//the hop being played out overlaps the input from where the last frame started
+	return mHasPreviousFrame ? jmax(0, mInputAvailable - (mPreviousFrame + mReadyPosition)) : mInputAvailable;
+}
+
+void WsolaStretcher::fillInput(int needed, const std::function<void(AudioBuffer<float>&, int, int)>& pull)
+{
+	jassert(needed <= mInput.getNumSamples());
+	needed = jmin(needed, mInput.getNumSamples());
+	if (needed > mInputAvailable)
+	{
+		pull(mInput, mInputAvailable, needed - mInputAvailable);
+		mInputAvailable = needed;
+	}
+}
+
+void WsolaStretcher::produceHop(double tempo, const std::function<void(AudioBuffer<float>&, int, int)>& pull)
+{
+	const int nominal = (int)mAnalysisPosition;
+	const bool first = !mHasPreviousFrame;
+	const int natural = mPreviousFrame + mHop; //where the last frame would have carried on
+	fillInput(jmax(nominal + mTolerance + mFrame, first ? 0 : natural + mHop), pull);
+	const int start = first ? nominal : findBestOffset(nominal, natural);
+
+	for (int ch = 0; ch < mAccumulator.getNumChannels(); ch++)
+	{
+		float* accumulator = mAccumulator.getWritePointer(ch);
+		const float* in = mInput.getReadPointer(ch, start);
+		if (first)
+		{
+			//no fade in on the very first frame, the attack of a one-shot is the point of the preview
+			FloatVectorOperations::add(accumulator, in, mHop);
+			FloatVectorOperations::addWithMultiply(accumulator + mHop, in + mHop, mWindow.data() + mHop, mFrame - mHop);
+		}
+		else
+		{
+			FloatVectorOperations::addWithMultiply(accumulator, in, mWindow.data(), mFrame);
+		}
+		//the first hop has had both of its overlaps now
+		FloatVectorOperations::copy(mReady.getWritePointer(ch), accumulator, mHop);
+		FloatVectorOperations::copy(accumulator, accumulator + mHop, mFrame - mHop);
+		FloatVectorOperations::clear(accumulator + mHop, mFrame - mHop);
+	}
+	mReadyCount = mHop;
+	mReadyPosition = 0;
+	mPreviousFrame = start;
+	mHasPreviousFrame = true;
+	mAnalysisPosition += mHop * tempo;
+
+	//forget input neither the next search nor the next continuation can reach
+	const int keep = jmin((int)mAnalysisPosition - mTolerance, mPreviousFrame + mHop);
+	if (keep > 0)
+	{
+		discardFront(mInput, keep, mInputAvailable);
+		mInputAvailable -= keep;
+		mAnalysisPosition -= keep;
+		mPreviousFrame -= keep;
+	}
+}
+
+int WsolaStretcher::findBestOffset(int nominal, int natural) const
+{
+	const int low = jmax(0, nominal - mTolerance);
+	const int high = nominal + mTolerance;
+	const int channels = mInput.getNumChannels();
+	auto similarity = [&](int candidate, int step)
+	{
+		float cross = 0.0f;
+		float energy = 1.0e-9f;
+		for (int ch = 0; ch < channels; ch++)
+		{
+			const float* a = mInput.getReadPointer(ch, candidate);
+			const float* b = mInput.getReadPointer(ch, natural);
+			for (int k = 0; k < mHop; k += step)
+			{
+				cross += a[k] * b[k];
+				energy += a[k] * a[k];
+			}
+		}
+		return cross / std::sqrt(energy);
+	};
+
+	//coarse pass on a decimated grid, then refine around the winner, so the cost per hop is fixed
+	int best = jlimit(low, high, nominal);
+	float bestScore = similarity(best, 4);
+	for (int candidate = low; candidate <= high; candidate += 4)
+	{
+		float score = similarity(candidate, 4);
+		if (score > bestScore)
+		{
+			bestScore = score;
+			best = candidate;
+		}
+	}
+	if (mDraft)
+	{
+		return best;
+	}
+	const int coarse = best;
+	bestScore = similarity(coarse, 2);
+	for (int candidate = jmax(low, coarse - 3); candidate <= jmin(high, coarse + 3); candidate++)
+	{
+		float score = similarity(candidate, 2);
+		if (score > bestScore)
+		{
+			bestScore = score;
+			best = candidate;
+		}
+	}
+	return best;
+}
+
+//==============================================================================
+TempoPitchSource::TempoPitchSource(PositionableAudioSource* input, int numChannels)
+	: mInput(input), mNumChannels(numChannels)
+{
+	mPullInput = [this](AudioBuffer<float>& buffer, int startSample, int numSamples) { pullInput(buffer, startSample, numSamples); };
+	mPullStretched = [this](AudioBuffer<float>& buffer, int startSample, int numSamples) { pullStretched(buffer, startSample, numSamples); };
+}
+
+void TempoPitchSource::setSpeed(double speed, bool keepPitch)
+{
+	mSpeed = jlimit(MIN_SPEED, MAX_SPEED, speed);
+	mKeepPitch = keepPitch;
+	bool stretching = keepPitch && mSpeed != 1.0;
+	if (stretching && !mStretching)
+	{
+		mStretcher.reset();
+	}
+	mStretching = stretching;
+}
+
+void TempoPitchSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+	mInput->prepareToPlay(roundToInt(samplesPerBlockExpected * mRateRatio), sampleRate * mRateRatio);
+	mResampler.prepare(mNumChannels, samplesPerBlockExpected, jmin(mRateRatio * MAX_SPEED, SincResampler::MAX_RATIO));
+	mStretcher.prepare(mNumChannels, sampleRate * mRateRatio);
+}
+
+void TempoPitchSource::releaseResources()
+{
+	mInput->releaseResources();
+}
+
+int64 TempoPitchSource::getLatency() const
+{
+	double latency = 0.0;
+	if (getResampleRatio() != 1.0)
+	{
+		//the resampler's input is stretched output when stretching, one of its samples covers mSpeed input samples
+		latency += mResampler.getBuffered() * (mStretching ? mSpeed : 1.0);
+	}
+	if (mStretching)
+	{
+		latency += mStretcher.getBuffered();
+	}
+	return (int64)latency;
+}
+
+double TempoPitchSource::getResampleRatio() const
+{
+	//a 192kHz file at 4x on a 44.1kHz device would be past the kernels, it plays a little slower instead of aliasing
+	return jmin(mRateRatio * (mKeepPitch ? 1.0 : mSpeed), SincResampler::MAX_RATIO);
+}
+
+void TempoPitchSource::getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill)
+{
+	const double ratio = getResampleRatio();
+	const auto& upstream = mStretching ? mPullStretched : mPullInput;
+	if (ratio == 1.0)
+	{
+		upstream(*bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples);
+		return;
+	}
+	mResampler.process(*bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples, ratio, upstream);
+}
+
+void TempoPitchSource::pullInput(AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+	mInput->getNextAudioBlock(AudioSourceChannelInfo(&buffer, startSample, numSamples));
+}
+
+void TempoPitchSource::pullStretched(AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+	mStretcher.process(buffer, startSample, numSamples, mSpeed, mPullInput);
+}
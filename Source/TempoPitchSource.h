@@ -0,0 +1,130 @@
+/*
+  ==============================================================================
+
+    TempoPitchSource.h
+    Author:  Jake Rose
+
+	Preview rate conversion. A windowed sinc resampler handles the file to
+	device rate and varispeed, a WSOLA time-stretcher ahead of it changes
+	tempo without touching the key. Work per block is bounded by the block
+	size and the speed limits, nothing is allocated after prepareToPlay.
+
+  ==============================================================================
+*/
+
+#ifndef TEMPOPITCHSOURCE_H
+#define TEMPOPITCHSOURCE_H
+
+#include "JuceHeader.h"
+
+namespace samplore
+{
+	/// Polyphase windowed sinc, anti-aliased for whatever ratio it is asked for
+	class SincResampler
+	{
+	public:
+		static const int HALF_TAPS = 16;
+		static const int TAPS = HALF_TAPS * 2;
+		static const int PHASES = 128;
+		/// Highest ratio with an anti-aliasing kernel, beyond it the ratio is clamped
+		static constexpr double MAX_RATIO = 16.0;
+
+		SincResampler();
+
+		/// Sizes the history for blocks of up to maxBlockSize outputs at up to maxRatio
+		void prepare(int numChannels, int maxBlockSize, double maxRatio);
+		void reset();
+		/// One kernel phase per output instead of blending two, half the work
+		void setDraft(bool draft) { mDraft = draft; }
+		/// ratio is input samples per output sample, pull fills (buffer, start, count) from upstream
+		void process(AudioBuffer<float>& output, int startSample, int numSamples, double ratio,
+			const std::function<void(AudioBuffer<float>&, int, int)>& pull);
+		/// Input pulled that no output has reached yet
+		double getBuffered() const { return mAvailable - mPosition; }
+	private:
+		const float* getKernel(double ratio) const;
+
+		AudioBuffer<float> mHistory;
+		int mAvailable = 0; //valid input samples at the front of mHistory
+		double mPosition = 0.0; //next output, in input samples from the front of mHistory
+		int mMaxBlockSize = 0;
+		double mMaxRatio = 1.0;
+		bool mDraft = false;
+	};
+
+	/// Waveform similarity overlap-add, tempo above one plays faster at the same pitch
+	class WsolaStretcher
+	{
+	public:
+		static constexpr double MAX_TEMPO = 4.0;
+
+		void prepare(int numChannels, double sampleRate);
+		void reset();
+		/// Coarse search only when lining frames up
+		void setDraft(bool draft) { mDraft = draft; }
+		void process(AudioBuffer<float>& output, int startSample, int numSamples, double tempo,
+			const std::function<void(AudioBuffer<float>&, int, int)>& pull);
+		/// Input pulled past where the output has got to
+		int getBuffered() const;
+	private:
+		void produceHop(double tempo, const std::function<void(AudioBuffer<float>&, int, int)>& pull);
+		int findBestOffset(int nominal, int natural) const;
+		void fillInput(int needed, const std::function<void(AudioBuffer<float>&, int, int)>& pull);
+
+		int mHop = 0; //synthesis hop, half a frame
+		int mFrame = 0;
+		int mTolerance = 0; //how far a frame may move to line up with the last one
+		std::vector<float> mWindow;
+		AudioBuffer<float> mInput;
+		int mInputAvailable = 0;
+		double mAnalysisPosition = 0.0; //nominal start of the next frame in mInput
+		int mPreviousFrame = 0; //where the last frame really started, negative once its start has been discarded
+		bool mHasPreviousFrame = false; //false until the first frame after a reset
+		AudioBuffer<float> mAccumulator; //one frame of overlap-add
+		AudioBuffer<float> mReady; //finished output from the last hop
+		int mReadyCount = 0;
+		int mReadyPosition = 0;
+		bool mDraft = false;
+	};
+
+	/// Sits where a ResamplingAudioSource would, between a file source and the device
+	class TempoPitchSource : public AudioSource
+	{
+	public:
+		static constexpr double MIN_SPEED = 0.25;
+		static constexpr double MAX_SPEED = 4.0;
+
+		TempoPitchSource(PositionableAudioSource* input, int numChannels);
+
+		/// File rate over device rate, set before prepareToPlay
+		void setRateRatio(double ratio) { mRateRatio = ratio; }
+		/// Audio thread. Without keepPitch speed is plain varispeed, with it only the tempo changes
+		void setSpeed(double speed, bool keepPitch);
+		/// Audio thread, cheaper resampling and stretching while the callback is short of time
+		void setDraftQuality(bool draft) { mResampler.setDraft(draft); mStretcher.setDraft(draft); }
+		/// Audio thread, input samples read but not played yet, the tail still to come once the input ends
+		int64 getLatency() const;
+
+		void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+		void releaseResources() override;
+		void getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) override;
+	private:
+		double getResampleRatio() const;
+		void pullInput(AudioBuffer<float>& buffer, int startSample, int numSamples);
+		void pullStretched(AudioBuffer<float>& buffer, int startSample, int numSamples);
+
+		PositionableAudioSource* mInput;
+		int mNumChannels;
+		double mRateRatio = 1.0;
+		double mSpeed = 1.0;
+		bool mKeepPitch = false;
+		bool mStretching = false;
+		SincResampler mResampler;
+		WsolaStretcher mStretcher;
+		std::function<void(AudioBuffer<float>&, int, int)> mPullInput;
+		std::function<void(AudioBuffer<float>&, int, int)> mPullStretched;
+
+		JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TempoPitchSource)
+	};
+}
+#endif
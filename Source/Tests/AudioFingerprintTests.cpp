@@ -0,0 +1,143 @@
+/*
+  ==============================================================================
+
+    AudioFingerprintTests.cpp
+    Catch2 tests for acoustic fingerprints and duplicate grouping
+
+  ==============================================================================
+*/
+
+#include <catch2/catch.hpp>
+#include "DuplicateIndex.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+    const double sampleRate = 22050.0;
+
+    /// A few decaying partials over filtered noise, the seed picks the sound
+    std::vector<float> makeHit(int seed)
+    {
+        std::mt19937 random((unsigned int)seed);
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        std::normal_distribution<float> noise(0.0f, 1.0f);
+        double frequencies[4], decays[4], levels[4];
+        for (int k = 0; k < 4; k++)
+        {
+            frequencies[k] = 100.0 + uniform(random) * 3000.0;
+            decays[k] = 5.0 + uniform(random) * 30.0;
+            levels[k] = uniform(random);
+        }
+        const double noiseDecay = 10.0 + uniform(random) * 40.0;
+        const float cutoff = (float)(0.05 + uniform(random) * 0.9);
+        float filtered = 0.0f;
+        std::vector<float> hit((size_t)(0.5 * sampleRate));
+        for (size_t i = 0; i < hit.size(); i++)
+        {
+            const double t = i / sampleRate;
+            double value = 0.0;
+            for (int k = 0; k < 4; k++)
+                value += levels[k] * std::exp(-t * decays[k]) * std::sin(2.0 * juce::MathConstants<double>::pi * frequencies[k] * t);
+            filtered += cutoff * (noise(random) - filtered);
+            value += 0.6 * filtered * std::exp(-t * noiseDecay);
+            hit[i] = (float)(0.3 * value);
+        }
+        return hit;
+    }
+
+    AudioFingerprint fingerprint(const std::vector<float>& signal)
+    {
+        return AudioFingerprinter::compute(signal.data(), (int)signal.size(), sampleRate, signal.size() / sampleRate);
+    }
+
+    /// Quieter, duller, 16 bit and with a little silence in front, as a sample pack might resave it
+    std::vector<float> resave(std::vector<float> signal)
+    {
+        float filtered = 0.0f;
+        for (float& value : signal)
+        {
+            filtered += 0.6f * (value - filtered);
+            value = std::round(filtered * 0.7f * 32768.0f) / 32768.0f;
+        }
+        signal.insert(signal.begin(), 200, 0.0f);
+        return signal;
+    }
+}
+
+TEST_CASE("AudioFingerprinter matches copies and not other sounds", "[fingerprint]")
+{
+    const std::vector<float> hit = makeHit(1);
+    const AudioFingerprint original = fingerprint(hit);
+    REQUIRE(original.mCount > 0);
+
+    SECTION("The same audio gives the same fingerprint")
+    {
+        REQUIRE(fingerprint(hit) == original);
+        REQUIRE(AudioFingerprinter::getDistance(original, original) == 0.0f);
+    }
+
+    SECTION("A resaved copy is the same sound")
+    {
+        REQUIRE(AudioFingerprinter::isSameSound(original, fingerprint(resave(hit))));
+    }
+
+    SECTION("Different hits are different sounds")
+    {
+        for (int seed = 2; seed < 20; seed++)
+            REQUIRE_FALSE(AudioFingerprinter::isSameSound(original, fingerprint(makeHit(seed))));
+    }
+
+    SECTION("Silence has no fingerprint")
+    {
+        std::vector<float> silence((size_t)sampleRate, 0.0f);
+        REQUIRE(fingerprint(silence).mCount == 0);
+    }
+}
+
+TEST_CASE("DuplicateIndex groups copies", "[fingerprint]")
+{
+    DuplicateIndex index;
+    const int count = 20;
+    for (int seed = 0; seed < count; seed++)
+    {
+        const std::vector<float> hit = makeHit(seed);
+        index.add(1000 + seed, fingerprint(hit));
+        if (seed % 2 == 0)
+            index.add(2000 + seed, fingerprint(resave(hit))); //near copy of the one before
+    }
+    index.add(1000, fingerprint(makeHit(0))); //byte identical to the first
+
+    std::vector<DuplicateIndex::Group> groups = index.getGroups();
+    REQUIRE(groups.size() == count / 2);
+
+    SECTION("Largest group first, items in the order added")
+    {
+        REQUIRE(groups.front().mItems == std::vector<int> { 0, 1, index.size() - 1 });
+        REQUIRE_FALSE(groups.front().mIdentical);
+    }
+
+    SECTION("Every other group is a hit and its resaved copy")
+    {
+        for (size_t i = 1; i < groups.size(); i++)
+        {
+            REQUIRE(groups[i].mItems.size() == 2);
+            REQUIRE(groups[i].mItems[1] == groups[i].mItems[0] + 1);
+        }
+    }
+}
+
+TEST_CASE("DuplicateIndex marks identical content", "[fingerprint]")
+{
+    DuplicateIndex index;
+    AudioFingerprint silent; //no words, only the content can match
+    index.add(7, silent);
+    index.add(8, silent);
+    index.add(7, silent);
+    std::vector<DuplicateIndex::Group> groups = index.getGroups();
+    REQUIRE(groups.size() == 1);
+    REQUIRE(groups.front().mItems == std::vector<int> { 0, 2 });
+    REQUIRE(groups.front().mIdentical);
+}
@@ -0,0 +1,122 @@
+/*
+  ==============================================================================
+
+    CallbackLoadMeterTests.cpp
+    Catch2 tests for audio callback load, xrun detection and the draft switch
+
+  ==============================================================================
+*/
+
+#include <catch2/catch.hpp>
+#include "CallbackLoadMeter.h"
+
+using samplore::CallbackLoadMeter;
+
+namespace
+{
+    const double sampleRate = 48000.0;
+    const int blockSize = 480; //10 ms
+
+    juce::int64 ticks(double seconds) { return juce::Time::secondsToHighResolutionTicks(seconds); }
+
+    /// Feeds count callbacks on schedule, each taking load of its period, returns when the next would start
+    double feed(CallbackLoadMeter& meter, double start, int count, double load)
+    {
+        const double period = blockSize / sampleRate;
+        for (int i = 0; i < count; i++)
+        {
+            meter.addCallback(ticks(start), ticks(start + period * load), blockSize);
+            start += period;
+        }
+        return start;
+    }
+}
+
+TEST_CASE("Callback load is time taken over buffer time", "[CallbackLoadMeter]")
+{
+    CallbackLoadMeter meter;
+    meter.prepare(sampleRate);
+
+    SECTION("Nothing is published before a window fills")
+    {
+        feed(meter, 1.0, CallbackLoadMeter::WINDOW_CALLBACKS - 1, 0.5);
+        REQUIRE(meter.getLastLoad() == Approx(0.5f).margin(0.01f));
+        REQUIRE(meter.getStats().mMax == 0.0f);
+    }
+
+    SECTION("A full window publishes min, mean and max")
+    {
+        double time = feed(meter, 1.0, CallbackLoadMeter::WINDOW_CALLBACKS / 2, 0.1);
+        feed(meter, time, CallbackLoadMeter::WINDOW_CALLBACKS / 2, 0.3);
+        const CallbackLoadMeter::Stats stats = meter.getStats();
+        REQUIRE(stats.mMin == Approx(0.1f).margin(0.01f));
+        REQUIRE(stats.mMean == Approx(0.2f).margin(0.01f));
+        REQUIRE(stats.mMax == Approx(0.3f).margin(0.01f));
+        REQUIRE(meter.getXrunCount() == 0);
+    }
+}
+
+TEST_CASE("Xruns are overruns and late callbacks", "[CallbackLoadMeter]")
+{
+    CallbackLoadMeter meter;
+    meter.prepare(sampleRate);
+
+    SECTION("A callback longer than its buffer is an xrun")
+    {
+        feed(meter, 1.0, 3, 1.2);
+        REQUIRE(meter.getXrunCount() == 3);
+    }
+
+    SECTION("A callback arriving two periods late after a heavy one is an xrun")
+    {
+        double time = feed(meter, 1.0, 4, CallbackLoadMeter::LATE_CALLBACK_LOAD + 0.1);
+        feed(meter, time + 2.0 * blockSize / sampleRate, 1, 0.1);
+        REQUIRE(meter.getXrunCount() == 1);
+    }
+
+    SECTION("Late light callbacks are a bursty driver, not xruns")
+    {
+        //three periods' wait, then the driver catches up with callbacks back to back
+        double time = feed(meter, 1.0, 4, 0.1);
+        time += 3.0 * blockSize / sampleRate;
+        for (int i = 0; i < 3; i++)
+        {
+            meter.addCallback(ticks(time), ticks(time + 0.0005), blockSize);
+            time += 0.001;
+        }
+        feed(meter, time, 4, 0.1);
+        REQUIRE(meter.getXrunCount() == 0);
+    }
+
+    SECTION("The first callback after prepare is never late")
+    {
+        feed(meter, 1.0, 2, 0.1);
+        meter.prepare(sampleRate);
+        feed(meter, 5.0, 2, 0.1);
+        REQUIRE(meter.getXrunCount() == 0);
+    }
+}
+
+TEST_CASE("Draft quality comes on under load and goes once it is calm", "[CallbackLoadMeter]")
+{
+    CallbackLoadMeter meter;
+    meter.prepare(sampleRate);
+    const int window = CallbackLoadMeter::WINDOW_CALLBACKS;
+
+    double time = feed(meter, 1.0, window, 0.2);
+    REQUIRE_FALSE(meter.wantsDraftQuality());
+
+    //one heavy callback is enough, before anything glitched
+    time = feed(meter, time, window - 1, 0.2);
+    time = feed(meter, time, 1, CallbackLoadMeter::DRAFT_ENTER_LOAD + 0.05);
+    REQUIRE(meter.wantsDraftQuality());
+
+    //in between the two thresholds stays in draft
+    time = feed(meter, time, window * CallbackLoadMeter::RECOVER_WINDOWS * 2, 0.5);
+    REQUIRE(meter.wantsDraftQuality());
+
+    time = feed(meter, time, window * (CallbackLoadMeter::RECOVER_WINDOWS - 1), 0.1);
+    REQUIRE(meter.wantsDraftQuality());
+    feed(meter, time, window, 0.1);
+    REQUIRE_FALSE(meter.wantsDraftQuality());
+}
@@ -0,0 +1,136 @@
+/*
+  ==============================================================================
+
+    ContentHashTests.cpp
+    Catch2 tests for xxHash64 and content hashes of sample files
+
+  ==============================================================================
+*/
+
+#include <catch2/catch.hpp>
+#include "ContentHash.h"
+
+#include <vector>
+
+namespace
+{
+    /// A 16 bit mono WAV, with an optional metadata chunk in front of the samples
+    juce::MemoryBlock makeWav(const std::vector<juce::int16>& samples, const juce::String& comment = {})
+    {
+        juce::MemoryOutputStream chunks;
+        chunks.write("WAVE", 4);
+        chunks.write("fmt ", 4);
+        chunks.writeInt(16);
+        chunks.writeShort(1); //PCM
+        chunks.writeShort(1);
+        chunks.writeInt(44100);
+        chunks.writeInt(44100 * 2);
+        chunks.writeShort(2);
+        chunks.writeShort(16);
+        if (comment.isNotEmpty())
+        {
+            const int length = (int)comment.getNumBytesAsUTF8();
+            chunks.write("LIST", 4);
+            chunks.writeInt(length);
+            chunks.write(comment.toRawUTF8(), (size_t)length);
+            if (length & 1)
+                chunks.writeByte(0);
+        }
+        chunks.write("data", 4);
+        chunks.writeInt((int)samples.size() * 2);
+        for (juce::int16 sample : samples)
+            chunks.writeShort(sample);
+
+        juce::MemoryOutputStream wav;
+        wav.write("RIFF", 4);
+        wav.writeInt((int)chunks.getDataSize());
+        wav.write(chunks.getData(), chunks.getDataSize());
+        return wav.getMemoryBlock();
+    }
+
+    juce::uint64 hashOf(const juce::MemoryBlock& data)
+    {
+        juce::File file = juce::File::createTempFile("wav");
+        file.replaceWithData(data.getData(), data.getSize());
+        const juce::uint64 hash = ContentHash::compute(file);
+        file.deleteFile();
+        return hash;
+    }
+
+    std::vector<juce::int16> ramp(int length, int step)
+    {
+        std::vector<juce::int16> samples((size_t)length);
+        for (int i = 0; i < length; i++)
+            samples[(size_t)i] = (juce::int16)(i * step);
+        return samples;
+    }
+}
+
+TEST_CASE("XxHash64 matches the reference", "[contenthash]")
+{
+    REQUIRE(XxHash64::hash("", 0) == 0xef46db3751d8e999ULL);
+    REQUIRE(XxHash64::hash("abc", 3) == 0x44bc2cf5ad770999ULL);
+    REQUIRE(XxHash64::hash("abc", 3, 5) == 0xe7ab658b74128f34ULL);
+
+    std::vector<juce::uint8> bytes;
+    for (int i = 0; i < 3 * 256; i++)
+        bytes.push_back((juce::uint8)i);
+    REQUIRE(XxHash64::hash(bytes.data(), bytes.size()) == 0x8e03c838c596036fULL);
+
+    SECTION("Streaming in odd pieces gives the same hash")
+    {
+        XxHash64 hasher;
+        for (size_t position = 0; position < bytes.size(); position += 7)
+            hasher.update(bytes.data() + position, juce::jmin((size_t)7, bytes.size() - position));
+        REQUIRE(hasher.digest() == 0x8e03c838c596036fULL);
+    }
+}
+
+TEST_CASE("ContentHash follows the audio, not the file", "[contenthash]")
+{
+    const std::vector<juce::int16> samples = ramp(5000, 3);
+    const juce::uint64 original = hashOf(makeWav(samples));
+    REQUIRE(original != 0);
+
+    SECTION("Rewritten metadata keeps the hash")
+    {
+        REQUIRE(hashOf(makeWav(samples, "retagged by an editor")) == original);
+    }
+
+    SECTION("Different audio changes it")
+    {
+        std::vector<juce::int16> edited = samples;
+        edited[2500] += 1;
+        REQUIRE(hashOf(makeWav(edited)) != original);
+    }
+
+    SECTION("The data chunk is found past other chunks")
+    {
+        const juce::MemoryBlock wav = makeWav(samples, "odd");
+        juce::MemoryInputStream in(wav, false);
+        const juce::Range<juce::int64> payload = ContentHash::findAudioPayload(in, (juce::int64)wav.getSize());
+        REQUIRE(payload.getLength() == (juce::int64)samples.size() * 2);
+        REQUIRE(payload.getEnd() == (juce::int64)wav.getSize());
+    }
+
+    SECTION("Unreadable files have no hash")
+    {
+        REQUIRE(ContentHash::compute(juce::File::createTempFile("missing")) == 0);
+    }
+}
+
+TEST_CASE("ContentHash reads the whole of large payloads", "[contenthash]")
+{
+    //a couple of MB, an edit anywhere in it has to show
+    const int length = 1024 * 1024 + 100000;
+    const std::vector<juce::int16> samples = ramp(length, 1);
+    const juce::uint64 original = hashOf(makeWav(samples));
+
+    std::vector<juce::int16> end = samples;
+    end.back() += 1;
+    REQUIRE(hashOf(makeWav(end)) != original);
+
+    std::vector<juce::int16> between = samples;
+    between[(size_t)length / 4] += 1;
+    REQUIRE(hashOf(makeWav(between)) != original);
+}
@@ -0,0 +1,97 @@
+/*
+  ==============================================================================
+
+    DescriptorExtractorTests.cpp
+    Catch2 tests for sample descriptors
+
+  ==============================================================================
+*/
+
+#include <catch2/catch.hpp>
+#include "DescriptorExtractor.h"
+#include "TestHelpers.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+    const double sampleRate = 22050.0;
+
+    SampleDescriptor describe(const std::vector<float>& signal)
+    {
+        return DescriptorExtractor::extract(signal.data(), (int)signal.size(), sampleRate, signal.size() / sampleRate);
+    }
+
+    /// Pitch dropping from 150Hz to 50Hz, gone in half a second
+    std::vector<float> makeKick()
+    {
+        std::vector<float> kick((size_t)(0.5 * sampleRate));
+        for (size_t i = 0; i < kick.size(); i++)
+        {
+            const double t = i / sampleRate;
+            kick[i] = (float)(0.9 * std::exp(-t * 12.0) * std::sin(2.0 * juce::MathConstants<double>::pi * (50.0 + 100.0 * std::exp(-t * 30.0)) * t));
+        }
+        return kick;
+    }
+
+    std::vector<float> makeHat()
+    {
+        std::mt19937 random(3);
+        std::normal_distribution<float> noise(0.0f, 1.0f);
+        std::vector<float> hat((size_t)(0.2 * sampleRate));
+        for (size_t i = 0; i < hat.size(); i++)
+            hat[i] = (float)(0.3 * std::exp(-(i / sampleRate) * 40.0)) * noise(random);
+        return hat;
+    }
+
+    /// A chord fading in over a second
+    std::vector<float> makePad()
+    {
+        std::vector<float> pad((size_t)(3.0 * sampleRate));
+        for (size_t i = 0; i < pad.size(); i++)
+        {
+            const double t = i / sampleRate;
+            pad[i] = (float)(juce::jmin(1.0, t) * 0.2 * (std::sin(2.0 * juce::MathConstants<double>::pi * 220.0 * t)
+                + std::sin(2.0 * juce::MathConstants<double>::pi * 277.0 * t)));
+        }
+        return pad;
+    }
+}
+
+TEST_CASE("SampleDescriptor quantises to a byte per feature", "[descriptor]")
+{
+    SampleDescriptor descriptor;
+    descriptor.set(SampleDescriptor::Centroid, 0.5f);
+    descriptor.set(SampleDescriptor::Flux, 3.0f);
+    REQUIRE(descriptor.get(SampleDescriptor::Centroid) == Approx(0.5f).margin(1.0f / 127.0f));
+    REQUIRE(descriptor.get(SampleDescriptor::Flux) == 1.0f);
+    REQUIRE(sizeof(descriptor.mValues) == SampleDescriptor::SIZE);
+}
+
+TEST_CASE("DescriptorExtractor tells sounds apart", "[descriptor]")
+{
+    SampleDescriptor kick = describe(makeKick());
+    SampleDescriptor hat = describe(makeHat());
+    SampleDescriptor pad = describe(makePad());
+
+    SECTION("Hats are brighter and noisier than kicks")
+    {
+        REQUIRE(hat.get(SampleDescriptor::Centroid) > kick.get(SampleDescriptor::Centroid));
+        REQUIRE(hat.get(SampleDescriptor::Rolloff) > kick.get(SampleDescriptor::Rolloff));
+        REQUIRE(hat.get(SampleDescriptor::Flatness) > kick.get(SampleDescriptor::Flatness));
+        REQUIRE(kick.get(SampleDescriptor::LowEnergy) > hat.get(SampleDescriptor::LowEnergy));
+    }
+
+    SECTION("Pads swell, hits do not")
+    {
+        REQUIRE(pad.get(SampleDescriptor::Attack) > kick.get(SampleDescriptor::Attack));
+        REQUIRE(pad.get(SampleDescriptor::Duration) > hat.get(SampleDescriptor::Duration));
+    }
+
+    SECTION("The same audio gives the same descriptor")
+    {
+        REQUIRE(describe(makeKick()) == kick);
+    }
+}
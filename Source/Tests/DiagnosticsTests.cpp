@@ -0,0 +1,66 @@
+/*
+  ==============================================================================
+
+    DiagnosticsTests.cpp
+    Catch2 tests for the diagnostics counters
+
+  ==============================================================================
+*/
+
+#include <catch2/catch.hpp>
+#include "Diagnostics.h"
+
+#include <vector>
+
+using samplore::Diagnostics;
+
+namespace
+{
+    /// Counts recorded into each bucket by body, the counters are global so compare before and after
+    template <typename Body>
+    std::vector<juce::int64> bucketDeltas(Body body)
+    {
+        std::vector<juce::int64> before;
+        for (int i = 0; i < Diagnostics::QUERY_BUCKETS; i++)
+            before.push_back(Diagnostics::getQueryBucket(i).load());
+        body();
+        std::vector<juce::int64> deltas;
+        for (int i = 0; i < Diagnostics::QUERY_BUCKETS; i++)
+            deltas.push_back(Diagnostics::getQueryBucket(i).load() - before[(size_t)i]);
+        return deltas;
+    }
+}
+
+TEST_CASE("Query latency lands in the bucket below its limit", "[Diagnostics]")
+{
+    SECTION("Fast queries go in the first bucket")
+    {
+        auto deltas = bucketDeltas([] { Diagnostics::recordQueryLatency(0.0); Diagnostics::recordQueryLatency(4.9); });
+        REQUIRE(deltas[0] == 2);
+    }
+
+    SECTION("A limit belongs to the next bucket")
+    {
+        auto deltas = bucketDeltas([] { Diagnostics::recordQueryLatency(Diagnostics::getQueryBucketLimit(0)); });
+        REQUIRE(deltas[0] == 0);
+        REQUIRE(deltas[1] == 1);
+    }
+
+    SECTION("Anything past the last limit goes in the last bucket")
+    {
+        auto deltas = bucketDeltas([] { Diagnostics::recordQueryLatency(60000.0); });
+        REQUIRE(deltas[Diagnostics::QUERY_BUCKETS - 1] == 1);
+    }
+}
+
+TEST_CASE("Paint scopes count calls", "[Diagnostics]")
+{
+    Diagnostics::PaintStats& stats = Diagnostics::getPaintStats(Diagnostics::PaintClass::SampleTile);
+    const juce::int64 before = stats.mCount.load();
+    {
+        Diagnostics::PaintScope first(Diagnostics::PaintClass::SampleTile);
+        Diagnostics::PaintScope second(Diagnostics::PaintClass::SampleTile);
+    }
+    REQUIRE(stats.mCount.load() - before == 2);
+    REQUIRE(stats.mMicroseconds.load() >= 0);
+}
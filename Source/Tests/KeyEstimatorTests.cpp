@@ -0,0 +1,81 @@
+/*
+  ==============================================================================
+
+    KeyEstimatorTests.cpp
+    Catch2 tests for chroma key detection and key names
+
+  ==============================================================================
+*/
+
+#include <catch2/catch.hpp>
+#include "KeyEstimator.h"
+#include "TestHelpers.h"
+
+#include <cmath>
+#include <vector>
+
+namespace
+{
+    /// Each chord held for an equal share of the length, four harmonics per note
+    std::vector<float> makeProgression(const std::vector<std::vector<int>>& chords, double seconds, double sampleRate)
+    {
+        std::vector<float> signal((size_t)(seconds * sampleRate), 0.0f);
+        const size_t chordLength = signal.size() / chords.size();
+        for (size_t c = 0; c < chords.size(); c++)
+        {
+            for (int note : chords[c])
+            {
+                const double frequency = 440.0 * std::pow(2.0, (note - 69) / 12.0);
+                for (int harmonic = 1; harmonic <= 4; harmonic++)
+                {
+                    for (size_t i = c * chordLength; i < (c + 1) * chordLength; i++)
+                        signal[i] += (float)(0.2 / harmonic * std::sin(2.0 * juce::MathConstants<double>::pi * frequency * harmonic * i / sampleRate));
+                }
+            }
+        }
+        return signal;
+    }
+}
+
+TEST_CASE("KeyEstimator matches key profiles", "[key]")
+{
+    const double sampleRate = 11025.0;
+
+    SECTION("I IV V I in C major")
+    {
+        std::vector<float> loop = makeProgression({ { 60, 64, 67 }, { 65, 69, 72 }, { 67, 71, 74 }, { 60, 64, 67 } }, 4.0, sampleRate);
+        KeyEstimate estimate = KeyEstimator::estimate(loop.data(), (int)loop.size(), sampleRate);
+        REQUIRE(MusicalKey::getName(estimate.mKey) == "C");
+        REQUIRE(estimate.mConfidence > 0.7f);
+    }
+
+    SECTION("i iv V i in A minor, not its relative major")
+    {
+        std::vector<float> loop = makeProgression({ { 57, 60, 64 }, { 62, 65, 69 }, { 64, 68, 71 }, { 57, 60, 64 } }, 4.0, sampleRate);
+        KeyEstimate estimate = KeyEstimator::estimate(loop.data(), (int)loop.size(), sampleRate);
+        REQUIRE(MusicalKey::getName(estimate.mKey) == "Am");
+    }
+
+    SECTION("Silence has no key")
+    {
+        std::vector<float> silence((size_t)(2.0 * sampleRate), 0.0f);
+        REQUIRE(KeyEstimator::estimate(silence.data(), (int)silence.size(), sampleRate).mKey == MusicalKey::NONE);
+    }
+}
+
+TEST_CASE("MusicalKey names", "[key]")
+{
+    REQUIRE(MusicalKey::fromName("Am") == MusicalKey::fromName("a minor"));
+    REQUIRE(MusicalKey::getName(MusicalKey::fromName("Bbm")) == "A#m");
+    REQUIRE(MusicalKey::getName(MusicalKey::fromName("Gb")) == "F#");
+    REQUIRE(MusicalKey::fromName("8A") == MusicalKey::fromName("Am"));
+    REQUIRE(MusicalKey::fromName("8B") == MusicalKey::fromName("C"));
+    REQUIRE(MusicalKey::getCamelotName(MusicalKey::fromName("E")) == "12B");
+    REQUIRE(MusicalKey::fromName("H") == MusicalKey::UNKNOWN);
+    REQUIRE(MusicalKey::fromName("13A") == MusicalKey::UNKNOWN);
+
+    //relative keys sort together, neighbours on the wheel next to them
+    REQUIRE(MusicalKey::getSortValue(MusicalKey::fromName("Am")) < MusicalKey::getSortValue(MusicalKey::fromName("C")));
+    REQUIRE(MusicalKey::getSortValue(MusicalKey::fromName("C")) < MusicalKey::getSortValue(MusicalKey::fromName("Em")));
+    REQUIRE(MusicalKey::getSortValue(MusicalKey::NONE) > MusicalKey::getSortValue(MusicalKey::fromName("12B")));
+}
@@ -0,0 +1,123 @@
+/*
+  ==============================================================================
+
+    LibraryIndexTests.cpp
+    Catch2 tests for saving and reading back the library index
+
+  ==============================================================================
+*/
+
+#include <catch2/catch.hpp>
+#include "LibraryIndex.h"
+
+using samplore::LibraryIndex;
+
+namespace
+{
+    const juce::String wildcard = "*.wav;*.aiff";
+
+    LibraryIndex::Folder makeTree()
+    {
+        LibraryIndex::Folder kicks;
+        kicks.mName = "Kicks";
+        kicks.mModified = 1700000000000;
+        kicks.mSamples.push_back({ "kick.wav", 0x0123456789abcdefULL, { "punchy", "808" }, 44144, 1690000000000 });
+
+        LibraryIndex::Folder root;
+        root.mName = "Drums";
+        root.mModified = 1710000000000;
+        root.mSamples.push_back({ "loop.wav", 42, {}, 1024, 1600000000000 });
+        root.mSamples.push_back({ "unhashed.aiff", 0, { "todo" }, -1, 0 });
+        root.mFolders.push_back(kicks);
+        return root;
+    }
+
+    /// The saved file, with the bytes from offset on replaced
+    void rewrite(const juce::File& file, size_t offset, const void* bytes, size_t size)
+    {
+        juce::MemoryBlock data;
+        REQUIRE(file.loadFileAsData(data));
+        data.copyFrom(bytes, (int)offset, size);
+        REQUIRE(file.replaceWithData(data.getData(), data.getSize()));
+    }
+}
+
+TEST_CASE("LibraryIndex reads back what it saved", "[libraryindex]")
+{
+    const juce::File file = juce::File::createTempFile("bin");
+    const juce::File root = juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile("Drums");
+    {
+        LibraryIndex index(file);
+        index.set(root, wildcard, makeTree());
+        REQUIRE(index.save());
+    }
+
+    SECTION("Round trip")
+    {
+        LibraryIndex index(file);
+        const LibraryIndex::Folder* folder = index.find(root, wildcard);
+        REQUIRE(folder != nullptr);
+        REQUIRE(folder->mModified == 1710000000000);
+        REQUIRE(folder->mSamples.size() == 2);
+        REQUIRE(folder->mSamples[0].mName == "loop.wav");
+        REQUIRE(folder->mSamples[0].mContentHash == 42);
+        REQUIRE(folder->mSamples[0].mSize == 1024);
+        REQUIRE(folder->mSamples[0].mModified == 1600000000000);
+        REQUIRE(folder->mSamples[1].mSize == -1);
+        REQUIRE(folder->mSamples[1].mTags == juce::StringArray("todo"));
+        REQUIRE(folder->mFolders.size() == 1);
+        const LibraryIndex::SampleEntry& kick = folder->mFolders[0].mSamples.at(0);
+        REQUIRE(kick.mName == "kick.wav");
+        REQUIRE(kick.mContentHash == 0x0123456789abcdefULL);
+        REQUIRE(kick.mTags == juce::StringArray("punchy", "808"));
+        REQUIRE(kick.mSize == 44144);
+    }
+
+    SECTION("Listed with other formats")
+    {
+        LibraryIndex index(file);
+        REQUIRE(index.find(root, wildcard + ";*.flac") == nullptr);
+        REQUIRE(index.find(root.getSiblingFile("Synths"), wildcard) == nullptr);
+    }
+
+    SECTION("A file cut short is treated as empty")
+    {
+        juce::MemoryBlock data;
+        REQUIRE(file.loadFileAsData(data));
+        for (size_t cut : { (size_t)4, data.getSize() / 2, data.getSize() - 1 })
+        {
+            REQUIRE(file.replaceWithData(data.getData(), cut));
+            LibraryIndex index(file);
+            REQUIRE(index.find(root, wildcard) == nullptr);
+        }
+    }
+
+    SECTION("Another version is treated as empty")
+    {
+        juce::MemoryBlock data;
+        REQUIRE(file.loadFileAsData(data));
+        const int version = juce::ByteOrder::littleEndianInt((const char*)data.getData() + 4);
+        const char newer[] = { (char)(version + 1), 0, 0, 0 };
+        rewrite(file, 4, newer, sizeof(newer));
+        LibraryIndex index(file);
+        REQUIRE(index.find(root, wildcard) == nullptr);
+    }
+
+    SECTION("Roots saved by someone else are kept unless forgotten")
+    {
+        const juce::File other = root.getSiblingFile("Synths");
+        LibraryIndex stale(file); //loaded before the other root was added
+        {
+            LibraryIndex index(file);
+            index.set(other, wildcard, makeTree());
+            REQUIRE(index.save());
+        }
+        stale.forget(root);
+        REQUIRE(stale.save());
+        LibraryIndex reloaded(file);
+        REQUIRE(reloaded.find(root, wildcard) == nullptr);
+        REQUIRE(reloaded.find(other, wildcard) != nullptr);
+    }
+
+    file.deleteFile();
+}
@@ -0,0 +1,119 @@
+/*
+  ==============================================================================
+
+    SamplerEngineTests.cpp
+    Catch2 tests for the sampler's voice stealing and retriggering
+
+  ==============================================================================
+*/
+
+#include <catch2/catch.hpp>
+#include "SamplerEngine.h"
+
+using samplore::SamplerEngine;
+using samplore::DecodedAudio;
+
+namespace
+{
+    const double sampleRate = 48000.0;
+    const int blockSize = 256;
+
+    /// A sound holding one value, at the device rate so voices copy it straight
+    std::shared_ptr<const DecodedAudio> makeConstant(float value, int length)
+    {
+        auto audio = std::make_shared<DecodedAudio>();
+        audio->mSampleRate = sampleRate;
+        audio->mBuffer.setSize(1, length);
+        for (int i = 0; i < length; i++)
+            audio->mBuffer.setSample(0, i, value);
+        return audio;
+    }
+
+    /// Renders blocks, returns the last sample of the last one
+    float render(SamplerEngine& engine, int blocks)
+    {
+        juce::AudioBuffer<float> output(1, blockSize);
+        for (int b = 0; b < blocks; b++)
+        {
+            output.clear();
+            engine.renderNextBlock(output, 0, blockSize);
+        }
+        return output.getSample(0, blockSize - 1);
+    }
+}
+
+TEST_CASE("The oldest sounding voice is stolen", "[SamplerEngine]")
+{
+    SamplerEngine engine;
+    engine.prepareToPlay(blockSize, sampleRate);
+    engine.setPadSound(0, makeConstant(0.5f, 48000));
+    engine.setPadSound(1, makeConstant(0.01f, 48000));
+
+    //pad 0 first, then pad 1 until the polyphony is used up
+    engine.noteOn(0, 1.0f);
+    render(engine, 1);
+    for (int i = 1; i < SamplerEngine::MAX_POLYPHONY; i++)
+        engine.noteOn(1, 1.0f);
+    REQUIRE(render(engine, 1) == Approx(0.5f + 0.01f * (SamplerEngine::MAX_POLYPHONY - 1)).margin(1.0e-4));
+    REQUIRE(engine.getStolenVoiceCount() == 0);
+
+    SECTION("One more note fades out the first")
+    {
+        engine.noteOn(1, 1.0f);
+        //the steal fade is a few milliseconds, long over after two blocks
+        REQUIRE(render(engine, 2) == Approx(0.01f * SamplerEngine::MAX_POLYPHONY).margin(1.0e-4));
+        REQUIRE(engine.getStolenVoiceCount() == 1);
+        REQUIRE(engine.getActiveVoiceCount() == SamplerEngine::MAX_POLYPHONY);
+    }
+
+    SECTION("Stealing carries on in start order")
+    {
+        for (int i = 0; i < 3; i++)
+            engine.noteOn(0, 1.0f);
+        //pad 0's first voice and the two oldest on pad 1 go, the new pad 0 voices sound
+        REQUIRE(render(engine, 2) == Approx(0.5f * 3 + 0.01f * (SamplerEngine::MAX_POLYPHONY - 3)).margin(1.0e-4));
+        REQUIRE(engine.getStolenVoiceCount() == 3);
+    }
+}
+
+TEST_CASE("Retriggering stacks voices", "[SamplerEngine]")
+{
+    SamplerEngine engine;
+    engine.prepareToPlay(blockSize, sampleRate);
+
+    SECTION("A drum pad rings on under its retrigger")
+    {
+        engine.setPadSound(3, makeConstant(0.25f, 48000));
+        engine.noteOn(3, 1.0f);
+        render(engine, 1);
+        engine.noteOn(3, 1.0f);
+        REQUIRE(render(engine, 1) == Approx(0.5f).margin(1.0e-5));
+        REQUIRE(engine.getActiveVoiceCount() == 2);
+        REQUIRE(engine.getStolenVoiceCount() == 0);
+    }
+
+    SECTION("A chromatic note off releases every voice of its key")
+    {
+        engine.setMode(SamplerEngine::Mode::Chromatic);
+        engine.setChromaticSound(makeConstant(0.25f, 48000));
+        engine.noteOn(0, 1.0f);
+        engine.noteOn(0, 1.0f);
+        engine.noteOn(7, 1.0f);
+        render(engine, 1);
+        REQUIRE(engine.getActiveVoiceCount() == 3);
+        engine.noteOff(0);
+        //past the release, only the fifth is left
+        REQUIRE(render(engine, 20) == Approx(0.25f).margin(1.0e-3));
+        REQUIRE(engine.getActiveVoiceCount() == 1);
+    }
+
+    SECTION("A sound ending on a block boundary stops cleanly")
+    {
+        engine.setPadSound(0, makeConstant(0.25f, blockSize * 2));
+        engine.noteOn(0, 1.0f);
+        REQUIRE(render(engine, 2) == Approx(0.25f).margin(1.0e-5));
+        REQUIRE(engine.getActiveVoiceCount() == 1);
+        REQUIRE(render(engine, 1) == 0.0f);
+        REQUIRE(engine.getActiveVoiceCount() == 0);
+    }
+}
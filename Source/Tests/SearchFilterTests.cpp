@@ -0,0 +1,119 @@
+/*
+  ==============================================================================
+
+    SearchFilterTests.cpp
+    Catch2 tests for SearchFilter parsing and refinement
+
+  ==============================================================================
+*/
+
+#include <catch2/catch.hpp>
+#include "SearchFilter.h"
+#include "TestHelpers.h"
+
+TEST_CASE("SearchFilter parsing", "[searchfilter]")
+{
+    SECTION("Plain text becomes the query")
+    {
+        SearchFilter filter = SearchFilter::fromQuery("snare");
+        REQUIRE(filter.mQuery == "snare");
+        REQUIRE(filter.mTags.isEmpty());
+    }
+
+    SECTION("Hash words become tags")
+    {
+        SearchFilter filter = SearchFilter::fromQuery("#drums snare #acoustic");
+        REQUIRE(filter.mQuery == "snare");
+        REQUIRE(filter.mTags.size() == 2);
+        REQUIRE(filter.mTags.contains("drums"));
+        REQUIRE(filter.mTags.contains("acoustic"));
+    }
+
+    SECTION("Empty query matches everything")
+    {
+        SearchFilter filter = SearchFilter::fromQuery("");
+        REQUIRE(filter.isEmpty());
+        REQUIRE(filter.matches("/samples/kick.wav", juce::StringArray()));
+    }
+}
+
+TEST_CASE("SearchFilter matching", "[searchfilter]")
+{
+    juce::StringArray tags { "drums", "Acoustic" };
+
+    REQUIRE(SearchFilter::fromQuery("SNARE").matches("/samples/snare_01.wav", tags));
+    REQUIRE(SearchFilter::fromQuery("acou").matches("/samples/snare_01.wav", tags));
+    REQUIRE(SearchFilter::fromQuery("#drums").matches("/samples/snare_01.wav", tags));
+    REQUIRE_FALSE(SearchFilter::fromQuery("#drum").matches("/samples/snare_01.wav", tags));
+    REQUIRE_FALSE(SearchFilter::fromQuery("kick #drums").matches("/samples/snare_01.wav", tags));
+}
+
+TEST_CASE("SearchFilter tempo ranges", "[searchfilter]")
+{
+    juce::StringArray tags;
+
+    SECTION("A single tempo allows for rounding")
+    {
+        SearchFilter filter = SearchFilter::fromQuery("bpm:120 loop");
+        REQUIRE(filter.mQuery == "loop");
+        REQUIRE(filter.matches("/loops/loop_a.wav", tags, 120.4f));
+        REQUIRE_FALSE(filter.matches("/loops/loop_a.wav", tags, 124.0f));
+    }
+
+    SECTION("Ranges are inclusive and skip unanalysed samples")
+    {
+        SearchFilter filter = SearchFilter::fromQuery("BPM:110-130");
+        REQUIRE_FALSE(filter.isEmpty());
+        REQUIRE(filter.matches("/loops/a.wav", tags, 110.0f));
+        REQUIRE(filter.matches("/loops/a.wav", tags, 130.0f));
+        REQUIRE_FALSE(filter.matches("/loops/a.wav", tags, 131.0f));
+        REQUIRE_FALSE(filter.matches("/loops/a.wav", tags));
+        REQUIRE_FALSE(filter.matches("/loops/a.wav", tags, 0.0f));
+    }
+
+    SECTION("A narrower range refines a wider one")
+    {
+        REQUIRE(SearchFilter::fromQuery("bpm:115-125").isRefinementOf(SearchFilter::fromQuery("bpm:110-130")));
+        REQUIRE(SearchFilter::fromQuery("bpm:120").isRefinementOf(SearchFilter::fromQuery("")));
+        REQUIRE_FALSE(SearchFilter::fromQuery("").isRefinementOf(SearchFilter::fromQuery("bpm:120")));
+        REQUIRE_FALSE(SearchFilter::fromQuery("bpm:100-140") == SearchFilter::fromQuery("bpm:110-130"));
+    }
+}
+
+TEST_CASE("SearchFilter keys", "[searchfilter]")
+{
+    juce::StringArray tags;
+    const int aMinor = MusicalKey::fromName("Am");
+
+    SearchFilter filter = SearchFilter::fromQuery("key:Am pad");
+    REQUIRE(filter.mQuery == "pad");
+    REQUIRE(filter.matches("/pads/pad.wav", tags, -1.0f, aMinor));
+    REQUIRE(SearchFilter::fromQuery("key:8a").matches("/pads/pad.wav", tags, -1.0f, aMinor));
+    REQUIRE_FALSE(filter.matches("/pads/pad.wav", tags, -1.0f, MusicalKey::fromName("C")));
+    REQUIRE_FALSE(filter.matches("/pads/pad.wav", tags));
+    REQUIRE(filter.isRefinementOf(SearchFilter::fromQuery("pad")));
+    REQUIRE_FALSE(SearchFilter::fromQuery("pad").isRefinementOf(filter));
+}
+
+TEST_CASE("SearchFilter refinement", "[searchfilter]")
+{
+    SECTION("Longer text refines shorter text")
+    {
+        REQUIRE(SearchFilter::fromQuery("snare").isRefinementOf(SearchFilter::fromQuery("sn")));
+        REQUIRE(SearchFilter::fromQuery("sn").isRefinementOf(SearchFilter::fromQuery("")));
+        REQUIRE_FALSE(SearchFilter::fromQuery("sn").isRefinementOf(SearchFilter::fromQuery("snare")));
+        REQUIRE_FALSE(SearchFilter::fromQuery("kick").isRefinementOf(SearchFilter::fromQuery("sn")));
+    }
+
+    SECTION("Adding a tag refines")
+    {
+        REQUIRE(SearchFilter::fromQuery("sn #drums").isRefinementOf(SearchFilter::fromQuery("sn")));
+        REQUIRE_FALSE(SearchFilter::fromQuery("sn").isRefinementOf(SearchFilter::fromQuery("sn #drums")));
+    }
+
+    SECTION("Equality ignores tag order and case")
+    {
+        REQUIRE(SearchFilter::fromQuery("Snare #a #b") == SearchFilter::fromQuery("snare #b #a"));
+        REQUIRE_FALSE(SearchFilter::fromQuery("snare #a") == SearchFilter::fromQuery("snare #a #b"));
+    }
+}
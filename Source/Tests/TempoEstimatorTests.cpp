@@ -0,0 +1,68 @@
+/*
+  ==============================================================================
+
+    TempoEstimatorTests.cpp
+    Catch2 tests for loop tempo estimation
+
+  ==============================================================================
+*/
+
+#include <catch2/catch.hpp>
+#include "TempoEstimator.h"
+#include "TestHelpers.h"
+
+#include <cmath>
+#include <vector>
+
+namespace
+{
+    /// Decaying tone bursts on every beat
+    std::vector<float> makeClickTrack(double bpm, double seconds, double sampleRate)
+    {
+        std::vector<float> signal((size_t)(seconds * sampleRate), 0.0f);
+        const double period = 60.0 / bpm * sampleRate;
+        for (double beat = 0.0; beat < signal.size(); beat += period)
+        {
+            for (size_t i = 0; i < 400 && (size_t)beat + i < signal.size(); i++)
+                signal[(size_t)beat + i] += (float)(std::exp(-(double)i / 80.0) * std::sin(i * 0.3));
+        }
+        return signal;
+    }
+}
+
+TEST_CASE("TempoEstimator finds the beat", "[tempo]")
+{
+    const double sampleRate = 11025.0;
+
+    SECTION("Two bars at 120")
+    {
+        std::vector<float> loop = makeClickTrack(120.0, 4.0, sampleRate);
+        TempoEstimate estimate = TempoEstimator::estimate(loop.data(), (int)loop.size(), sampleRate);
+        REQUIRE(estimate.mBpm == Approx(120.0f).margin(0.5f));
+        REQUIRE(estimate.mConfidence > 0.5f);
+    }
+
+    SECTION("Longer excerpt at 90")
+    {
+        std::vector<float> loop = makeClickTrack(90.0, 10.0, sampleRate);
+        TempoEstimate estimate = TempoEstimator::estimate(loop.data(), (int)loop.size(), sampleRate, false);
+        REQUIRE(estimate.mBpm == Approx(90.0f).margin(1.0f));
+    }
+}
+
+TEST_CASE("TempoEstimator rejects what is not a loop", "[tempo]")
+{
+    const double sampleRate = 11025.0;
+
+    SECTION("Silence has no tempo")
+    {
+        std::vector<float> silence((size_t)(3.0 * sampleRate), 0.0f);
+        REQUIRE(TempoEstimator::estimate(silence.data(), (int)silence.size(), sampleRate).mBpm == 0.0f);
+    }
+
+    SECTION("One-shots are too short")
+    {
+        std::vector<float> hit = makeClickTrack(120.0, 0.5, sampleRate);
+        REQUIRE(TempoEstimator::estimate(hit.data(), (int)hit.size(), sampleRate).mBpm == 0.0f);
+    }
+}
@@ -0,0 +1,139 @@
+/*
+  ==============================================================================
+
+    TempoPitchSourceTests.cpp
+    Catch2 tests for WSOLA time stretching and the sinc resampler's ratio limit
+
+  ==============================================================================
+*/
+
+#include <catch2/catch.hpp>
+#include "TempoPitchSource.h"
+
+#include <cmath>
+
+using samplore::SincResampler;
+using samplore::WsolaStretcher;
+
+namespace
+{
+    const double sampleRate = 48000.0;
+    const double frequency = 440.0;
+
+    /// Stretches a full scale sine, returns the stretched output after the first frame settled
+    juce::AudioBuffer<float> stretchSine(double tempo, int blocks, int blockSize)
+    {
+        WsolaStretcher stretcher;
+        stretcher.prepare(1, sampleRate);
+        juce::int64 phase = 0;
+        auto pull = [&phase](juce::AudioBuffer<float>& buffer, int start, int count)
+        {
+            for (int i = 0; i < count; i++, phase++)
+                buffer.setSample(0, start + i, (float)std::sin(juce::MathConstants<double>::twoPi * frequency * phase / sampleRate));
+        };
+        juce::AudioBuffer<float> output(1, blocks * blockSize);
+        for (int b = 0; b < blocks; b++)
+            stretcher.process(output, b * blockSize, blockSize, tempo, pull);
+        return output;
+    }
+
+    float getPeak(const juce::AudioBuffer<float>& buffer, int from)
+    {
+        float peak = 0.0f;
+        for (int i = from; i < buffer.getNumSamples(); i++)
+            peak = juce::jmax(peak, std::abs(buffer.getSample(0, i)));
+        return peak;
+    }
+
+    float getLargestStep(const juce::AudioBuffer<float>& buffer, int from)
+    {
+        float largest = 0.0f;
+        for (int i = from + 1; i < buffer.getNumSamples(); i++)
+            largest = juce::jmax(largest, std::abs(buffer.getSample(0, i) - buffer.getSample(0, i - 1)));
+        return largest;
+    }
+}
+
+TEST_CASE("WSOLA keeps a stretched sine continuous and at unity gain", "[TempoPitchSource]")
+{
+    //a full scale sine never moves further than this between two samples
+    const float sineStep = (float)(juce::MathConstants<double>::twoPi * frequency / sampleRate);
+    const int settle = 4096; //past the first frames, which are not overlapped on both sides
+
+    SECTION("Tempo 1.5")
+    {
+        juce::AudioBuffer<float> output = stretchSine(1.5, 200, 480);
+        REQUIRE(getPeak(output, settle) <= 1.01f);
+        REQUIRE(getPeak(output, settle) >= 0.9f);
+        REQUIRE(getLargestStep(output, settle) <= sineStep * 1.5f);
+    }
+
+    SECTION("Tempo 2.0")
+    {
+        juce::AudioBuffer<float> output = stretchSine(2.0, 200, 480);
+        REQUIRE(getPeak(output, settle) <= 1.01f);
+        REQUIRE(getPeak(output, settle) >= 0.9f);
+        REQUIRE(getLargestStep(output, settle) <= sineStep * 1.5f);
+    }
+
+    SECTION("The unfaded first frames stay at unity gain too")
+    {
+        juce::AudioBuffer<float> output = stretchSine(2.0, 20, 480);
+        REQUIRE(getPeak(output, 0) <= 1.01f);
+    }
+}
+
+TEST_CASE("Sinc resampling past the kernel tables is clamped", "[TempoPitchSource]")
+{
+    SincResampler resampler;
+    resampler.prepare(1, 256, 192000.0 / 44100.0 * 4.0); //a 192kHz file at 4x on a 44.1kHz device, sized for MAX_RATIO
+    juce::int64 pulled = 0;
+    auto pull = [&pulled](juce::AudioBuffer<float>& buffer, int start, int count)
+    {
+        for (int i = 0; i < count; i++)
+            buffer.setSample(0, start + i, 1.0f);
+        pulled += count;
+    };
+    juce::AudioBuffer<float> output(1, 256);
+    resampler.process(output, 0, 256, SincResampler::MAX_RATIO, pull);
+    REQUIRE(pulled <= (juce::int64)(256 * SincResampler::MAX_RATIO) + SincResampler::TAPS + 2);
+    //a constant stays constant once the history is full
+    REQUIRE(output.getSample(0, 255) == Approx(1.0f).margin(0.01f));
+}
+
+TEST_CASE("What is buffered is what has been read but not played", "[TempoPitchSource]")
+{
+    juce::int64 pulled = 0;
+    auto pull = [&pulled](juce::AudioBuffer<float>& buffer, int start, int count)
+    {
+        buffer.clear(0, start, count);
+        pulled += count;
+    };
+    juce::AudioBuffer<float> output(1, 480);
+
+    SECTION("Sinc resampler")
+    {
+        const double ratio = 1.37;
+        SincResampler resampler;
+        resampler.prepare(1, 480, ratio);
+        for (int b = 1; b <= 20; b++)
+        {
+            resampler.process(output, 0, 480, ratio, pull);
+            REQUIRE(pulled - resampler.getBuffered() == Approx(b * 480 * ratio).margin(1.0e-6));
+        }
+    }
+
+    SECTION("WSOLA")
+    {
+        const double tempo = 1.5;
+        const int hop = (int)(sampleRate * 0.02);
+        WsolaStretcher stretcher;
+        stretcher.prepare(1, sampleRate);
+        for (int b = 1; b <= 40; b++)
+        {
+            stretcher.process(output, 0, 480, tempo, pull);
+            //frames move by up to half a hop to line up, and a hop of output covers tempo hops of input
+            REQUIRE(std::abs(pulled - stretcher.getBuffered() - b * 480 * tempo) <= hop * tempo);
+        }
+    }
+}
@@ -0,0 +1,273 @@
+#include "Tracer.h"
+
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+using namespace samplore;
+
+namespace
+{
+	struct TraceEvent
+	{
+		const char* mName;
+		int64 mStart; //ticks
+		int64 mEnd; //ticks, zones only
+		double mValue; //counters only
+		int mThreadId; //buffers change threads, the events keep whose they were
+		bool mIsCounter;
+	};
+
+	/// Appended to by the thread holding it only, read once recording has stopped
+	struct ThreadBuffer
+	{
+		std::unique_ptr<TraceEvent[]> mStorage; //allocated on the first event, most threads never record one
+		std::atomic<TraceEvent*> mEvents { nullptr };
+		std::atomic<int> mCount { 0 };
+		std::atomic<int> mDropped { 0 };
+		std::atomic<bool> mReserved { false }; //allocated by start instead, its thread must not
+		int mThreadId = 0; //of the thread holding it
+		bool mInUse = true; //under the registry lock
+	};
+
+	struct Registry
+	{
+		CriticalSection mLock;
+		std::vector<std::unique_ptr<ThreadBuffer>> mBuffers; //every buffer ever made, in use or pooled
+		std::map<int, String> mThreadNames; //by thread id, for the events still held
+		int mLastThreadId = 0;
+		int64 mStartTicks = 0;
+	};
+
+	/// Never deleted, threads may still record while statics are torn down
+	Registry& getRegistry()
+	{
+		static Registry* registry = new Registry();
+		return *registry;
+	}
+
+	/// Trivially destructible, so reading it never allocates, not even on a thread's first access
+	thread_local ThreadBuffer* currentBuffer = nullptr;
+
+	/// Under the registry lock. A pooled buffer if there is one, keeping the events of its last thread
+	ThreadBuffer* acquireBuffer(Registry& registry, const String& name)
+	{
+		ThreadBuffer* buffer = nullptr;
+		for (auto& pooled : registry.mBuffers)
+		{
+			if (!pooled->mInUse && (buffer == nullptr || pooled->mStorage != nullptr))
+				buffer = pooled.get(); //one that recorded before saves an allocation
+		}
+		if (buffer == nullptr)
+		{
+			registry.mBuffers.push_back(std::make_unique<ThreadBuffer>());
+			buffer = registry.mBuffers.back().get();
+		}
+		buffer->mInUse = true;
+		buffer->mThreadId = ++registry.mLastThreadId;
+		registry.mThreadNames[buffer->mThreadId] = name.isNotEmpty() ? name : "Thread " + String(buffer->mThreadId);
+		return buffer;
+	}
+
+	void releaseBuffer(ThreadBuffer* buffer)
+	{
+		const ScopedLock sl(getRegistry().mLock);
+		buffer->mReserved = false;
+		buffer->mInUse = false;
+	}
+
+	/// Gives the buffer back when its thread exits
+	struct BufferReturner
+	{
+		ThreadBuffer* mBuffer = nullptr;
+		~BufferReturner()
+		{
+			if (mBuffer != nullptr)
+				releaseBuffer(mBuffer);
+		}
+	};
+
+	ThreadBuffer& getThreadBuffer()
+	{
+		if (currentBuffer == nullptr)
+		{
+			String name;
+			if (Thread* thread = Thread::getCurrentThread())
+				name = thread->getThreadName();
+			else if (MessageManager::existsAndIsCurrentThread())
+				name = "Message";
+			Registry& registry = getRegistry();
+			const ScopedLock sl(registry.mLock);
+			currentBuffer = acquireBuffer(registry, name);
+			thread_local BufferReturner returner; //only here, reserved threads never construct it
+			returner.mBuffer = currentBuffer;
+		}
+		return *currentBuffer;
+	}
+
+	void append(TraceEvent event)
+	{
+		ThreadBuffer& buffer = getThreadBuffer();
+		int count = buffer.mCount.load(std::memory_order_relaxed);
+		TraceEvent* events = buffer.mEvents.load(std::memory_order_acquire);
+		if (events == nullptr && !buffer.mReserved.load(std::memory_order_relaxed))
+		{
+			buffer.mStorage.reset(new TraceEvent[Tracer::EVENTS_PER_THREAD]);
+			events = buffer.mStorage.get();
+			buffer.mEvents.store(events, std::memory_order_release);
+		}
+		if (events == nullptr || count >= Tracer::EVENTS_PER_THREAD)
+		{
+			buffer.mDropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		event.mThreadId = buffer.mThreadId;
+		events[count] = event;
+		//fails if start cleared the buffer meanwhile, the event belonged to the previous trace
+		buffer.mCount.compare_exchange_strong(count, count + 1, std::memory_order_release, std::memory_order_relaxed);
+	}
+
+	String escape(const String& text)
+	{
+		return text.replace("\\", "\\\\").replace("\"", "\\\"");
+	}
+}
+
+void Tracer::start()
+{
+	Registry& registry = getRegistry();
+	{
+		const ScopedLock sl(registry.mLock);
+		std::map<int, String> names;
+		for (auto& buffer : registry.mBuffers)
+		{
+			buffer->mCount.store(0, std::memory_order_relaxed);
+			buffer->mDropped.store(0, std::memory_order_relaxed);
+			if (buffer->mReserved && buffer->mStorage == nullptr)
+			{
+				buffer->mStorage.reset(new TraceEvent[EVENTS_PER_THREAD]);
+				buffer->mEvents.store(buffer->mStorage.get(), std::memory_order_release);
+			}
+			if (buffer->mInUse)
+				names[buffer->mThreadId] = registry.mThreadNames[buffer->mThreadId];
+		}
+		registry.mThreadNames.swap(names); //threads gone before this trace have no events left
+		registry.mStartTicks = Time::getHighResolutionTicks();
+	}
+	getEnabled().store(true, std::memory_order_release);
+}
+
+bool Tracer::stop(const File& file)
+{
+	getEnabled().store(false, std::memory_order_relaxed);
+	file.getParentDirectory().createDirectory();
+	FileOutputStream out(file);
+	if (!out.openedOk())
+	{
+		return false;
+	}
+	out.setPosition(0);
+	out.truncate();
+
+	Registry& registry = getRegistry();
+	const ScopedLock sl(registry.mLock);
+	auto toMicroseconds = [&registry](int64 ticks)
+	{
+		return String(Time::highResolutionTicksToSeconds(ticks - registry.mStartTicks) * 1.0e6, 3);
+	};
+	int dropped = 0;
+	std::set<int> threads;
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	const char* separator = "\n";
+	for (auto& buffer : registry.mBuffers)
+	{
+		//events appended after this load belong to no trace, they are cleared on the next start
+		const int count = buffer->mCount.load(std::memory_order_acquire);
+		dropped += buffer->mDropped.load(std::memory_order_relaxed);
+		const TraceEvent* events = buffer->mEvents.load(std::memory_order_acquire);
+		for (int i = 0; i < count; i++)
+		{
+			const TraceEvent& event = events[i];
+			if (event.mStart < registry.mStartTicks)
+			{
+				continue; //started before recording did
+			}
+			threads.insert(event.mThreadId);
+			out << separator << "{\"name\":\"" << escape(event.mName) << "\",\"pid\":1,\"tid\":" << event.mThreadId << ",\"ts\":" << toMicroseconds(event.mStart);
+			if (event.mIsCounter)
+				out << ",\"ph\":\"C\",\"args\":{\"value\":" << String(event.mValue) << "}}";
+			else
+				out << ",\"ph\":\"X\",\"dur\":" << String(Time::highResolutionTicksToSeconds(event.mEnd - event.mStart) * 1.0e6, 3) << "}";
+			separator = ",\n";
+		}
+	}
+	for (int thread : threads)
+	{
+		out << separator << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread
+			<< ",\"args\":{\"name\":\"" << escape(registry.mThreadNames[thread]) << "\"}}";
+		separator = ",\n";
+	}
+	out << "\n],\"otherData\":{\"droppedEvents\":" << dropped << "}}\n";
+	out.flush();
+	return out.getStatus().wasOk();
+}
+
+File Tracer::getDefaultFile()
+{
+	//next to the analysis log
+	PropertiesFile::Options options;
+	options.applicationName = "Traces";
+	options.folderName = "Samplore";
+	options.osxLibrarySubFolder = "Application Support/Samplore";
+	return options.getDefaultFile().getSiblingFile("Traces").getChildFile("trace-" + Time::getCurrentTime().formatted("%Y%m%d-%H%M%S") + ".json");
+}
+
+void Tracer::setThreadName(const String& name)
+{
+	ThreadBuffer& buffer = getThreadBuffer();
+	Registry& registry = getRegistry();
+	const ScopedLock sl(registry.mLock);
+	registry.mThreadNames[buffer.mThreadId] = name;
+}
+
+Tracer::ReservedThread::ReservedThread(const String& name)
+{
+	Registry& registry = getRegistry();
+	const ScopedLock sl(registry.mLock);
+	ThreadBuffer* buffer = acquireBuffer(registry, name);
+	buffer->mReserved = true;
+	if (buffer->mStorage == nullptr && isEnabled())
+	{
+		//start allocates it otherwise
+		buffer->mStorage.reset(new TraceEvent[EVENTS_PER_THREAD]);
+		buffer->mEvents.store(buffer->mStorage.get(), std::memory_order_release);
+	}
+	mBuffer = buffer;
+}
+
+Tracer::ReservedThread::~ReservedThread()
+{
+	releaseBuffer(static_cast<ThreadBuffer*>(mBuffer));
+}
+
+void Tracer::ReservedThread::bind() noexcept
+{
+	currentBuffer = static_cast<ThreadBuffer*>(mBuffer);
+}
+
+void Tracer::counter(const char* name, double value)
+{
+	if (isEnabled())
+	{
+		append({ name, Time::getHighResolutionTicks(), 0, value, 0, true });
+	}
+}
+
+void Tracer::recordZone(const char* name, int64 startTicks, int64 endTicks)
+{
+	if (isEnabled())
+	{
+		append({ name, startTicks, endTicks, 0.0, 0, false });
+	}
+}
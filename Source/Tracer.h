@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+
+    Tracer.h
+    Author:  Jake Rose
+
+	Scoped zones, counters and thread names written as a Chrome trace, open
+	the file at ui.perfetto.dev. Off by default and switched at runtime,
+	a disabled zone costs one relaxed atomic load. Every thread appends to
+	its own fixed buffer without locking, full buffers drop events and
+	count them. Buffers go back to a pool when their thread exits, so
+	short lived threads do not each keep one. Zone and counter names must
+	be string literals, only the pointer is kept.
+
+  ==============================================================================
+*/
+
+#ifndef TRACER_H
+#define TRACER_H
+
+#include "JuceHeader.h"
+
+#include <atomic>
+
+namespace samplore
+{
+	class Tracer
+	{
+	public:
+		/// Clears what was recorded before and starts recording on every thread
+		static void start();
+		/// Stops recording and writes everything since start to file, false if it could not be written
+		static bool stop(const File& file);
+		static bool isEnabled() { return getEnabled().load(std::memory_order_relaxed); }
+		/// Traces folder in the app data, named after the current time
+		static File getDefaultFile();
+
+		/// Shown instead of the thread's own name, call from the thread itself. Locks, use ReservedThread on the audio thread
+		static void setThreadName(const String& name);
+		static void counter(const char* name, double value);
+
+		/// A buffer registered and allocated ahead of time for a thread that must neither lock nor allocate,
+		/// like the audio callback. Create and destroy it elsewhere, the thread itself only calls bind
+		class ReservedThread
+		{
+		public:
+			explicit ReservedThread(const String& name);
+			/// Returns the buffer to the pool, the thread must not record after this
+			~ReservedThread();
+			/// Call from the thread itself before it records, lock and allocation free
+			void bind() noexcept;
+		private:
+			void* mBuffer;
+			JUCE_DECLARE_NON_COPYABLE(ReservedThread)
+		};
+
+		/// Times its own lifetime, use SAMPLORE_TRACE_ZONE
+		class Zone
+		{
+		public:
+			explicit Zone(const char* name) noexcept : mName(name), mStart(isEnabled() ? Time::getHighResolutionTicks() : -1) {}
+			~Zone()
+			{
+				if (mStart >= 0)
+					recordZone(mName, mStart, Time::getHighResolutionTicks());
+			}
+		private:
+			const char* mName;
+			int64 mStart;
+			JUCE_DECLARE_NON_COPYABLE(Zone)
+		};
+
+		static const int EVENTS_PER_THREAD = 1 << 18; //10MB for each buffer that records, a scan has a zone per sample
+	private:
+		static std::atomic<bool>& getEnabled()
+		{
+			static std::atomic<bool> enabled { false };
+			return enabled;
+		}
+		static void recordZone(const char* name, int64 startTicks, int64 endTicks);
+	};
+}
+
+#define SAMPLORE_TRACE_ZONE(name) samplore::Tracer::Zone JUCE_JOIN_MACRO(traceZone, __LINE__)(name)
+
+#endif